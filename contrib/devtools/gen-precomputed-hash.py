@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018-2019 The Jemcash Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+'''
+Generate src/primitives/precomputed_hash.h, the table of scrypt PoW hashes of
+the blocks mined before the switch to MTP, from a synced node.
+
+Headers are read with jemcash-cli from the genesis block up to the first MTP
+block, and hashed with the N factor schedule of GetNfactor().
+
+Usage:
+  gen-precomputed-hash.py [--cli jemcash-cli] [-- cli args] > src/primitives/precomputed_hash.h
+'''
+
+import argparse
+import hashlib
+import struct
+import subprocess
+import sys
+
+# Main chain parameters, see chainparams.cpp and definition.h
+GENESIS_BLOCK_TIME = 1554465600
+MTP_SWITCH_TIME = 1554466800
+CHAIN_START_TIME = 1551398400
+MIN_NFACTOR = 10
+MAX_NFACTOR = 30
+
+HEADER = '''\
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Generated by contrib/devtools/gen-precomputed-hash.py, do not edit.
+
+#ifndef BITCOIN_PRIMITIVES_PRECOMPUTED_HASH_H
+#define BITCOIN_PRIMITIVES_PRECOMPUTED_HASH_H
+
+/**
+ * Scrypt PoW hashes of the main chain blocks mined before the switch to MTP.
+ *
+ * One record per height starting at the genesis block: the 32 byte block hash
+ * followed by the 32 byte PoW hash, both in uint256 byte order. The block hash
+ * is matched before the PoW hash is used, see GetPrecomputedPoWHash().
+ */
+static const char precomputedPoWHashes[] =
+'''
+
+FOOTER = '''
+#endif // BITCOIN_PRIMITIVES_PRECOMPUTED_HASH_H
+'''
+
+def get_nfactor(ntime):
+    '''Port of GetNfactor() in primitives/block.cpp'''
+    if ntime <= CHAIN_START_TIME:
+        return MIN_NFACTOR
+    s = ntime - CHAIN_START_TIME
+    l = 0
+    while (s >> 1) > 3:
+        l += 1
+        s >>= 1
+    s &= 3
+    n = int((l * 158 + s * 28 - 2670) / 100)
+    n = max(n, 0) & 0xff
+    return min(max(n, MIN_NFACTOR), MAX_NFACTOR)
+
+def is_mtp(ntime):
+    return ntime > GENESIS_BLOCK_TIME and ntime >= MTP_SWITCH_TIME
+
+def scrypt_hash(header, nfactor):
+    n = 1 << (nfactor + 1)
+    return hashlib.scrypt(header, salt=header, n=n, r=1, p=1, maxmem=256 * n + (1 << 20), dklen=32)
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--cli', default='jemcash-cli', help='path to jemcash-cli')
+    parser.add_argument('cliargs', nargs='*', help='extra arguments for jemcash-cli, e.g. -datadir')
+    args = parser.parse_args()
+
+    def cli(*params):
+        return subprocess.check_output([args.cli] + args.cliargs + [str(p) for p in params]).decode().strip()
+
+    records = []
+    height = 0
+    while True:
+        try:
+            block_hash = cli('getblockhash', height)
+        except subprocess.CalledProcessError:
+            break
+        header = bytes.fromhex(cli('getblockheader', block_hash, 'false'))[:80]
+        ntime = struct.unpack('<I', header[68:72])[0]
+        if is_mtp(ntime):
+            break
+        hash_bytes = bytes.fromhex(block_hash)[::-1]
+        if hashlib.sha256(hashlib.sha256(header).digest()).digest() != hash_bytes:
+            sys.exit('header of block %d does not match its hash' % height)
+        records.append(hash_bytes + scrypt_hash(header, get_nfactor(ntime)))
+        height += 1
+        if height % 1000 == 0:
+            sys.stderr.write('%d blocks\n' % height)
+
+    sys.stderr.write('%d pre-MTP blocks\n' % len(records))
+    sys.stdout.write(HEADER)
+    data = b''.join(records)
+    if not data:
+        sys.stdout.write('    "";\n')
+    for i in range(0, len(data), 16):
+        line = ''.join('\\x%02x' % b for b in data[i:i + 16])
+        sys.stdout.write('    "%s"%s\n' % (line, ';' if i + 16 >= len(data) else ''))
+    sys.stdout.write(FOOTER)
+
+if __name__ == '__main__':
+    main()
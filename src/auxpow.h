@@ -37,8 +37,8 @@ public:
 
     bool Check(uint256 hashAuxBlock, int nChainID, bool fTestNet);
 
-    uint256 GetParentBlockHash(int height) {
-        return parentBlockHeader.GetPoWHash(height);
+    uint256 GetParentBlockHash() {
+        return parentBlockHeader.GetPoWHash();
     }
 };
 
@@ -0,0 +1,103 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "crypto/MerkleTreeProof/merkle-tree.hpp"
+
+extern "C" {
+#include "crypto/MerkleTreeProof/blake2/blake2.h"
+}
+
+/* Number of leaves of the benchmarked trees */
+static const size_t LEAF_COUNT = 64*1024;
+
+static std::vector<uint8_t> MakeLeaves()
+{
+    std::vector<uint8_t> leaves(LEAF_COUNT * MERKLE_TREE_ELEMENT_SIZE_B);
+    for (size_t i = 0; i < leaves.size(); i++)
+        leaves[i] = (uint8_t)(i * 7 + (i >> 8));
+    return leaves;
+}
+
+static void MerkleTreeBuild(benchmark::State& state)
+{
+    std::vector<uint8_t> leaves = MakeLeaves();
+    while (state.KeepRunning()) {
+        std::vector<uint8_t> buffer;
+        buffer.reserve(2 * leaves.size());
+        buffer = leaves;
+        MerkleTree tree(std::move(buffer));
+    }
+}
+
+static void MerkleTreeBuildElements(benchmark::State& state)
+{
+    std::vector<uint8_t> leaves = MakeLeaves();
+    MerkleTree::Elements elements;
+    for (size_t i = 0; i < LEAF_COUNT; i++)
+        elements.emplace_back(&leaves[i * MERKLE_TREE_ELEMENT_SIZE_B], &leaves[(i + 1) * MERKLE_TREE_ELEMENT_SIZE_B]);
+    while (state.KeepRunning()) {
+        MerkleTree tree(elements, true);
+    }
+}
+
+static void MerkleTreeProofForIndex(benchmark::State& state)
+{
+    MerkleTree tree(MakeLeaves());
+    std::vector<uint8_t> proof;
+    size_t index = 0;
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; i++) {
+            proof.clear();
+            tree.proofForIndex(index, proof);
+            index = (index * 1103515245 + 12345) % LEAF_COUNT;
+        }
+    }
+}
+
+static void MerkleTreeCheckProof(benchmark::State& state)
+{
+    std::vector<uint8_t> leaves = MakeLeaves();
+    MerkleTree tree(leaves);
+    std::vector<uint8_t> proof;
+    size_t size = tree.proofForIndex(LEAF_COUNT / 3, proof);
+    MerkleTree::Buffer root = tree.getRoot();
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; i++) {
+            MerkleTree::checkProofOrdered(proof.data(), size, root.data(),
+                    &leaves[(LEAF_COUNT / 3) * MERKLE_TREE_ELEMENT_SIZE_B], LEAF_COUNT / 3 + 1);
+        }
+    }
+}
+
+static void Blake2b4r_32b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(LEAF_COUNT * 32, 0);
+    std::vector<uint8_t> out(LEAF_COUNT * MERKLE_TREE_ELEMENT_SIZE_B);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < LEAF_COUNT; i++) {
+            blake2b_state S;
+            blake2b_init(&S, MERKLE_TREE_ELEMENT_SIZE_B);
+            blake2b_4r_update(&S, &in[i * 32], 32);
+            blake2b_4r_final(&S, &out[i * MERKLE_TREE_ELEMENT_SIZE_B], MERKLE_TREE_ELEMENT_SIZE_B);
+        }
+    }
+}
+
+static void Blake2b4rMany_32b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(LEAF_COUNT * 32, 0);
+    std::vector<uint8_t> out(LEAF_COUNT * MERKLE_TREE_ELEMENT_SIZE_B);
+    while (state.KeepRunning()) {
+        blake2b_4r_many(out.data(), MERKLE_TREE_ELEMENT_SIZE_B, in.data(), 32, LEAF_COUNT);
+    }
+}
+
+BENCHMARK(MerkleTreeBuild);
+BENCHMARK(MerkleTreeBuildElements);
+BENCHMARK(MerkleTreeProofForIndex);
+BENCHMARK(MerkleTreeCheckProof);
+
+BENCHMARK(Blake2b4r_32b);
+BENCHMARK(Blake2b4rMany_32b);
@@ -0,0 +1,140 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "crypto/MerkleTreeProof/mtp.h"
+#include "crypto/MerkleTreeProof/simd.h"
+#include "uint256.h"
+
+extern "C" {
+#include "crypto/MerkleTreeProof/blake2/blake2.h"
+}
+
+#include <memory>
+
+/*
+ * Throughput of the MTP primitives with every instruction set the CPU has.
+ * Benchmarks of instruction sets it lacks report nothing.
+ *
+ * The solve and verify benchmarks share one prepared arena of 4 GiB, filled
+ * once with the best instruction set.
+ */
+
+static const uint32_t EASY_TARGET = 0x2000ffff;
+static const uint256 POW_LIMIT = uint256S("00ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+/* Number of blocks hashed or permuted by each iteration */
+static const size_t BLOCK_COUNT = 1024;
+
+struct MTPBenchData
+{
+    char input[80];
+    mtp::Arena arena;
+    uint8_t hashRootMTP[16];
+    uint32_t nonce;
+    uint64_t blockMTP[mtp::MTP_L*2][128];
+    mtp::Proofs proofMTP;
+
+    MTPBenchData()
+    {
+        for (size_t i = 0; i < sizeof(input); i++)
+            input[i] = (char)(i * 29 + 3);
+        arena.Prepare(input);
+
+        std::atomic<bool> fStop(false);
+        std::atomic<uint64_t> nAttempts(0);
+        uint256 output;
+        arena.Search(EASY_TARGET, POW_LIMIT, 0, UINT32_MAX, fStop, nAttempts, nonce, output);
+        arena.Materialize(nonce, hashRootMTP, blockMTP, proofMTP);
+    }
+};
+
+static MTPBenchData& GetMTPBenchData()
+{
+    static std::unique_ptr<MTPBenchData> data(new MTPBenchData());
+    return *data;
+}
+
+/* Selects an instruction set for the lifetime of a benchmark */
+class MTPISAScope
+{
+    int previous;
+
+public:
+    explicit MTPISAScope(int isa) : previous(mtp_isa_current()) { mtp_isa_select(isa); }
+    ~MTPISAScope() { mtp_isa_select(previous); }
+};
+
+static void MTPVerify(benchmark::State& state, int isa)
+{
+    if (!mtp_isa_supported(isa))
+        return;
+    const MTPBenchData& data = GetMTPBenchData();
+    MTPISAScope scope(isa);
+    while (state.KeepRunning()) {
+        mtp::impl::mtp_verify(data.input, EASY_TARGET, data.hashRootMTP, data.nonce,
+                data.blockMTP, data.proofMTP, POW_LIMIT);
+    }
+}
+
+static void MTPSolve(benchmark::State& state, int isa)
+{
+    if (!mtp_isa_supported(isa))
+        return;
+    const MTPBenchData& data = GetMTPBenchData();
+    MTPISAScope scope(isa);
+    // Nothing hashes under this target, every nonce is tried
+    const uint32_t impossibleTarget = 0x03000001;
+    std::atomic<bool> fStop(false);
+    std::atomic<uint64_t> nAttempts(0);
+    uint32_t nonce;
+    uint256 output;
+    uint32_t nonceBegin = 0;
+    while (state.KeepRunning()) {
+        data.arena.Search(impossibleTarget, POW_LIMIT, nonceBegin, nonceBegin + 16,
+                fStop, nAttempts, nonce, output);
+        nonceBegin += 16;
+    }
+}
+
+static void Argon2Permute(benchmark::State& state, int isa)
+{
+    if (!mtp_isa_supported(isa))
+        return;
+    MTPISAScope scope(isa);
+    block R;
+    for (size_t i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++)
+        R.v[i] = i;
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BLOCK_COUNT; i++)
+            blamka_permute(&R);
+    }
+}
+
+static void Blake2bLeaves(benchmark::State& state, int isa)
+{
+    if (!mtp_isa_supported(isa))
+        return;
+    MTPISAScope scope(isa);
+    std::vector<uint8_t> in(BLOCK_COUNT * ARGON2_BLOCK_SIZE, 0);
+    std::vector<uint8_t> out(BLOCK_COUNT * MERKLE_TREE_ELEMENT_SIZE_B);
+    while (state.KeepRunning()) {
+        blake2b_4r_many(out.data(), MERKLE_TREE_ELEMENT_SIZE_B, in.data(), ARGON2_BLOCK_SIZE, BLOCK_COUNT);
+    }
+}
+
+#define MTP_BENCHMARKS(isa, name)                                                             \
+    static void MTPVerify_##name(benchmark::State& state) { MTPVerify(state, isa); }          \
+    static void MTPSolve_##name(benchmark::State& state) { MTPSolve(state, isa); }            \
+    static void Argon2Permute_##name(benchmark::State& state) { Argon2Permute(state, isa); }  \
+    static void Blake2bLeaves_##name(benchmark::State& state) { Blake2bLeaves(state, isa); }  \
+    BENCHMARK(MTPVerify_##name)                                                               \
+    BENCHMARK(MTPSolve_##name)                                                                \
+    BENCHMARK(Argon2Permute_##name)                                                           \
+    BENCHMARK(Blake2bLeaves_##name)
+
+MTP_BENCHMARKS(MTP_ISA_REF, ref)
+MTP_BENCHMARKS(MTP_ISA_SSE41, sse41)
+MTP_BENCHMARKS(MTP_ISA_AVX2, avx2)
+MTP_BENCHMARKS(MTP_ISA_AVX512, avx512)
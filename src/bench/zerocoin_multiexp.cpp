@@ -0,0 +1,74 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "libzerocoin/Zerocoin.h"
+#include "zerocoin.h"
+
+#include <vector>
+
+/*
+ * Products g^a * h^b * C^c modulo the accumulator modulus of ZCParamsV2, with
+ * exponents of accumulator proof sizes, where most of the spend verification
+ * time goes: one pow_mod per base, the simultaneous multi-exponentiation of
+ * mul_pow_mod, and multiExp with the precomputed powers of g and h.
+ */
+
+struct MultiExpBenchData
+{
+    const libzerocoin::IntegerGroupParams& group;
+    const CBigNum& modulus;
+    CBigNum base;
+    CBigNum gExp;
+    CBigNum hExp;
+    CBigNum exp;
+
+    MultiExpBenchData()
+        : group(ZCParamsV2->accumulatorParams.accumulatorQRNCommitmentGroup),
+          modulus(ZCParamsV2->accumulatorParams.accumulatorModulus)
+    {
+        base = CBigNum::randBignum(modulus);
+        gExp = CBigNum::randBignum(modulus * CBigNum(2).pow(300));
+        hExp = CBigNum::randBignum(modulus * CBigNum(2).pow(300));
+        exp = CBigNum::randBignum(CBigNum(2).pow(256));
+    }
+};
+
+static void ZerocoinMultiExpSeparate(benchmark::State& state)
+{
+    MultiExpBenchData data;
+    while (state.KeepRunning()) {
+        CBigNum result = data.group.g.pow_mod(data.gExp, data.modulus)
+                .mul_mod(data.group.h.pow_mod(data.hExp, data.modulus), data.modulus)
+                .mul_mod(data.base.pow_mod(data.exp, data.modulus), data.modulus);
+    }
+}
+
+static void ZerocoinMultiExpSimultaneous(benchmark::State& state)
+{
+    MultiExpBenchData data;
+    std::vector<CBigNum> bases, exps;
+    bases.push_back(data.group.g);
+    bases.push_back(data.group.h);
+    bases.push_back(data.base);
+    exps.push_back(data.gExp);
+    exps.push_back(data.hExp);
+    exps.push_back(data.exp);
+    while (state.KeepRunning()) {
+        CBigNum result = CBigNum::mul_pow_mod(bases, exps, data.modulus);
+    }
+}
+
+static void ZerocoinMultiExpPrecomputed(benchmark::State& state)
+{
+    MultiExpBenchData data;
+    std::vector<CBigNum> bases(1, data.base), exps(1, data.exp);
+    while (state.KeepRunning()) {
+        CBigNum result = data.group.multiExp(data.gExp, data.hExp, data.modulus, bases, exps);
+    }
+}
+
+BENCHMARK(ZerocoinMultiExpSeparate);
+BENCHMARK(ZerocoinMultiExpSimultaneous);
+BENCHMARK(ZerocoinMultiExpPrecomputed);
@@ -0,0 +1,97 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "libzerocoin/Zerocoin.h"
+#include "zerocoin_digestmap.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+ * Lookups of coin serials and public coins in the tables of the zerocoin
+ * state, half of them missing, against the unordered containers of CBigNum it
+ * used before. Their hash took bytes 8 to 15 of the number and put every
+ * number shorter than 24 bytes in the same bucket, which serials of 160 bits
+ * all are. Public coins are 1024 bits long.
+ */
+
+static const size_t SERIAL_COUNT = 10000;
+static const size_t PUBCOIN_COUNT = 20000;
+
+struct CBigNumMiddleBytesHash {
+    size_t operator()(const CBigNum& bn) const noexcept
+    {
+        std::vector<unsigned char> bnData = bn.ToBytes();
+        if (bnData.size() < sizeof(size_t) * 3)
+            return 0;
+        return ((size_t*)bnData.data())[1];
+    }
+};
+
+struct CMintedCoinBenchInfo {
+    int denomination;
+    int id;
+    int nHeight;
+};
+
+static void RandomNumbers(std::vector<CBigNum>& numbers, size_t nCount, int nBits)
+{
+    numbers.clear();
+    for (size_t i = 0; i < nCount; i++)
+        numbers.push_back(CBigNum::RandKBitBigum(nBits));
+}
+
+template<typename Container>
+static void Lookups(benchmark::State& state, const Container& container, const std::vector<CBigNum>& numbers)
+{
+    size_t i = 0, nFound = 0;
+    while (state.KeepRunning()) {
+        nFound += container.count(numbers[i]);
+        i = (i + 1) % numbers.size();
+    }
+}
+
+static void ZerocoinSerialLookupUnordered(benchmark::State& state)
+{
+    std::vector<CBigNum> serials;
+    RandomNumbers(serials, SERIAL_COUNT * 2, 160);
+    std::unordered_multiset<CBigNum, CBigNumMiddleBytesHash> usedSerials(serials.begin(), serials.begin() + SERIAL_COUNT);
+    Lookups(state, usedSerials, serials);
+}
+
+static void ZerocoinSerialLookupDigest(benchmark::State& state)
+{
+    std::vector<CBigNum> serials;
+    RandomNumbers(serials, SERIAL_COUNT * 2, 160);
+    CBigNumDigestSet usedSerials;
+    for (size_t i = 0; i < SERIAL_COUNT; i++)
+        usedSerials.insert(serials[i]);
+    Lookups(state, usedSerials, serials);
+}
+
+static void ZerocoinPubCoinLookupUnordered(benchmark::State& state)
+{
+    std::vector<CBigNum> pubCoins;
+    RandomNumbers(pubCoins, PUBCOIN_COUNT * 2, 1024);
+    std::unordered_multimap<CBigNum, CMintedCoinBenchInfo, CBigNumMiddleBytesHash> mintedPubCoins;
+    for (size_t i = 0; i < PUBCOIN_COUNT; i++)
+        mintedPubCoins.insert(std::make_pair(pubCoins[i], CMintedCoinBenchInfo()));
+    Lookups(state, mintedPubCoins, pubCoins);
+}
+
+static void ZerocoinPubCoinLookupDigest(benchmark::State& state)
+{
+    std::vector<CBigNum> pubCoins;
+    RandomNumbers(pubCoins, PUBCOIN_COUNT * 2, 1024);
+    CBigNumDigestMap<CMintedCoinBenchInfo> mintedPubCoins;
+    for (size_t i = 0; i < PUBCOIN_COUNT; i++)
+        mintedPubCoins.insert(pubCoins[i], CMintedCoinBenchInfo());
+    Lookups(state, mintedPubCoins, pubCoins);
+}
+
+BENCHMARK(ZerocoinSerialLookupUnordered);
+BENCHMARK(ZerocoinSerialLookupDigest);
+BENCHMARK(ZerocoinPubCoinLookupUnordered);
+BENCHMARK(ZerocoinPubCoinLookupDigest);
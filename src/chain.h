@@ -17,6 +17,7 @@
 #include "chainparams.h"
 #include "streams.h"
 
+#include <memory>
 #include <vector>
 
 
@@ -151,6 +152,102 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   96,
 
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
+
+    // Jemcash - MTP
+    BLOCK_POW_VERIFIED       =   256, //!< proof of work (and MTP proof) of block data in blk*.dat has been verified
+};
+
+/**
+ * Container allocated on the first insertion. Most blocks have no zerocoin transactions, their index entries keep
+ * a null pointer for every zerocoin field instead of an empty container. Serialized as the container itself
+ */
+template <typename Container>
+class CLazyContainer
+{
+private:
+    std::unique_ptr<Container> p;
+
+    static const Container &Empty() {
+        static const Container empty;
+        return empty;
+    }
+
+public:
+    typedef typename Container::key_type key_type;
+    typedef typename Container::value_type value_type;
+    //! Iteration is read only, changes go through get() or operator[]
+    typedef typename Container::const_iterator iterator;
+    typedef typename Container::const_iterator const_iterator;
+
+    CLazyContainer() {}
+    CLazyContainer(const CLazyContainer &other) : p(other.p ? new Container(*other.p) : NULL) {}
+    CLazyContainer(CLazyContainer &&other) : p(std::move(other.p)) {}
+
+    CLazyContainer &operator=(const CLazyContainer &other) {
+        if (this != &other)
+            p.reset(other.p ? new Container(*other.p) : NULL);
+        return *this;
+    }
+
+    CLazyContainer &operator=(CLazyContainer &&other) {
+        p = std::move(other.p);
+        return *this;
+    }
+
+    //! The container for changing it, allocated if needed
+    Container &get() {
+        if (!p)
+            p.reset(new Container());
+        return *p;
+    }
+
+    const Container &get() const { return p ? *p : Empty(); }
+
+    bool empty() const { return !p || p->empty(); }
+    size_t size() const { return p ? p->size() : 0; }
+    size_t count(const key_type &key) const { return p ? p->count(key) : 0; }
+
+    const_iterator begin() const { return get().begin(); }
+    const_iterator end() const { return get().end(); }
+    const_iterator find(const key_type &key) const { return p ? p->find(key) : Empty().end(); }
+
+    template <typename Key>
+    auto operator[](const Key &key) -> decltype(std::declval<Container&>()[key]) { return get()[key]; }
+
+    template <typename Value>
+    auto insert(Value &&value) -> decltype(std::declval<Container&>().insert(std::forward<Value>(value))) {
+        return get().insert(std::forward<Value>(value));
+    }
+
+    size_t erase(const key_type &key) {
+        if (!p)
+            return 0;
+        size_t n = p->erase(key);
+        if (p->empty())
+            p.reset();
+        return n;
+    }
+
+    void clear() { p.reset(); }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return ::GetSerializeSize(get(), nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        ::Serialize(s, get(), nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        std::unique_ptr<Container> container(new Container());
+        ::Unserialize(s, *container, nType, nVersion);
+        if (container->empty())
+            p.reset();
+        else
+            p = std::move(container);
+    }
 };
 
 /** The block chain is a tree shaped structure starting with the
@@ -210,22 +307,25 @@ public:
     // Reserved fields
     uint256 reserved[2];
 
+    //! Scrypt PoW hash of a pre-MTP header, null if not known. Kept under its own key of the block tree database
+    uint256 hashPoW;
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
 
     //! Public coin values of mints in this block, ordered by serialized value of public coin
     //! Maps <denomination,id> to vector of public coins
-    map<pair<int,int>, vector<CBigNum>> mintedPubCoins;
+    CLazyContainer<map<pair<int,int>, vector<CBigNum>>> mintedPubCoins;
 
     //! Accumulator updates. Contains only changes made by mints in this block
     //! Maps <denomination, id> to <accumulator value (CBigNum), number of such mints in this block>
-    map<pair<int,int>, pair<CBigNum,int>> accumulatorChanges;
+    CLazyContainer<map<pair<int,int>, pair<CBigNum,int>>> accumulatorChanges;
 	
 	//! Same as accumulatorChanges but for alternative modulus
-	map<pair<int,int>, pair<CBigNum,int>> alternativeAccumulatorChanges;
+	CLazyContainer<map<pair<int,int>, pair<CBigNum,int>>> alternativeAccumulatorChanges;
 	
     //! Values of coin serials spent in this block
-	set<CBigNum> spentSerials;
+	CLazyContainer<set<CBigNum>> spentSerials;
 
     void SetNull()
     {
@@ -250,9 +350,11 @@ public:
 
         nVersionMTP = 0;
         mtpHashValue = reserved[0] = reserved[1] = uint256();
+        hashPoW = uint256();
 
         mintedPubCoins.clear();
         accumulatorChanges.clear();
+        alternativeAccumulatorChanges.clear();
         spentSerials.clear();
     }
 
@@ -323,9 +425,11 @@ public:
         return *phashBlock;
     }
 
-    uint256 GetBlockPoWHash(bool forceCalc = false) const
+    uint256 GetBlockPoWHash() const
     {
-        return GetBlockHeader().GetPoWHash(nHeight, forceCalc);
+        if (!hashPoW.IsNull())
+            return hashPoW;
+        return GetBlockHeader().GetPoWHash();
     }
 
     int64_t GetBlockTime() const
@@ -247,6 +247,19 @@ public:
         assert(WIDTH >= 2);
         return pn[0] | (uint64_t)pn[1] << 32;
     }
+
+    /**
+     * Returns the remainder of the division by a 32 bit value. This is
+     * much cheaper than operator/= as only one limb is processed at a time.
+     */
+    uint32_t Mod32(uint32_t d) const
+    {
+        assert(d != 0);
+        uint64_t r = 0;
+        for (int i = WIDTH - 1; i >= 0; i--)
+            r = ((r << 32) | pn[i]) % d;
+        return (uint32_t)r;
+    }
     template<typename Stream>
     void Serialize(Stream& s, int nType, int nVersion) const
     {
@@ -66,6 +66,11 @@ enum {
         1 / !!(sizeof(blake2b_param) == sizeof(uint64_t) * CHAR_BIT)
 };
 
+/* Initialization vector and message schedule, shared with the vectorized
+ * kernels of simd.c */
+ARGON2_LOCAL extern const uint64_t blake2b_IV[8];
+ARGON2_LOCAL extern const unsigned int blake2b_sigma[12][16];
+
 /* Streaming API */
 ARGON2_LOCAL int blake2b_init(blake2b_state *S, size_t outlen);
 ARGON2_LOCAL int blake2b_init_key(blake2b_state *S, size_t outlen, const void *key,
@@ -85,6 +90,14 @@ ARGON2_LOCAL int blake2b_long(void *out, size_t outlen, const void *in, size_t i
 int blake2b_4r_final(blake2b_state *S, void *out, size_t outlen);
 int blake2b_4r_update(blake2b_state *S, const void *in, size_t inlen);
 
+/* Hash `count` messages of `inlen` bytes each, stored one after another in
+ * `in`, into `count` digests of `outlen` bytes stored one after another in
+ * `out`. Produces the same digests as blake2b_init(), blake2b_4r_update()
+ * and blake2b_4r_final() on every message, but processes several messages
+ * at once. */
+int blake2b_4r_many(void *out, size_t outlen, const void *in, size_t inlen,
+                    size_t count);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -21,14 +21,15 @@
 
 #include "blake2.h"
 #include "blake2-impl.h"
+#include "../simd.h"
 
-static const uint64_t blake2b_IV[8] = {
+const uint64_t blake2b_IV[8] = {
     UINT64_C(0x6a09e667f3bcc908), UINT64_C(0xbb67ae8584caa73b),
     UINT64_C(0x3c6ef372fe94f82b), UINT64_C(0xa54ff53a5f1d36f1),
     UINT64_C(0x510e527fade682d1), UINT64_C(0x9b05688c2b3e6c1f),
     UINT64_C(0x1f83d9abfb41bd6b), UINT64_C(0x5be0cd19137e2179)};
 
-static const unsigned int blake2b_sigma[12][16] = {
+const unsigned int blake2b_sigma[12][16] = {
     {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
     {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
     {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
@@ -172,6 +173,10 @@ static void blake2b_compress(blake2b_state *S, const uint8_t *block) {
         m[i] = load64(block + i * sizeof(m[i]));
     }
 
+    if (blake2b_compress_simd(S->h, m, S->t, S->f, 12)) {
+        return;
+    }
+
     for (i = 0; i < 8; ++i) {
         v[i] = S->h[i];
     }
@@ -230,6 +235,10 @@ static void blake2b_4r_compress(blake2b_state *S, const uint8_t *block) {
         m[i] = load64(block + i * sizeof(m[i]));
     }
 
+    if (blake2b_compress_simd(S->h, m, S->t, S->f, 4)) {
+        return;
+    }
+
     for (i = 0; i < 8; ++i) {
         v[i] = S->h[i];
     }
@@ -422,6 +431,153 @@ int blake2b_4r_final(blake2b_state *S, void *out, size_t outlen) {
 }
 
 
+/* Number of messages hashed side by side by blake2b_4r_many() */
+#define BLAKE2B_4R_LANES 4
+
+/* Compress one block for each of BLAKE2B_4R_LANES interleaved states. State
+ * and message words are stored as [word][lane] so that every step of G works
+ * on all lanes at once, which lets the compiler use vector instructions. All
+ * lanes share the same counter and finalization flag. */
+static void blake2b_4r_compress_lanes(uint64_t h[8][BLAKE2B_4R_LANES],
+                                      uint64_t m[16][BLAKE2B_4R_LANES],
+                                      uint64_t t, uint64_t f) {
+    uint64_t v[16][BLAKE2B_4R_LANES];
+    unsigned int i, r, l;
+
+    if (blake2b_compress_lanes_simd(h, (const uint64_t (*)[BLAKE2B_4R_LANES])m, t, f, 4)) {
+        return;
+    }
+
+    for (i = 0; i < 8; ++i) {
+        for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+            v[i][l] = h[i][l];
+            v[i + 8][l] = blake2b_IV[i];
+        }
+    }
+    for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+        v[12][l] ^= t;
+        v[14][l] ^= f;
+    }
+
+#define G(r, i, a, b, c, d)                                                    \
+    do {                                                                       \
+        const uint64_t *m0 = m[blake2b_sigma[r][2 * i + 0]];                   \
+        const uint64_t *m1 = m[blake2b_sigma[r][2 * i + 1]];                   \
+        for (l = 0; l < BLAKE2B_4R_LANES; ++l) {                               \
+            v[a][l] = v[a][l] + v[b][l] + m0[l];                               \
+            v[d][l] = rotr64(v[d][l] ^ v[a][l], 32);                           \
+            v[c][l] = v[c][l] + v[d][l];                                       \
+            v[b][l] = rotr64(v[b][l] ^ v[c][l], 24);                           \
+            v[a][l] = v[a][l] + v[b][l] + m1[l];                               \
+            v[d][l] = rotr64(v[d][l] ^ v[a][l], 16);                           \
+            v[c][l] = v[c][l] + v[d][l];                                       \
+            v[b][l] = rotr64(v[b][l] ^ v[c][l], 63);                           \
+        }                                                                      \
+    } while ((void)0, 0)
+
+#define ROUND(r)                                                               \
+    do {                                                                       \
+        G(r, 0, 0, 4, 8, 12);                                                  \
+        G(r, 1, 1, 5, 9, 13);                                                  \
+        G(r, 2, 2, 6, 10, 14);                                                 \
+        G(r, 3, 3, 7, 11, 15);                                                 \
+        G(r, 4, 0, 5, 10, 15);                                                 \
+        G(r, 5, 1, 6, 11, 12);                                                 \
+        G(r, 6, 2, 7, 8, 13);                                                  \
+        G(r, 7, 3, 4, 9, 14);                                                  \
+    } while ((void)0, 0)
+
+    for (r = 0; r < 4; ++r) {
+        ROUND(r);
+    }
+
+    for (i = 0; i < 8; ++i) {
+        for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+            h[i][l] = h[i][l] ^ v[i][l] ^ v[i + 8][l];
+        }
+    }
+
+#undef G
+#undef ROUND
+}
+
+int blake2b_4r_many(void *out, size_t outlen, const void *in, size_t inlen,
+                    size_t count) {
+    uint8_t *pout = (uint8_t *)out;
+    const uint8_t *pin = (const uint8_t *)in;
+    uint64_t h[8][BLAKE2B_4R_LANES];
+    uint64_t m[16][BLAKE2B_4R_LANES];
+    uint8_t buffer[BLAKE2B_BLOCKBYTES];
+    size_t nblocks = inlen ? (inlen + BLAKE2B_BLOCKBYTES - 1) / BLAKE2B_BLOCKBYTES : 1;
+    size_t n, b;
+    unsigned int i, l;
+
+    if ((outlen == 0) || (outlen > BLAKE2B_OUTBYTES)) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (out == NULL || in == NULL) {
+        return -1;
+    }
+
+    for (n = 0; n + BLAKE2B_4R_LANES <= count; n += BLAKE2B_4R_LANES) {
+        /* Same initial state as blake2b_init(): unkeyed, sequential mode */
+        for (i = 0; i < 8; ++i) {
+            for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+                h[i][l] = blake2b_IV[i];
+            }
+        }
+        for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+            h[0][l] ^= 0x01010000 ^ (uint64_t)outlen;
+        }
+
+        for (b = 0; b < nblocks; ++b) {
+            /* Like blake2b_4r_update(), the last block is only compressed by
+             * the final call even when it is full */
+            int last = (b + 1 == nblocks);
+            size_t offset = b * BLAKE2B_BLOCKBYTES;
+            size_t blocklen = last ? inlen - offset : BLAKE2B_BLOCKBYTES;
+
+            for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+                const uint8_t *block = pin + (n + l) * inlen + offset;
+                if (blocklen < BLAKE2B_BLOCKBYTES) {
+                    memset(buffer, 0, sizeof(buffer));
+                    if (blocklen) {
+                        memcpy(buffer, block, blocklen);
+                    }
+                    block = buffer;
+                }
+                for (i = 0; i < 16; ++i) {
+                    m[i][l] = load64(block + i * sizeof(m[i][l]));
+                }
+            }
+            blake2b_4r_compress_lanes(h, m, offset + blocklen,
+                                      last ? (uint64_t)-1 : 0);
+        }
+
+        for (l = 0; l < BLAKE2B_4R_LANES; ++l) {
+            uint8_t digest[BLAKE2B_OUTBYTES];
+            for (i = 0; i < 8; ++i) {
+                store64(digest + sizeof(h[i][l]) * i, h[i][l]);
+            }
+            memcpy(pout + (n + l) * outlen, digest, outlen);
+        }
+    }
+
+    /* Hash the messages that do not fill all the lanes one by one */
+    for (; n < count; ++n) {
+        blake2b_state S;
+        blake2b_init(&S, outlen);
+        blake2b_4r_update(&S, pin + n * inlen, inlen);
+        blake2b_4r_final(&S, pout + n * outlen, outlen);
+    }
+
+    return 0;
+}
+
+
 int blake2b(void *out, size_t outlen, const void *in, size_t inlen,
             const void *key, size_t keylen) {
     blake2b_state S;
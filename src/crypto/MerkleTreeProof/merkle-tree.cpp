@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iomanip>
 #include <algorithm>
+#include <cstring>
 #include "blake2/blake2.h"
 
 std::ostream& operator<<(std::ostream& os, const MerkleTree::Buffer& buffer)
@@ -21,6 +22,7 @@ MerkleTree::MerkleTree(const Elements& elements, bool preserveOrder)
         throw std::runtime_error("Empty elements list");
     }
 
+    Elements leaves;
     for (   Elements::const_iterator it = elements.begin();
             it != elements.end();
             ++it) {
@@ -35,16 +37,39 @@ MerkleTree::MerkleTree(const Elements& elements, bool preserveOrder)
         }
         if (!preserveOrder_) {
             // Check that this element has not been pushed yet
-            if (std::find(elements_.begin(), elements_.end(), *it)
-                    != elements_.end()) {
+            if (std::find(leaves.begin(), leaves.end(), *it)
+                    != leaves.end()) {
                 continue; // ignore duplicates
             }
         }
-        elements_.push_back(*it);
+        leaves.push_back(*it);
     } // for each element
 
     if (!preserveOrder_) {
-        std::sort(elements_.begin(), elements_.end()); // sort elements
+        std::sort(leaves.begin(), leaves.end()); // sort elements
+    }
+
+    nodes_.reserve(2 * leaves.size() * MERKLE_TREE_ELEMENT_SIZE_B);
+    for (   Elements::const_iterator it = leaves.begin();
+            it != leaves.end();
+            ++it) {
+        nodes_.insert(nodes_.end(), it->begin(), it->end());
+    }
+
+    getLayers();
+}
+
+MerkleTree::MerkleTree(std::vector<uint8_t> leaves)
+    : preserveOrder_(true), nodes_(std::move(leaves))
+{
+    if (nodes_.empty()) {
+        throw std::runtime_error("Empty elements list");
+    }
+    if (nodes_.size() % MERKLE_TREE_ELEMENT_SIZE_B) {
+        std::ostringstream oss;
+        oss << "Leaves size is " << nodes_.size() << ", it must be a multiple of "
+            << MERKLE_TREE_ELEMENT_SIZE_B;
+        throw std::runtime_error(oss.str());
     }
 
     getLayers();
@@ -58,9 +83,7 @@ MerkleTree::Buffer MerkleTree::hash(const Buffer& data)
 {
     blake2b_state state;
     blake2b_init(&state, MERKLE_TREE_ELEMENT_SIZE_B);
-    for (Buffer::const_iterator it = data.begin(); it != data.end(); ++it) {
-        blake2b_4r_update(&state, &(*it), sizeof(*it));
-    }
+    blake2b_4r_update(&state, data.data(), data.size());
     uint8_t digest[MERKLE_TREE_ELEMENT_SIZE_B];
     blake2b_4r_final(&state, digest, sizeof(digest));
     return Buffer(digest, digest + sizeof(digest));
@@ -88,18 +111,15 @@ MerkleTree::Buffer MerkleTree::merkleRoot(const Elements& elements,
 
 MerkleTree::Elements MerkleTree::getProof(const Buffer& element) const
 {
-    bool found = false;
-    size_t index;
-    for (size_t i = 0; (i < elements_.size()) && !found; ++i) {
-        if (elements_[i] == element) {
-            found = true;
-            index = i;
+    if (element.size() == MERKLE_TREE_ELEMENT_SIZE_B) {
+        for (size_t i = 0; i < size(); ++i) {
+            if (std::memcmp(node(0, i), element.data(),
+                        MERKLE_TREE_ELEMENT_SIZE_B) == 0) {
+                return proofForIndex(i);
+            }
         }
     }
-    if (!found) {
-        throw std::runtime_error("Element not found");
-    }
-    return getProof(index);
+    throw std::runtime_error("Element not found");
 }
 
 std::string MerkleTree::getProofHex(const Buffer& element) const
@@ -114,10 +134,27 @@ MerkleTree::Elements MerkleTree::getProofOrdered(const Buffer& element,
         throw std::runtime_error("Index is zero");
     }
     index--;
-    if ((index >= elements_.size()) || (elements_[index] != element)) {
+    if ((index >= size()) || (element.size() != MERKLE_TREE_ELEMENT_SIZE_B)
+            || (std::memcmp(node(0, index), element.data(),
+                    MERKLE_TREE_ELEMENT_SIZE_B) != 0)) {
         throw std::runtime_error("Index does not point to element");
     }
-    return getProof(index);
+    return proofForIndex(index);
+}
+
+size_t MerkleTree::getProofOrdered(const Buffer& element, size_t index,
+        std::vector<uint8_t>& proof) const
+{
+    if (index == 0) {
+        throw std::runtime_error("Index is zero");
+    }
+    index--;
+    if ((index >= size()) || (element.size() != MERKLE_TREE_ELEMENT_SIZE_B)
+            || (std::memcmp(node(0, index), element.data(),
+                    MERKLE_TREE_ELEMENT_SIZE_B) != 0)) {
+        throw std::runtime_error("Index does not point to element");
+    }
+    return proofForIndex(index, proof);
 }
 
 std::string MerkleTree::getProofOrderedHex(const Buffer& element,
@@ -126,6 +163,37 @@ std::string MerkleTree::getProofOrderedHex(const Buffer& element,
     return elementsToHex(getProofOrdered(element, index));
 }
 
+MerkleTree::Elements MerkleTree::proofForIndex(size_t index) const
+{
+    std::vector<uint8_t> flat;
+    size_t count = proofForIndex(index, flat);
+    Elements proof;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t *hash = &flat[i * MERKLE_TREE_ELEMENT_SIZE_B];
+        proof.emplace_back(hash, hash + MERKLE_TREE_ELEMENT_SIZE_B);
+    }
+    return proof;
+}
+
+size_t MerkleTree::proofForIndex(size_t index, std::vector<uint8_t>& proof) const
+{
+    if (index >= size()) {
+        throw std::runtime_error("Index out of range");
+    }
+    size_t count = 0;
+    for (size_t layer = 0; layer + 1 < layers_.size(); ++layer) {
+        size_t pairIndex = (index & 1) ? index - 1 : index + 1;
+        // The last hash of a layer with an odd size has no peer
+        if (pairIndex < layerSize(layer)) {
+            const uint8_t *pair = node(layer, pairIndex);
+            proof.insert(proof.end(), pair, pair + MERKLE_TREE_ELEMENT_SIZE_B);
+            ++count;
+        }
+        index = index / 2; // point to correct hash in next layer
+    } // for each layer
+    return count;
+}
+
 bool MerkleTree::checkProof(const Elements& proof, const Buffer& root,
         const Buffer& element)
 {
@@ -191,75 +259,95 @@ bool MerkleTree::checkProofOrdered(const Elements& proof,
     return tempHash == root;
 }
 
-void MerkleTree::getLayers()
+bool MerkleTree::checkProofOrdered(const uint8_t *proof, size_t proofSize,
+        const uint8_t root[MERKLE_TREE_ELEMENT_SIZE_B],
+        const uint8_t element[MERKLE_TREE_ELEMENT_SIZE_B], size_t index)
 {
-    layers_.clear();
-
-    // The first layer is the elements themselves
-    layers_.push_back(elements_);
+    --index; // `index` argument starts at 1
+    uint8_t tempHash[MERKLE_TREE_ELEMENT_SIZE_B];
+    std::memcpy(tempHash, element, MERKLE_TREE_ELEMENT_SIZE_B);
+    for (size_t i = 0; i < proofSize; ++i) {
+        size_t remaining = proofSize - i;
+        const uint8_t *node = proof + i * MERKLE_TREE_ELEMENT_SIZE_B;
 
-    if (elements_.empty()) {
-        return; // nothing left to do
-    }
+        // Same index adjustment as in the non-flat version above
+        while (((index & 1) == 0) && (index >= (1u << remaining))) {
+            index = index / 2;
+        }
 
-    // For subsequent layers, combine each pair of hashes in the previous
-    // layer to build the current layer. Repeat until the current layer has
-    // only one hash (this will be the root of the tree).
-    while (layers_.back().size() > 1) {
-        getNextLayer();
+        if (index & 1) {
+            combinedHashOrdered(node, tempHash, tempHash);
+        } else {
+            combinedHashOrdered(tempHash, node, tempHash);
+        }
+        index = index / 2;
     }
+    return std::memcmp(tempHash, root, MERKLE_TREE_ELEMENT_SIZE_B) == 0;
 }
 
-void MerkleTree::getNextLayer()
+void MerkleTree::combinedHashOrdered(const uint8_t *first,
+        const uint8_t *second, uint8_t *out)
 {
-    const Elements& previous_layer = layers_.back();
-
-    // Create a new empty layer
-    layers_.push_back(Elements());
-    Elements& current_layer = layers_.back();
-
-    // For each pair of elements in the previous layer
-    // NB: If there is an odd number of elements, we ignore the last one for now
-    for (size_t i = 0; i < (previous_layer.size() / 2); ++i) {
-        current_layer.push_back(combinedHash(previous_layer[2*i],
-                    previous_layer[2*i + 1], preserveOrder_));
-    }
+    uint8_t buffer[MERKLE_TREE_ELEMENT_SIZE_B * 2];
+    std::memcpy(buffer, first, MERKLE_TREE_ELEMENT_SIZE_B);
+    std::memcpy(buffer + MERKLE_TREE_ELEMENT_SIZE_B, second,
+            MERKLE_TREE_ELEMENT_SIZE_B);
 
-    // If there is an odd one out at the end, process it
-    // NB: It's on its own, so we don't combine it with anything
-    if (previous_layer.size() & 1) {
-        current_layer.push_back(previous_layer.back());
-    }
-}
-
-MerkleTree::Elements MerkleTree::getProof(size_t index) const
-{
-    Elements proof;
-    for (   Layers::const_iterator it = layers_.begin();
-            it != layers_.end();
-            ++it) {
-        Buffer pair;
-        if (getPair(*it, index, pair)) {
-            proof.push_back(pair);
-        }
-        index = index / 2; // point to correct hash in next layer
-    } // for each layer
-    return proof;
+    blake2b_state state;
+    blake2b_init(&state, MERKLE_TREE_ELEMENT_SIZE_B);
+    blake2b_4r_update(&state, buffer, sizeof(buffer));
+    blake2b_4r_final(&state, out, MERKLE_TREE_ELEMENT_SIZE_B);
 }
 
-bool MerkleTree::getPair(const Elements& layer, size_t index, Buffer& pair)
+void MerkleTree::getLayers()
 {
-    size_t pairIndex;
-    if (index & 1) {
-        pairIndex = index - 1;
-    } else {
-        pairIndex = index + 1;
+    // Every layer is half the size of the previous one, rounded up, so the
+    // size of the whole tree is known before hashing anything
+    layers_.clear();
+    layers_.push_back(0);
+    size_t count = nodes_.size() / MERKLE_TREE_ELEMENT_SIZE_B;
+    layers_.push_back(count);
+    while (count > 1) {
+        count = (count + 1) / 2;
+        layers_.push_back(layers_.back() + count);
     }
-    if (pairIndex >= layer.size()) {
-        return false;
+    nodes_.resize(layers_.back() * MERKLE_TREE_ELEMENT_SIZE_B);
+
+    // For subsequent layers, combine each pair of hashes in the previous
+    // layer to build the current layer. Repeat until the current layer has
+    // only one hash (this will be the root of the tree).
+    std::vector<uint8_t> swapped;
+    for (size_t layer = 1; layer + 1 < layers_.size(); ++layer) {
+        size_t previousSize = layerSize(layer - 1);
+        size_t pairs = previousSize / 2;
+        const uint8_t *previous = node(layer - 1, 0);
+        uint8_t *current = &nodes_[layers_[layer] * MERKLE_TREE_ELEMENT_SIZE_B];
+
+        // Pairs are consecutive in the previous layer, so they can be hashed
+        // in place, several at a time
+        if (!preserveOrder_) {
+            // Same order as `combinedHash()`: the greatest hash first
+            swapped.assign(previous,
+                    previous + pairs * 2 * MERKLE_TREE_ELEMENT_SIZE_B);
+            for (size_t i = 0; i < pairs; ++i) {
+                uint8_t *first = &swapped[2 * i * MERKLE_TREE_ELEMENT_SIZE_B];
+                uint8_t *second = first + MERKLE_TREE_ELEMENT_SIZE_B;
+                if (std::memcmp(first, second, MERKLE_TREE_ELEMENT_SIZE_B) <= 0) {
+                    std::swap_ranges(first, second, second);
+                }
+            }
+            previous = swapped.data();
+        }
+        blake2b_4r_many(current, MERKLE_TREE_ELEMENT_SIZE_B, previous,
+                2 * MERKLE_TREE_ELEMENT_SIZE_B, pairs);
+
+        // If there is an odd one out at the end, it goes up as it is
+        if (previousSize & 1) {
+            std::memcpy(current + pairs * MERKLE_TREE_ELEMENT_SIZE_B,
+                    node(layer - 1, previousSize - 1),
+                    MERKLE_TREE_ELEMENT_SIZE_B);
+        }
     }
-    pair = layer[pairIndex];
-    return true;
 }
 
 std::string MerkleTree::elementsToHex(const Elements& elements)
@@ -53,6 +53,21 @@ public :
      */
     MerkleTree(const Elements& elements, bool preserveOrder = false);
 
+    /** Constructor from consecutive hashes
+     *
+     * Builds a Merkle Tree with preserved order out of the hashes stored one
+     * after another in `leaves`. Unlike the constructor above, no element is
+     * skipped and the leaves are not copied one by one, which makes it the
+     * one to use for very large trees. If `leaves` has a capacity of at least
+     * twice its size, the tree is built without reallocating it.
+     *
+     * \param leaves [in] Hashes of `MERKLE_TREE_ELEMENT_SIZE_B` bytes each
+     *
+     * \throw `std::runtime_error` if `leaves` is empty or its size is not a
+     *        multiple of `MERKLE_TREE_ELEMENT_SIZE_B`
+     */
+    explicit MerkleTree(std::vector<uint8_t> leaves);
+
     /** Destructor */
     virtual ~MerkleTree();
 
@@ -78,7 +93,14 @@ public :
     /** Get the root hash of the Merkle Tree */
     Buffer getRoot() const
     {
-        return layers_.back()[0];
+        const uint8_t *root = node(layers_.size() - 2, 0);
+        return Buffer(root, root + MERKLE_TREE_ELEMENT_SIZE_B);
+    }
+
+    /** Number of leaves of the Merkle Tree */
+    size_t size() const
+    {
+        return layerSize(0);
     }
 
     /** Compute a root hash given a set of hashes
@@ -147,6 +169,23 @@ public :
      */
     Elements getProofOrdered(const Buffer& element, size_t index) const;
 
+    /** Get proof for a given element of a Merkle Tree with preserved order as flat data
+     *
+     * This function is similar to `getProofOrdered()`, but it appends hashes
+     * of the proof one after another to `proof` instead of allocating each
+     * of them separately.
+     *
+     * \param element [in]  Element to get the proof for
+     * \param index   [in]  Index of above element, starting at 1
+     * \param proof   [out] Buffer the proof is appended to
+     *
+     * \return The number of hashes appended
+     *
+     * \throw `std::runtime_error` if `index` does not point to `element`
+     */
+    size_t getProofOrdered(const Buffer& element, size_t index,
+            std::vector<uint8_t>& proof) const;
+
     /** Get proof in string form for a given element of a Merkle Tree with preserved order
      *
      * This function is similar to `getProofOrdered()`, but it will return the
@@ -164,6 +203,25 @@ public :
      */
     std::string getProofOrderedHex(const Buffer& element, size_t index) const;
 
+    /** Get proof for the element at a given position
+     *
+     * This function returns the same list of hashes as `getProofOrdered()`,
+     * but it only needs the position of the element. The hashes are looked
+     * up directly, one per layer.
+     *
+     * **IMPORTANT NOTE**: unlike `getProofOrdered()`, `index` starts at 0
+     *
+     * \throw `std::runtime_error` if `index` is out of range
+     */
+    Elements proofForIndex(size_t index) const;
+
+    /** Get proof for the element at a given position as flat data
+     *
+     * Same as `proofForIndex()` above, but appends the hashes one after
+     * another to `proof` and returns how many were appended.
+     */
+    size_t proofForIndex(size_t index, std::vector<uint8_t>& proof) const;
+
     /** Check the given proof for the given element
      *
      * This function will check that the given proof is valid for the given
@@ -199,46 +257,58 @@ public :
     static bool checkProofOrdered(const Elements& proof, const Buffer& root,
             const Buffer& element, size_t index);
 
+    /** Check the given flat proof for the given element in a Merkle Tree with order preserved
+     *
+     * This function is similar to `checkProofOrdered()`, but takes the proof
+     * as `proofSize` consecutive hashes and works without heap allocations.
+     *
+     * \param proof     [in] Hashes of the proof
+     * \param proofSize [in] Number of hashes in `proof`
+     * \param root      [in] Root hash of the Merke Tree
+     * \param element   [in] Element for which the proof is checked
+     * \param index     [in] Index of above element, starting at 1
+     *
+     * \return `true` if `proof` is valid, `false` if not
+     */
+    static bool checkProofOrdered(const uint8_t *proof, size_t proofSize,
+            const uint8_t root[MERKLE_TREE_ELEMENT_SIZE_B],
+            const uint8_t element[MERKLE_TREE_ELEMENT_SIZE_B], size_t index);
+
 private :
-    /** Layers data structure
+    bool preserveOrder_; /**< Whether to preserve the initial order */
+
+    /** Hashes of all the layers, one after another
      *
-     * This data structure represents the various layers of the Merkle Tree.
      * The first layer is the initial list of hashes, the 2nd layer is the
      * combination of the hashes of the first layer, etc. until the last layer
-     * which is the top-level hash, aka the root. The last layer has a length
-     * of one.
+     * which is the top-level hash, aka the root. Every layer has half the
+     * size of the previous one, rounded up, so the position of a hash is
+     * given by its layer and its index in that layer.
      */
-    typedef std::deque<Elements> Layers;
+    std::vector<uint8_t> nodes_;
 
-    bool     preserveOrder_; /**< Whether to preserve the initial order */
-    Elements elements_;      /**< Leaves of the Merkle Tree */
-    Layers   layers_;        /**< The various layers of the Merkle Tree */
+    /** Position in `nodes_` of the first hash of every layer, followed by
+     *  the total number of hashes */
+    std::vector<size_t> layers_;
 
-    /** Build the Merkle Tree layers */
-    void getLayers();
+    /** Get the hash at position `index` in layer `layer` */
+    const uint8_t *node(size_t layer, size_t index) const
+    {
+        return &nodes_[(layers_[layer] + index) * MERKLE_TREE_ELEMENT_SIZE_B];
+    }
 
-    /** Build the next Merkle Tree layer */
-    void getNextLayer();
+    /** Number of hashes in layer `layer` */
+    size_t layerSize(size_t layer) const
+    {
+        return layers_[layer + 1] - layers_[layer];
+    }
 
-    /** Get proof given the index of the element
-     *
-     * \param index [in] Index of the element to get the proof for
-     *
-     * \return The list of hashes that make up the proof
-     */
-    Elements getProof(size_t index) const;
+    /** Build the Merkle Tree layers on top of the leaves in `nodes_` */
+    void getLayers();
 
-    /** Get the peer of an element
-     *
-     * \param layer [in]  Layer to search
-     * \param index [in]  Index of element in layer
-     * \param pair  [out] Peer element
-     *
-     * \return `true` if OK, `false` if no peer element (this can happen if
-     *         the `layer` has an odd number of elements, and you are asking
-     *         for the last one, which obviously has no peer)
-     */
-    static bool getPair(const Elements& layer, size_t index, Buffer& pair);
+    /** Hash two ordered hashes into `out` without heap allocations */
+    static void combinedHashOrdered(const uint8_t *first, const uint8_t *second,
+            uint8_t *out);
 
     /** Converts a list of hashes into a hexadecimal string */
     static std::string elementsToHex(const Elements& elements);
@@ -13,14 +13,20 @@ extern "C" {
 #include <string.h>
 }
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include "merkle-tree.hpp"
 #include "primitives/block.h"
 #include "streams.h"
-#include <boost/multiprecision/cpp_int.hpp>
 #include <boost/numeric/conversion/cast.hpp>
+#include <boost/thread.hpp>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 
 using boost::numeric_cast;
 using boost::numeric::bad_numeric_cast;
@@ -48,6 +54,7 @@ void StoreBlock(void *output, const block *src)
     }
 }
 
+/** Fill the Argon2 memory `instance->memory`, which must already be allocated */
 int Argon2CtxMtp(argon2_context *context, argon2_type type,
         argon2_instance_t *instance)
 {
@@ -58,10 +65,18 @@ int Argon2CtxMtp(argon2_context *context, argon2_type type,
     if ((type != Argon2_d) && (type != Argon2_i) && (type != Argon2_id)) {
         return ARGON2_INCORRECT_TYPE;
     }
-    result = initialize(instance, context);
-    if (result != ARGON2_OK) {
-        return result;
-    }
+
+    // Same as initialize() but without allocating, `instance->memory` is
+    // provided by the caller so that it can be reused for several headers
+    instance->context_ptr = context;
+    uint8_t blockhash[ARGON2_PREHASH_SEED_LENGTH];
+    initial_hash(blockhash, context, instance->type);
+    clear_internal_memory(blockhash + ARGON2_PREHASH_DIGEST_LENGTH,
+            ARGON2_PREHASH_SEED_LENGTH - ARGON2_PREHASH_DIGEST_LENGTH);
+    std::memcpy(instance->hash_zero, blockhash, ARGON2_PREHASH_SEED_LENGTH);
+    fill_first_blocks(blockhash, instance);
+    clear_internal_memory(blockhash, ARGON2_PREHASH_SEED_LENGTH);
+
     result = fill_memory_blocks_mtp(instance, context);
     if (result != ARGON2_OK) {
         return result;
@@ -189,6 +204,29 @@ void compute_blake2b(const block& input,
     clear_internal_memory(tmp_block_bytes, ARGON2_BLOCK_SIZE);
 }
 
+/** Compute BLAKE2B hashes on consecutive blocks
+ *
+ * Same as calling `compute_blake2b()` on every block, but several blocks are
+ * hashed at once.
+ *
+ * \param input   [in]  Blocks to compute the hashes on
+ * \param count   [in]  Number of blocks
+ * \param digests [out] Computed hashes, one after another
+ */
+void compute_blake2b_many(const block *input, size_t count, uint8_t *digests)
+{
+    const size_t batch = 16;
+    uint8_t blocks_bytes[batch * ARGON2_BLOCK_SIZE];
+    for (size_t i = 0; i < count; i += batch) {
+        size_t n = std::min(batch, count - i);
+        for (size_t k = 0; k < n; ++k) {
+            StoreBlock(blocks_bytes + (k * ARGON2_BLOCK_SIZE), &input[i + k]);
+        }
+        blake2b_4r_many(digests + (i * MERKLE_TREE_ELEMENT_SIZE_B),
+                MERKLE_TREE_ELEMENT_SIZE_B, blocks_bytes, ARGON2_BLOCK_SIZE, n);
+    }
+}
+
 struct TargetHelper
 {
     bool m_negative;
@@ -203,23 +241,39 @@ struct TargetHelper
 
 } // unnamed namespace
 
+uint8_t *Proofs::Append(size_t size)
+{
+    assert(count < COUNT);
+    offsets[count + 1] = offsets[count] + size;
+    count++;
+    nodes.resize(offsets[count] * NODE_SIZE);
+    return Data(count - 1);
+}
+
+void Proofs::Append(const uint8_t *data, size_t size)
+{
+    std::memcpy(Append(size), data, size * NODE_SIZE);
+}
+
+void Proofs::Append(const MerkleTree &tree, size_t index)
+{
+    assert(count < COUNT);
+    size_t size = tree.proofForIndex(index, nodes);
+    offsets[count + 1] = offsets[count] + size;
+    count++;
+}
+
 namespace impl
 {
 
 bool mtp_verify(const char* input, const uint32_t target,
         const uint8_t hash_root_mtp[16], uint32_t nonce,
         const uint64_t block_mtp[MTP_L*2][128],
-        const std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3],
+        const Proofs& proof_mtp,
         uint256 pow_limit,
         uint256 *mtpHashValue)
 {
-    MerkleTree::Elements proof_blocks[L * 3];
-    MerkleTree::Buffer root;
     block blocks[L * 2];
-    root.insert(root.begin(), &hash_root_mtp[0], &hash_root_mtp[16]);
-    for (int i = 0; i < (L * 3); ++i) {
-        proof_blocks[i] = proof_mtp[i];
-    }
     for(int i = 0; i < (L * 2); ++i) {
         std::memcpy(blocks[i].v, block_mtp[i],
                 sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
@@ -302,9 +356,7 @@ bool mtp_verify(const char* input, const uint32_t target,
     // step 8
     for (uint32_t j = 1; j <= L; ++j) {
         // compute ij
-        std::string s = "0x" + y[j - 1].GetHex();
-        boost::multiprecision::uint256_t t(s);
-        uint32_t ij = numeric_cast<uint32_t>(t % M_COST);
+        uint32_t ij = UintToArith256(y[j - 1]).Mod32(M_COST);
 
         // retrieve x[ij-1] and x[phi(i)] from proof
         block prev_block, ref_block, t_prev_block, t_ref_block;
@@ -339,10 +391,9 @@ bool mtp_verify(const char* input, const uint32_t target,
         //hash[prev_index]
         uint8_t digest_prev[MERKLE_TREE_ELEMENT_SIZE_B];
         compute_blake2b(prev_block, digest_prev);
-        MerkleTree::Buffer hash_prev(digest_prev,
-                digest_prev + sizeof(digest_prev));
-        if (!MerkleTree::checkProofOrdered(proof_blocks[(j * 3) - 2],
-                    root, hash_prev, ij_prev + 1)) {
+        if (!MerkleTree::checkProofOrdered(proof_mtp.Data((j * 3) - 2),
+                    proof_mtp.Size((j * 3) - 2), hash_root_mtp, digest_prev,
+                    ij_prev + 1)) {
             LogPrintf("error : checkProofOrdered in x[ij_prev]\n");
             return false;
         }
@@ -371,9 +422,9 @@ bool mtp_verify(const char* input, const uint32_t target,
 
         uint8_t digest_ref[MERKLE_TREE_ELEMENT_SIZE_B];
         compute_blake2b(ref_block, digest_ref);
-        MerkleTree::Buffer hash_ref(digest_ref, digest_ref + sizeof(digest_ref));
-        if (!MerkleTree::checkProofOrdered(proof_blocks[(j * 3) - 1],
-                    root, hash_ref, computed_ref_block + 1)) {
+        if (!MerkleTree::checkProofOrdered(proof_mtp.Data((j * 3) - 1),
+                    proof_mtp.Size((j * 3) - 1), hash_root_mtp, digest_ref,
+                    computed_ref_block + 1)) {
             LogPrintf("error : checkProofOrdered in x[ij_ref]\n");
             return false;
         }
@@ -387,10 +438,10 @@ bool mtp_verify(const char* input, const uint32_t target,
         // hash x[ij]
         uint8_t digest_ij[MERKLE_TREE_ELEMENT_SIZE_B];
         compute_blake2b(block_ij, digest_ij);
-        MerkleTree::Buffer hash_ij(digest_ij, digest_ij + sizeof(digest_ij));
 
-        if (!MerkleTree::checkProofOrdered(proof_blocks[(j * 3) - 3], root,
-                    hash_ij, ij + 1)) {
+        if (!MerkleTree::checkProofOrdered(proof_mtp.Data((j * 3) - 3),
+                    proof_mtp.Size((j * 3) - 3), hash_root_mtp, digest_ij,
+                    ij + 1)) {
             LogPrintf("error : checkProofOrdered in x[ij]\n");
             return false;
         }
@@ -431,13 +482,202 @@ bool mtp_verify(const char* input, const uint32_t target,
     return true;
 }
 
-namespace {
-
-bool mtp_hash1(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
+void mtp_hash(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
         unsigned int& nonce, uint64_t block_mtp[MTP_L*2][128],
-        std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3], uint256 pow_limit,
+        Proofs& proof_mtp, uint256 pow_limit,
         uint256& output)
 {
+    Arena arena;
+    arena.Prepare(input);
+
+    // The memory only depends on the header, when no nonce fits the target
+    // the search starts over on the same memory
+    std::atomic<bool> fStop(false);
+    std::atomic<uint64_t> nAttempts(0);
+    uint32_t found;
+    while (!arena.Search(target, pow_limit, 0, UINT_MAX, fStop, nAttempts,
+                found, output)) {
+    }
+    nonce = found;
+    arena.Materialize(found, hash_root_mtp, block_mtp, proof_mtp);
+}
+
+}
+
+namespace 
+{
+void serializeMtpHeader(CDataStream & stream, CBlockHeader const & header)
+{
+    static_assert(
+                80 == sizeof(header.nVersion) + sizeof(header.hashPrevBlock)+ sizeof(header.hashMerkleRoot) 
+                    + sizeof(header.nTime) + sizeof(header.nBits) + sizeof(header.nVersionMTP)
+                , "The header data size for MTP hashing should be 80 bytes long."
+            );
+
+    stream << header.nVersion;
+    stream << header.hashPrevBlock;
+    stream << header.hashMerkleRoot;
+    stream << header.nTime;
+    stream << header.nBits;
+    stream << header.nVersionMTP;
+}
+}
+
+uint256 hash(CBlockHeader & blockHeader, uint256 const & powLimit)
+{
+    if(!blockHeader.mtpHashData)
+        blockHeader.mtpHashData = std::make_shared<CMTPHashData>();
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    serializeMtpHeader(ss, blockHeader);
+    
+    uint256 result;
+    impl::mtp_hash(reinterpret_cast<char*>(&ss[0]), blockHeader.nBits, blockHeader.mtpHashData->hashRootMTP
+            , blockHeader.nNonce, blockHeader.mtpHashData->nBlockMTP, blockHeader.mtpHashData->proofMTP, powLimit, result);
+    
+    return result;
+}
+
+
+bool verify(uint32_t nonce, CBlockHeader const & blockHeader, uint256 const & powLimit, uint256 *mtpHashValue)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    serializeMtpHeader(ss, blockHeader);
+
+    return impl::mtp_verify(reinterpret_cast<char*>(&ss[0]), blockHeader.nBits, blockHeader.mtpHashData->hashRootMTP
+            , nonce, blockHeader.mtpHashData->nBlockMTP, blockHeader.mtpHashData->proofMTP, powLimit, mtpHashValue);
+}
+
+namespace
+{
+
+/** Allocate `size` bytes for the Argon2 memory, preferring huge pages when asked
+ *
+ * \param fMapped [out] Whether the memory must be released with FreeArena()
+ *                      rather than free()
+ */
+block* AllocateArena(size_t size, bool fHugePages, bool& fMapped)
+{
+    fMapped = false;
+#ifndef WIN32
+#ifdef MAP_HUGETLB
+    if (fHugePages) {
+        void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            fMapped = true;
+            return static_cast<block*>(p);
+        }
+        LogPrintf("MTP: could not allocate huge pages, falling back to regular pages\n");
+    }
+#endif
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p != MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+        if (fHugePages)
+            madvise(p, size, MADV_HUGEPAGE);
+#endif
+        fMapped = true;
+        return static_cast<block*>(p);
+    }
+#endif
+    void* q = malloc(size);
+    if (!q)
+        throw std::bad_alloc();
+    return static_cast<block*>(q);
+}
+
+void FreeArena(block* memory, size_t size, bool fMapped)
+{
+#ifndef WIN32
+    if (fMapped) {
+        munmap(memory, size);
+        return;
+    }
+#endif
+    free(memory);
+}
+
+} // unnamed namespace
+
+struct Arena::Impl
+{
+    bool fHugePages;
+    block* memory;
+    size_t nMemorySize;
+    bool fMapped;
+
+    argon2_instance_t instance;
+    std::unique_ptr<MerkleTree> tree;
+    uint8_t hash_root_mtp[MERKLE_TREE_ELEMENT_SIZE_B];
+    char input[80];
+    bool fPrepared;
+
+    explicit Impl(bool fHugePagesIn)
+        : fHugePages(fHugePagesIn), memory(NULL), nMemorySize(0),
+          fMapped(false), fPrepared(false) {}
+
+    ~Impl()
+    {
+        if (memory)
+            FreeArena(memory, nMemorySize, fMapped);
+    }
+
+    /** Compute the chain of y for `nonce` and the index of the block opened
+     *  in every round
+     *
+     * \return `false` if the nonce opens one of the first blocks of a lane and
+     *         must be skipped
+     */
+    bool Chain(uint32_t nonce, uint256 y[L + 1], uint32_t ij_list[L]) const
+    {
+        blake2b_state state;
+        blake2b_init(&state, 32); // 256 bit
+        blake2b_update(&state, input, 80);
+        blake2b_update(&state, hash_root_mtp, MERKLE_TREE_ELEMENT_SIZE_B);
+        blake2b_update(&state, &nonce, sizeof(nonce));
+        blake2b_final(&state, &y[0], sizeof(uint256));
+
+        uint32_t const except_index = numeric_cast<uint32_t>(M_COST / LANES);
+        for (uint32_t j = 1; j <= L; ++j) {
+            uint32_t ij = UintToArith256(y[j - 1]).Mod32(M_COST);
+            if (((ij % except_index) == 0) || ((ij % except_index) == 1)) {
+                return false;
+            }
+            ij_list[j - 1] = ij;
+
+            uint8_t blockhash_bytes[ARGON2_BLOCK_SIZE];
+            StoreBlock(&blockhash_bytes, &memory[ij]);
+            blake2b_state ctx_yj;
+            blake2b_init(&ctx_yj, 32);
+            blake2b_update(&ctx_yj, &y[j - 1], 32);
+            blake2b_update(&ctx_yj, blockhash_bytes, ARGON2_BLOCK_SIZE);
+            blake2b_final(&ctx_yj, &y[j], 32);
+        }
+        return true;
+    }
+};
+
+Arena::Arena(bool fHugePages)
+    : impl(new Impl(fHugePages))
+{
+}
+
+Arena::~Arena()
+{
+}
+
+void Arena::Prepare(const char* input)
+{
+    if (impl->fPrepared
+            && std::memcmp(impl->input, input, sizeof(impl->input)) == 0) {
+        return;
+    }
+    impl->fPrepared = false;
+    // Release the previous tree before building the next one
+    impl->tree.reset();
+
 #define TEST_OUTLEN 32
 #define TEST_PWDLEN 80
 #define TEST_SALTLEN 80
@@ -483,7 +723,7 @@ bool mtp_hash1(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
     uint32_t segment_length = memory_blocks / (context.lanes * ARGON2_SYNC_POINTS);
     memory_blocks = segment_length * (context.lanes * ARGON2_SYNC_POINTS);
 
-    argon2_instance_t instance;
+    argon2_instance_t& instance = impl->instance;
     instance.version = context.version;
     instance.memory = NULL;
     instance.passes = context.t_cost;
@@ -497,207 +737,214 @@ bool mtp_hash1(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
         instance.threads = instance.lanes;
     }
 
+    if (!impl->memory) {
+        impl->nMemorySize = instance.memory_blocks * sizeof(block);
+        impl->memory = AllocateArena(impl->nMemorySize, impl->fHugePages,
+                impl->fMapped);
+    }
+    // Every block is written by the first pass, nothing needs to be cleared
+    // when the memory is reused
+    instance.memory = impl->memory;
+
     // step 1
     Argon2CtxMtp(&context, Argon2_d, &instance);
+    instance.context_ptr = NULL;
 
     // step 2
-    MerkleTree::Elements elements;
-    for (long int i = 0; i < instance.memory_blocks; ++i) {
-        uint8_t digest[MERKLE_TREE_ELEMENT_SIZE_B];
-        compute_blake2b(instance.memory[i], digest);
-        elements.emplace_back(digest, digest + sizeof(digest));
-    }
+    // Leave room for the upper layers, which are built in the same buffer
+    std::vector<uint8_t> leaves;
+    leaves.reserve(2 * instance.memory_blocks * MERKLE_TREE_ELEMENT_SIZE_B);
+    leaves.resize(instance.memory_blocks * MERKLE_TREE_ELEMENT_SIZE_B);
+    compute_blake2b_many(instance.memory, instance.memory_blocks, leaves.data());
+
+    impl->tree.reset(new MerkleTree(std::move(leaves)));
+    MerkleTree::Buffer root = impl->tree->getRoot();
+    std::copy(root.begin(), root.end(), impl->hash_root_mtp);
+
+    std::memcpy(impl->input, input, sizeof(impl->input));
+    impl->fPrepared = true;
+}
 
-    MerkleTree ordered_tree(elements, true);
-    MerkleTree::Buffer root = ordered_tree.getRoot();
-    std::copy(root.begin(), root.end(), hash_root_mtp);
+bool Arena::Search(uint32_t target, const uint256& pow_limit,
+        uint32_t nonceBegin, uint32_t nonceEnd,
+        const std::atomic<bool>& fStop, std::atomic<uint64_t>& nAttempts,
+        uint32_t& nonce, uint256& output) const
+{
+    assert(impl->fPrepared);
 
-    // step 3
-    unsigned int n_nonce_internal = 0;
     TargetHelper const bn_target(target);
+    if (bn_target.m_negative || (bn_target.m_target == 0) || bn_target.m_overflow
+            || (bn_target.m_target > UintToArith256(pow_limit))) {
+        return false;
+    }
 
-    // step 4
     uint256 y[L + 1];
-    block blocks[L * 2];
-    MerkleTree::Elements proof_blocks[L * 3];
-    while (true) {
-        if (n_nonce_internal == UINT_MAX) {
-            // go to create a new merkle tree
-            return false;
-        }
-
-        std::memset(&y[0], 0, sizeof(y));
-        std::memset(&blocks[0], 0, sizeof(sizeof(block) * L * 2));
-
-        blake2b_state state;
-        blake2b_init(&state, 32); // 256 bit
-        blake2b_update(&state, input, 80);
-        blake2b_update(&state, hash_root_mtp, MERKLE_TREE_ELEMENT_SIZE_B);
-        blake2b_update(&state, &n_nonce_internal, sizeof(unsigned int));
-        blake2b_final(&state, &y[0], sizeof(uint256));
-
-        // step 5
-        bool init_blocks = false;
-        for (uint32_t j = 1; j <= L; ++j) {
-            std::string s = "0x" + y[j - 1].GetHex();
-            boost::multiprecision::uint256_t t(s);
-            uint32_t ij = numeric_cast<uint32_t>(t % M_COST);
-            uint32_t except_index = numeric_cast<uint32_t>(M_COST / LANES);
-            if (((ij % except_index) == 0) || ((ij % except_index) == 1)) {
-                init_blocks = true;
-                break;
-            }
-
-            block blockhash;
-            copy_block(&blockhash, &instance.memory[ij]);
-            uint8_t blockhash_bytes[ARGON2_BLOCK_SIZE];
-            StoreBlock(&blockhash_bytes, &blockhash);
-            blake2b_state ctx_yj;
-            blake2b_init(&ctx_yj, 32);
-            blake2b_update(&ctx_yj, &y[j - 1], 32);
-            blake2b_update(&ctx_yj, blockhash_bytes, ARGON2_BLOCK_SIZE);
-            blake2b_final(&ctx_yj, &y[j], 32);
-            clear_internal_memory(blockhash.v, ARGON2_BLOCK_SIZE);
-            clear_internal_memory(blockhash_bytes, ARGON2_BLOCK_SIZE);
-
-            //storing blocks
-            uint32_t prev_index;
-            uint32_t ref_index;
-            GetBlockIndex(ij, &instance, &prev_index, &ref_index);
-            //previous block
-            copy_block(&blocks[(j * 2) - 2], &instance.memory[prev_index]);
-            //ref block
-            copy_block(&blocks[(j * 2) - 1], &instance.memory[ref_index]);
-
-            //storing proof
-            //TODO : make it as function please
-            //current proof
-            uint8_t digest_curr[MERKLE_TREE_ELEMENT_SIZE_B];
-            compute_blake2b(instance.memory[ij], digest_curr);
-            MerkleTree::Buffer hash_curr(digest_curr,
-                    digest_curr + sizeof(digest_curr));
-            MerkleTree::Elements proof_curr = ordered_tree.getProofOrdered(
-                    hash_curr, ij + 1);
-            proof_blocks[(j * 3) - 3] = proof_curr;
-
-            //prev proof
-            uint8_t digest_prev[MERKLE_TREE_ELEMENT_SIZE_B];
-            compute_blake2b(instance.memory[prev_index], digest_prev);
-            MerkleTree::Buffer hash_prev(digest_prev,
-                    digest_prev + sizeof(digest_prev));
-            MerkleTree::Elements proof_prev = ordered_tree.getProofOrdered(
-                    hash_prev, prev_index + 1);
-            proof_blocks[(j * 3) - 2] = proof_prev;
-
-            //ref proof
-            uint8_t digest_ref[MERKLE_TREE_ELEMENT_SIZE_B];
-            compute_blake2b(instance.memory[ref_index], digest_ref);
-            MerkleTree::Buffer hash_ref(digest_ref,
-                    digest_ref + sizeof(digest_ref));
-            MerkleTree::Elements proof_ref = ordered_tree.getProofOrdered(
-                    hash_ref, ref_index + 1);
-            proof_blocks[(j * 3) - 1] = proof_ref;
-        }
-
-        if (init_blocks) {
-            n_nonce_internal++;
+    uint32_t ij_list[L];
+    uint64_t nTried = 0;
+    bool fFound = false;
+    for (uint32_t n = nonceBegin; n < nonceEnd; ++n) {
+        if (fStop.load(std::memory_order_relaxed))
+            break;
+        ++nTried;
+        if (!impl->Chain(n, y, ij_list))
             continue;
-        }
-
-        // step 6
-        if (bn_target.m_negative || (bn_target.m_target == 0) || bn_target.m_overflow
-                || (bn_target.m_target > UintToArith256(pow_limit))
-                || (UintToArith256(y[L]) > bn_target.m_target)) {
-            n_nonce_internal++;
+        if (UintToArith256(y[L]) > bn_target.m_target)
             continue;
-        }
-
+        nonce = n;
+        output = y[L];
+        fFound = true;
         break;
     }
+    nAttempts += nTried;
+    return fFound;
+}
 
-    // step 7
-    std::copy(root.begin(), root.end(), hash_root_mtp);
-
-    nonce = n_nonce_internal;
-    for (int i = 0; i < L * 2; ++i) {
-        std::memcpy(block_mtp[i], &blocks[i],
-                sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
-    }
-    for (int i = 0; i < L * 3; ++i) {
-        proof_mtp[i] = proof_blocks[i];
-    }
-    std::memcpy(&output, &y[L], sizeof(uint256));
+void Arena::Materialize(uint32_t nonce, uint8_t hash_root_mtp[16],
+        uint64_t block_mtp[MTP_L*2][128], Proofs& proof_mtp) const
+{
+    assert(impl->fPrepared);
 
-    uint8_t h0[ARGON2_PREHASH_SEED_LENGTH];
-    std::memcpy(h0, instance.hash_zero,
-            sizeof(uint8_t) * ARGON2_PREHASH_SEED_LENGTH);
+    uint256 y[L + 1];
+    uint32_t ij_list[L];
+    bool fChained = impl->Chain(nonce, y, ij_list);
+    assert(fChained);
 
-    // get hash_zero
-    uint8_t h0_computed[ARGON2_PREHASH_SEED_LENGTH];
-    initial_hash(h0_computed, &context, instance.type);
-    
-    free_memory(&context, (uint8_t *)instance.memory, instance.memory_blocks, sizeof(block));
-    return true;
-}
+    std::memcpy(hash_root_mtp, impl->hash_root_mtp, MERKLE_TREE_ELEMENT_SIZE_B);
 
-} // unnamed namespace
+    // GetBlockIndex() does not modify the instance but takes it non-const
+    argon2_instance_t instance = impl->instance;
+    proof_mtp.Clear();
+    for (uint32_t j = 1; j <= L; ++j) {
+        uint32_t ij = ij_list[j - 1];
+
+        //storing blocks
+        uint32_t prev_index;
+        uint32_t ref_index;
+        GetBlockIndex(ij, &instance, &prev_index, &ref_index);
+        //previous block
+        std::memcpy(block_mtp[(j * 2) - 2], instance.memory[prev_index].v,
+                sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
+        //ref block
+        std::memcpy(block_mtp[(j * 2) - 1], instance.memory[ref_index].v,
+                sizeof(uint64_t) * ARGON2_QWORDS_IN_BLOCK);
 
-void mtp_hash(const char* input, uint32_t target, uint8_t hash_root_mtp[16],
-        unsigned int& nonce, uint64_t block_mtp[MTP_L*2][128],
-        std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3], uint256 pow_limit,
-        uint256& output)
-{
-    bool done = false;
-    while (!done) {
-        done = mtp_hash1(input, target, hash_root_mtp, nonce, block_mtp,
-                proof_mtp, pow_limit, output);
+        //storing proofs of current, previous and ref blocks
+        proof_mtp.Append(*impl->tree, ij);
+        proof_mtp.Append(*impl->tree, prev_index);
+        proof_mtp.Append(*impl->tree, ref_index);
     }
 }
 
-}
-
-namespace 
+MiningEngine::MiningEngine(int nThreadsIn, bool fHugePages)
+    : nThreads(std::max(nThreadsIn, 1)), arena(fHugePages), nAttempts(0),
+      nSolveAttemptsStart(0), nSolveStart(0), nSolveEnd(0)
 {
-void serializeMtpHeader(CDataStream & stream, CBlockHeader const & header)
-{
-    static_assert(
-                80 == sizeof(header.nVersion) + sizeof(header.hashPrevBlock)+ sizeof(header.hashMerkleRoot) 
-                    + sizeof(header.nTime) + sizeof(header.nBits) + sizeof(header.nVersionMTP)
-                , "The header data size for MTP hashing should be 80 bytes long."
-            );
-
-    stream << header.nVersion;
-    stream << header.hashPrevBlock;
-    stream << header.hashMerkleRoot;
-    stream << header.nTime;
-    stream << header.nBits;
-    stream << header.nVersionMTP;
-}
 }
 
-uint256 hash(CBlockHeader & blockHeader, uint256 const & powLimit)
+bool MiningEngine::Solve(CBlockHeader& blockHeader, uint256 const& powLimit,
+        const std::function<bool()>& fCancel, uint256& output)
 {
-    if(!blockHeader.mtpHashData)
-        blockHeader.mtpHashData = std::make_shared<CMTPHashData>();
-
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     serializeMtpHeader(ss, blockHeader);
-    
-    uint256 result;
-    impl::mtp_hash(reinterpret_cast<char*>(&ss[0]), blockHeader.nBits, blockHeader.mtpHashData->hashRootMTP
-            , blockHeader.nNonce, blockHeader.mtpHashData->nBlockMTP, blockHeader.mtpHashData->nProofMTP, powLimit, result);
-    
-    return result;
-}
+    arena.Prepare(reinterpret_cast<char*>(&ss[0]));
+
+    // Nonces are handed out in small chunks so that the threads stay busy
+    // until the end and notice a cancellation quickly
+    static const uint64_t CHUNK_SIZE = 256;
+    uint32_t const nBits = blockHeader.nBits;
+    std::atomic<uint64_t> nextNonce(blockHeader.nNonce);
+    std::atomic<bool> fStop(false);
+    boost::mutex cs;
+    boost::condition_variable cond;
+    int nRunning = nThreads;
+    bool fFound = false;
+    uint32_t nFoundNonce = 0;
+    uint256 foundHash;
+
+    nSolveAttemptsStart = nAttempts.load();
+    nSolveEnd = 0;
+    nSolveStart = GetTimeMicros();
+
+    auto worker = [&]() {
+        uint32_t nonce;
+        uint256 hash;
+        while (!fStop) {
+            uint64_t begin = nextNonce.fetch_add(CHUNK_SIZE);
+            if (begin >= UINT_MAX)
+                break;
+            uint64_t end = std::min<uint64_t>(begin + CHUNK_SIZE, UINT_MAX);
+            if (arena.Search(nBits, powLimit, static_cast<uint32_t>(begin),
+                        static_cast<uint32_t>(end), fStop, nAttempts,
+                        nonce, hash)) {
+                boost::lock_guard<boost::mutex> lock(cs);
+                if (!fFound) {
+                    fFound = true;
+                    nFoundNonce = nonce;
+                    foundHash = hash;
+                }
+                fStop = true;
+            }
+        }
+        boost::lock_guard<boost::mutex> lock(cs);
+        nRunning--;
+        cond.notify_all();
+    };
+
+    std::vector<boost::thread> threads;
+    bool fCancelled = false;
+    try {
+        for (int i = 0; i < nThreads; i++)
+            threads.emplace_back(worker);
+        while (true) {
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                if (nRunning == 0)
+                    break;
+                cond.timed_wait(lock, boost::posix_time::milliseconds(100));
+                if (nRunning == 0)
+                    break;
+            }
+            if (!fStop && fCancel()) {
+                fCancelled = true;
+                fStop = true;
+            }
+        }
+    } catch (...) {
+        fStop = true;
+        for (boost::thread& t : threads)
+            t.join();
+        throw;
+    }
+    for (boost::thread& t : threads)
+        t.join();
+    nSolveEnd = GetTimeMicros();
 
+    if (!fFound) {
+        if (!fCancelled)
+            blockHeader.nNonce = UINT_MAX;
+        return false;
+    }
 
-bool verify(uint32_t nonce, CBlockHeader const & blockHeader, uint256 const & powLimit, uint256 *mtpHashValue)
-{
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    serializeMtpHeader(ss, blockHeader);
+    if (!blockHeader.mtpHashData)
+        blockHeader.mtpHashData = std::make_shared<CMTPHashData>();
+    blockHeader.nNonce = nFoundNonce;
+    arena.Materialize(nFoundNonce, blockHeader.mtpHashData->hashRootMTP,
+            blockHeader.mtpHashData->nBlockMTP, blockHeader.mtpHashData->proofMTP);
+    output = foundHash;
+    return true;
+}
 
-    return impl::mtp_verify(reinterpret_cast<char*>(&ss[0]), blockHeader.nBits, blockHeader.mtpHashData->hashRootMTP
-            , nonce, blockHeader.mtpHashData->nBlockMTP, blockHeader.mtpHashData->nProofMTP, powLimit, mtpHashValue);
+double MiningEngine::GetHashRate() const
+{
+    int64_t nStart = nSolveStart;
+    int64_t nEnd = nSolveEnd;
+    if (nStart == 0)
+        return 0;
+    if (nEnd == 0)
+        nEnd = GetTimeMicros();
+    if (nEnd <= nStart)
+        return 0;
+    return (nAttempts - nSolveAttemptsStart) * 1e6 / (nEnd - nStart);
 }
 
-}
\ No newline at end of file
+}
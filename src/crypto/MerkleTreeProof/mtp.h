@@ -5,7 +5,12 @@ extern "C" {
 #include <inttypes.h>
 }
 #include "uint256.h"
+#include "merkle-tree.hpp"
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <functional>
+#include <memory>
 #include <vector>
 
 class CBlockHeader;
@@ -16,6 +21,60 @@ namespace mtp
 /** L parameter for the MTP hash */
 constexpr int8_t MTP_L = 64;
 
+/** Merkle proofs for every block opened by MTP
+ *
+ * Nodes of all MTP_L*3 proofs are stored one after another in a single buffer
+ * of MERKLE_TREE_ELEMENT_SIZE_B byte hashes, proof i occupies nodes
+ * [offsets[i], offsets[i+1]). Proofs are added in order with Append().
+ */
+class Proofs
+{
+public:
+    static constexpr int COUNT = MTP_L * 3;
+    static constexpr size_t NODE_SIZE = MERKLE_TREE_ELEMENT_SIZE_B;
+
+    Proofs() { Clear(); }
+
+    /** Remove all the proofs */
+    void Clear()
+    {
+        nodes.clear();
+        count = 0;
+        offsets[0] = 0;
+    }
+
+    /** Number of proofs added so far */
+    int Count() const { return count; }
+
+    /** Number of nodes in proof `i`, proofs not added yet are empty */
+    size_t Size(int i) const { return i < count ? offsets[i + 1] - offsets[i] : 0; }
+
+    /** Nodes of proof `i`, Size(i)*NODE_SIZE bytes */
+    const uint8_t *Data(int i) const { return nodes.data() + (i < count ? offsets[i] : 0) * NODE_SIZE; }
+    uint8_t *Data(int i) { return nodes.data() + (i < count ? offsets[i] : 0) * NODE_SIZE; }
+
+    /** Add next proof of `size` nodes and return the buffer to fill it in */
+    uint8_t *Append(size_t size);
+
+    /** Add next proof given as `size` consecutive nodes */
+    void Append(const uint8_t *data, size_t size);
+
+    /** Add proof of the leaf at `index` (starting at 0) in `tree` as next proof */
+    void Append(const MerkleTree &tree, size_t index);
+
+    bool operator==(const Proofs &other) const
+    {
+        return count == other.count
+            && std::equal(offsets, offsets + count + 1, other.offsets)
+            && nodes == other.nodes;
+    }
+
+private:
+    std::vector<uint8_t> nodes;
+    uint32_t offsets[COUNT + 1];
+    int count;
+};
+
 /** Solve the hash problem
  *
  * This function will try different nonce until it finds one such that the
@@ -38,6 +97,87 @@ uint256 hash(CBlockHeader & blockHeader, uint256 const & powLimit);
  */
 bool verify(uint32_t nonce, CBlockHeader const & blockHeader, uint256 const & powLimit, uint256 *mtpHashValue=nullptr);
 
+/** Argon2 memory and Merkle tree of one MTP header
+ *
+ * Filling the memory and building the tree over it is the expensive part of
+ * solving a header, and only depends on the header without its nonce. They
+ * are kept here so that several threads can search nonces for the same
+ * header while sharing them read-only. The memory is allocated once and
+ * reused for the following headers.
+ */
+class Arena
+{
+public:
+    /** \param fHugePages [in] Ask for the memory to be backed by huge pages
+     *                         where the platform supports it */
+    explicit Arena(bool fHugePages = false);
+    ~Arena();
+
+    /** Fill the memory and build the Merkle tree for the serialized header
+     *  `input` of 80 bytes; does nothing if it is already prepared for it */
+    void Prepare(const char* input);
+
+    /** Search nonces in [nonceBegin, nonceEnd) for a hash not above `target`
+     *
+     * Gives up as soon as `fStop` is set. `nAttempts` is increased by the
+     * number of nonces tried.
+     *
+     * \return `true` with `nonce` and `output` set if a solution was found
+     */
+    bool Search(uint32_t target, const uint256& pow_limit, uint32_t nonceBegin,
+            uint32_t nonceEnd, const std::atomic<bool>& fStop,
+            std::atomic<uint64_t>& nAttempts, uint32_t& nonce,
+            uint256& output) const;
+
+    /** Gather the opened blocks and their proofs for a nonce found by Search() */
+    void Materialize(uint32_t nonce, uint8_t hash_root_mtp[16],
+            uint64_t block_mtp[MTP_L*2][128], Proofs& proof_mtp) const;
+
+private:
+    struct Impl;
+    std::unique_ptr<Impl> impl;
+};
+
+/** Multi-threaded MTP solver
+ *
+ * Splits the nonce space of a header between worker threads sharing one
+ * Arena. Statistics are kept over the lifetime of the engine.
+ */
+class MiningEngine
+{
+public:
+    MiningEngine(int nThreads, bool fHugePages = false);
+
+    /** Solve `blockHeader`, starting at its nonce
+     *
+     * `fCancel` is polled regularly on the calling thread, not on the
+     * workers, and the search is abandoned once it returns `true`. On success
+     * the nonce and the MTP data of the header are set and the hash is stored
+     * in `output`. If the nonce space is exhausted, the nonce of the header is
+     * set to its maximum value.
+     *
+     * \return `true` if a solution was found
+     */
+    bool Solve(CBlockHeader& blockHeader, uint256 const& powLimit,
+            const std::function<bool()>& fCancel, uint256& output);
+
+    /** Number of nonces tried so far */
+    uint64_t GetAttempts() const { return nAttempts; }
+
+    /** Nonces tried per second while solving the current or last header */
+    double GetHashRate() const;
+
+    int GetThreads() const { return nThreads; }
+
+private:
+    const int nThreads;
+    Arena arena;
+    std::atomic<uint64_t> nAttempts;
+    std::atomic<uint64_t> nSolveAttemptsStart;
+    std::atomic<int64_t> nSolveStart;
+    std::atomic<int64_t> nSolveEnd;
+};
+
 
 //Implementation details
 namespace impl
@@ -62,7 +202,7 @@ void mtp_hash(const char* input,
         uint8_t hash_root_mtp[16],
         unsigned int& nonce,
         uint64_t block_mtp[MTP_L*2][128],
-        std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3],
+        Proofs& proof_mtp,
         uint256 pow_limit,
         uint256& output);
 
@@ -86,7 +226,7 @@ bool mtp_verify(const char* input,
         const uint8_t hash_root_mtp[16],
         const uint32_t nonce,
         const uint64_t block_mtp[MTP_L*2][128],
-        const std::deque<std::vector<uint8_t>> proof_mtp[MTP_L*3],
+        const Proofs& proof_mtp,
         uint256 pow_limit,
         uint256 *mtpHashValue=nullptr);
 }
@@ -15,6 +15,7 @@
 
 #include "argon2.h"
 #include "core.h"
+#include "simd.h"
 
 #include "blake2/blamka-round-ref.h"
 #include "blake2/blake2-impl.h"
@@ -32,7 +33,6 @@
 static void fill_block_mtp(const block *prev_block, const block *ref_block,
                        block *next_block, int with_xor, uint32_t block_index, uint8_t * hash_zero) {
     block blockR, block_tmp;
-    unsigned i;
 
     /*
     printf("\n");
@@ -62,29 +62,8 @@ static void fill_block_mtp(const block *prev_block, const block *ref_block,
     memcpy(&blockR.v[18], hash_zero + 16, sizeof(uint64_t));
     memcpy(&blockR.v[19], hash_zero + 24, sizeof(uint64_t));
 
-    /* Apply Blake2 on columns of 64-bit words: (0,1,...,15) , then
-       (16,17,..31)... finally (112,113,...127) */
-    for (i = 0; i < 8; ++i) {
-        BLAKE2_ROUND_NOMSG(
-            blockR.v[16 * i], blockR.v[16 * i + 1], blockR.v[16 * i + 2],
-            blockR.v[16 * i + 3], blockR.v[16 * i + 4], blockR.v[16 * i + 5],
-            blockR.v[16 * i + 6], blockR.v[16 * i + 7], blockR.v[16 * i + 8],
-            blockR.v[16 * i + 9], blockR.v[16 * i + 10], blockR.v[16 * i + 11],
-            blockR.v[16 * i + 12], blockR.v[16 * i + 13], blockR.v[16 * i + 14],
-            blockR.v[16 * i + 15]);
-    }
-
-    /* Apply Blake2 on rows of 64-bit words: (0,1,16,17,...112,113), then
-       (2,3,18,19,...,114,115).. finally (14,15,30,31,...,126,127) */
-    for (i = 0; i < 8; i++) {
-        BLAKE2_ROUND_NOMSG(
-            blockR.v[2 * i], blockR.v[2 * i + 1], blockR.v[2 * i + 16],
-            blockR.v[2 * i + 17], blockR.v[2 * i + 32], blockR.v[2 * i + 33],
-            blockR.v[2 * i + 48], blockR.v[2 * i + 49], blockR.v[2 * i + 64],
-            blockR.v[2 * i + 65], blockR.v[2 * i + 80], blockR.v[2 * i + 81],
-            blockR.v[2 * i + 96], blockR.v[2 * i + 97], blockR.v[2 * i + 112],
-            blockR.v[2 * i + 113]);
-    }
+    /* Apply Blake2 on columns of 64-bit words, then on rows */
+    blamka_permute(&blockR);
 
     copy_block(next_block, &block_tmp);
     xor_block(next_block, &blockR);
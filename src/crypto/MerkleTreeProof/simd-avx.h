@@ -0,0 +1,181 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/*
+ * Kernels on 256 bit vectors, included by simd.c once for every instruction
+ * set with SIMD_ATTR, SIMD_FUNC() and the ROTR64_*() rotations defined. Each
+ * vector holds 4 words: a row of the 4x4 Blake2 state, or the same word of 4
+ * Blake2b states.
+ */
+
+#define LOAD_256(p) _mm256_loadu_si256((const __m256i *)(p))
+#define STORE_256(p, x) _mm256_storeu_si256((__m256i *)(p), (x))
+
+/* Two 128 bit halves from unrelated places */
+#define LOAD_PAIRS_256(lo, hi)                                                 \
+    _mm256_inserti128_si256(                                                   \
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(lo))),        \
+        _mm_loadu_si128((const __m128i *)(hi)), 1)
+#define STORE_PAIRS_256(lo, hi, x)                                             \
+    do {                                                                       \
+        _mm_storeu_si128((__m128i *)(lo), _mm256_castsi256_si128(x));          \
+        _mm_storeu_si128((__m128i *)(hi), _mm256_extracti128_si256(x, 1));     \
+    } while ((void)0, 0)
+
+/* fBlaMka() */
+#define BLAMKA_256(x, y)                                                       \
+    _mm256_add_epi64(_mm256_add_epi64((x), (y)),                               \
+                     _mm256_slli_epi64(_mm256_mul_epu32((x), (y)), 1))
+
+#define G_BLAMKA_256(a, b, c, d)                                               \
+    do {                                                                       \
+        a = BLAMKA_256(a, b);                                                  \
+        d = ROTR64_32(_mm256_xor_si256(d, a));                                 \
+        c = BLAMKA_256(c, d);                                                  \
+        b = ROTR64_24(_mm256_xor_si256(b, c));                                 \
+        a = BLAMKA_256(a, b);                                                  \
+        d = ROTR64_16(_mm256_xor_si256(d, a));                                 \
+        c = BLAMKA_256(c, d);                                                  \
+        b = ROTR64_63(_mm256_xor_si256(b, c));                                 \
+    } while ((void)0, 0)
+
+#define G_BLAKE2B_256(a, b, c, d, m0, m1)                                      \
+    do {                                                                       \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m0);                      \
+        d = ROTR64_32(_mm256_xor_si256(d, a));                                 \
+        c = _mm256_add_epi64(c, d);                                            \
+        b = ROTR64_24(_mm256_xor_si256(b, c));                                 \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m1);                      \
+        d = ROTR64_16(_mm256_xor_si256(d, a));                                 \
+        c = _mm256_add_epi64(c, d);                                            \
+        b = ROTR64_63(_mm256_xor_si256(b, c));                                 \
+    } while ((void)0, 0)
+
+/* Line the diagonals of the rows up in the lanes, and back */
+#define DIAGONALIZE_256(b, c, d)                                               \
+    do {                                                                       \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1));              \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));              \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3));              \
+    } while ((void)0, 0)
+
+#define UNDIAGONALIZE_256(b, c, d)                                             \
+    do {                                                                       \
+        b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3));              \
+        c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2));              \
+        d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1));              \
+    } while ((void)0, 0)
+
+#define BLAMKA_ROUND_256(a, b, c, d)                                           \
+    do {                                                                       \
+        G_BLAMKA_256(a, b, c, d);                                              \
+        DIAGONALIZE_256(b, c, d);                                              \
+        G_BLAMKA_256(a, b, c, d);                                              \
+        UNDIAGONALIZE_256(b, c, d);                                            \
+    } while ((void)0, 0)
+
+SIMD_ATTR static void SIMD_FUNC(blamka_permute)(block *R) {
+    __m256i a, b, c, d;
+    unsigned int i;
+
+    /* Columns: words 16 * i to 16 * i + 15, one row per vector */
+    for (i = 0; i < 8; ++i) {
+        uint64_t *v = R->v + 16 * i;
+        a = LOAD_256(v);
+        b = LOAD_256(v + 4);
+        c = LOAD_256(v + 8);
+        d = LOAD_256(v + 12);
+        BLAMKA_ROUND_256(a, b, c, d);
+        STORE_256(v, a);
+        STORE_256(v + 4, b);
+        STORE_256(v + 8, c);
+        STORE_256(v + 12, d);
+    }
+
+    /* Rows: pairs of words 2 * i and 2 * i + 1 of every 16 */
+    for (i = 0; i < 8; ++i) {
+        uint64_t *v = R->v + 2 * i;
+        a = LOAD_PAIRS_256(v, v + 16);
+        b = LOAD_PAIRS_256(v + 32, v + 48);
+        c = LOAD_PAIRS_256(v + 64, v + 80);
+        d = LOAD_PAIRS_256(v + 96, v + 112);
+        BLAMKA_ROUND_256(a, b, c, d);
+        STORE_PAIRS_256(v, v + 16, a);
+        STORE_PAIRS_256(v + 32, v + 48, b);
+        STORE_PAIRS_256(v + 64, v + 80, c);
+        STORE_PAIRS_256(v + 96, v + 112, d);
+    }
+}
+
+#define MSG_256(s, i0, i1, i2, i3)                                             \
+    _mm256_setr_epi64x((long long)m[s[i0]], (long long)m[s[i1]],               \
+                       (long long)m[s[i2]], (long long)m[s[i3]])
+
+SIMD_ATTR static void SIMD_FUNC(blake2b_compress)(uint64_t h[8], const uint64_t m[16],
+                                                 const uint64_t t[2], const uint64_t f[2],
+                                                 unsigned int rounds) {
+    __m256i a = LOAD_256(h);
+    __m256i b = LOAD_256(h + 4);
+    __m256i c = LOAD_256(blake2b_IV);
+    __m256i d = _mm256_xor_si256(LOAD_256(blake2b_IV + 4),
+                                 _mm256_setr_epi64x((long long)t[0], (long long)t[1],
+                                                    (long long)f[0], (long long)f[1]));
+    unsigned int r;
+
+    for (r = 0; r < rounds; ++r) {
+        const unsigned int *s = blake2b_sigma[r];
+        G_BLAKE2B_256(a, b, c, d, MSG_256(s, 0, 2, 4, 6), MSG_256(s, 1, 3, 5, 7));
+        DIAGONALIZE_256(b, c, d);
+        G_BLAKE2B_256(a, b, c, d, MSG_256(s, 8, 10, 12, 14), MSG_256(s, 9, 11, 13, 15));
+        UNDIAGONALIZE_256(b, c, d);
+    }
+
+    STORE_256(h, _mm256_xor_si256(LOAD_256(h), _mm256_xor_si256(a, c)));
+    STORE_256(h + 4, _mm256_xor_si256(LOAD_256(h + 4), _mm256_xor_si256(b, d)));
+}
+
+SIMD_ATTR static void SIMD_FUNC(blake2b_compress_lanes)(uint64_t h[8][4], const uint64_t m[16][4],
+                                                       uint64_t t, uint64_t f,
+                                                       unsigned int rounds) {
+    __m256i v[16], mv[16];
+    unsigned int i, r;
+
+    for (i = 0; i < 16; ++i) {
+        mv[i] = LOAD_256(m[i]);
+    }
+    for (i = 0; i < 8; ++i) {
+        v[i] = LOAD_256(h[i]);
+        v[i + 8] = _mm256_set1_epi64x((long long)blake2b_IV[i]);
+    }
+    v[12] = _mm256_xor_si256(v[12], _mm256_set1_epi64x((long long)t));
+    v[14] = _mm256_xor_si256(v[14], _mm256_set1_epi64x((long long)f));
+
+    for (r = 0; r < rounds; ++r) {
+        const unsigned int *s = blake2b_sigma[r];
+        G_BLAKE2B_256(v[0], v[4], v[8], v[12], mv[s[0]], mv[s[1]]);
+        G_BLAKE2B_256(v[1], v[5], v[9], v[13], mv[s[2]], mv[s[3]]);
+        G_BLAKE2B_256(v[2], v[6], v[10], v[14], mv[s[4]], mv[s[5]]);
+        G_BLAKE2B_256(v[3], v[7], v[11], v[15], mv[s[6]], mv[s[7]]);
+        G_BLAKE2B_256(v[0], v[5], v[10], v[15], mv[s[8]], mv[s[9]]);
+        G_BLAKE2B_256(v[1], v[6], v[11], v[12], mv[s[10]], mv[s[11]]);
+        G_BLAKE2B_256(v[2], v[7], v[8], v[13], mv[s[12]], mv[s[13]]);
+        G_BLAKE2B_256(v[3], v[4], v[9], v[14], mv[s[14]], mv[s[15]]);
+    }
+
+    for (i = 0; i < 8; ++i) {
+        STORE_256(h[i], _mm256_xor_si256(LOAD_256(h[i]), _mm256_xor_si256(v[i], v[i + 8])));
+    }
+}
+
+#undef MSG_256
+#undef BLAMKA_ROUND_256
+#undef UNDIAGONALIZE_256
+#undef DIAGONALIZE_256
+#undef G_BLAKE2B_256
+#undef G_BLAMKA_256
+#undef BLAMKA_256
+#undef STORE_PAIRS_256
+#undef LOAD_PAIRS_256
+#undef STORE_256
+#undef LOAD_256
@@ -0,0 +1,326 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/*
+ * Vectorized Argon2 and Blake2b kernels, picked at runtime by CPU.
+ *
+ * Every kernel is compiled with a target attribute instead of build flags,
+ * so that a single binary runs everywhere and uses the best instruction set
+ * available. All of them produce the same output as the reference code.
+ */
+
+#include "simd.h"
+
+#include "blake2/blake2.h"
+#include "blake2/blake2-impl.h"
+#include "blake2/blamka-round-ref.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define MTP_SIMD_X86 1
+#include <immintrin.h>
+#if defined(__clang__) || __GNUC__ >= 6
+#define MTP_SIMD_AVX512 1
+#endif
+#endif
+
+static void blamka_permute_ref(block *R) {
+    unsigned int i;
+
+    /* Apply Blake2 on columns of 64-bit words: (0,1,...,15) , then
+       (16,17,..31)... finally (112,113,...127) */
+    for (i = 0; i < 8; ++i) {
+        BLAKE2_ROUND_NOMSG(
+            R->v[16 * i], R->v[16 * i + 1], R->v[16 * i + 2],
+            R->v[16 * i + 3], R->v[16 * i + 4], R->v[16 * i + 5],
+            R->v[16 * i + 6], R->v[16 * i + 7], R->v[16 * i + 8],
+            R->v[16 * i + 9], R->v[16 * i + 10], R->v[16 * i + 11],
+            R->v[16 * i + 12], R->v[16 * i + 13], R->v[16 * i + 14],
+            R->v[16 * i + 15]);
+    }
+
+    /* Apply Blake2 on rows of 64-bit words: (0,1,16,17,...112,113), then
+       (2,3,18,19,...,114,115).. finally (14,15,30,31,...,126,127) */
+    for (i = 0; i < 8; i++) {
+        BLAKE2_ROUND_NOMSG(
+            R->v[2 * i], R->v[2 * i + 1], R->v[2 * i + 16],
+            R->v[2 * i + 17], R->v[2 * i + 32], R->v[2 * i + 33],
+            R->v[2 * i + 48], R->v[2 * i + 49], R->v[2 * i + 64],
+            R->v[2 * i + 65], R->v[2 * i + 80], R->v[2 * i + 81],
+            R->v[2 * i + 96], R->v[2 * i + 97], R->v[2 * i + 112],
+            R->v[2 * i + 113]);
+    }
+}
+
+#if defined(MTP_SIMD_X86)
+
+/* SSE4.1: one row of the 4x4 Blake2 state in two 128 bit vectors */
+
+#define SSE41_ATTR __attribute__((target("ssse3,sse4.1")))
+
+#define ROTR64_32_128(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR64_24_128(x)                                                       \
+    _mm_shuffle_epi8((x), _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2,                \
+                                        11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR64_16_128(x)                                                       \
+    _mm_shuffle_epi8((x), _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1,                \
+                                        10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR64_63_128(x)                                                       \
+    _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+#define BLAMKA_128(x, y)                                                       \
+    _mm_add_epi64(_mm_add_epi64((x), (y)),                                     \
+                  _mm_slli_epi64(_mm_mul_epu32((x), (y)), 1))
+
+#define G_BLAMKA_128(a, b, c, d)                                               \
+    do {                                                                       \
+        a = BLAMKA_128(a, b);                                                  \
+        d = ROTR64_32_128(_mm_xor_si128(d, a));                                \
+        c = BLAMKA_128(c, d);                                                  \
+        b = ROTR64_24_128(_mm_xor_si128(b, c));                                \
+        a = BLAMKA_128(a, b);                                                  \
+        d = ROTR64_16_128(_mm_xor_si128(d, a));                                \
+        c = BLAMKA_128(c, d);                                                  \
+        b = ROTR64_63_128(_mm_xor_si128(b, c));                                \
+    } while ((void)0, 0)
+
+SSE41_ATTR static BLAKE2_INLINE void blamka_round_sse41(uint64_t *const p[8]) {
+    __m128i a0 = _mm_loadu_si128((const __m128i *)p[0]);
+    __m128i a1 = _mm_loadu_si128((const __m128i *)p[1]);
+    __m128i b0 = _mm_loadu_si128((const __m128i *)p[2]);
+    __m128i b1 = _mm_loadu_si128((const __m128i *)p[3]);
+    __m128i c0 = _mm_loadu_si128((const __m128i *)p[4]);
+    __m128i c1 = _mm_loadu_si128((const __m128i *)p[5]);
+    __m128i d0 = _mm_loadu_si128((const __m128i *)p[6]);
+    __m128i d1 = _mm_loadu_si128((const __m128i *)p[7]);
+    __m128i t0, t1;
+
+    G_BLAMKA_128(a0, b0, c0, d0);
+    G_BLAMKA_128(a1, b1, c1, d1);
+
+    /* Line the diagonals up: b by one word, c by two, d by three */
+    t0 = _mm_alignr_epi8(b1, b0, 8);
+    t1 = _mm_alignr_epi8(b0, b1, 8);
+    b0 = t0;
+    b1 = t1;
+    t0 = c0;
+    c0 = c1;
+    c1 = t0;
+    t0 = _mm_alignr_epi8(d0, d1, 8);
+    t1 = _mm_alignr_epi8(d1, d0, 8);
+    d0 = t0;
+    d1 = t1;
+
+    G_BLAMKA_128(a0, b0, c0, d0);
+    G_BLAMKA_128(a1, b1, c1, d1);
+
+    t0 = _mm_alignr_epi8(b0, b1, 8);
+    t1 = _mm_alignr_epi8(b1, b0, 8);
+    b0 = t0;
+    b1 = t1;
+    t0 = c0;
+    c0 = c1;
+    c1 = t0;
+    t0 = _mm_alignr_epi8(d1, d0, 8);
+    t1 = _mm_alignr_epi8(d0, d1, 8);
+    d0 = t0;
+    d1 = t1;
+
+    _mm_storeu_si128((__m128i *)p[0], a0);
+    _mm_storeu_si128((__m128i *)p[1], a1);
+    _mm_storeu_si128((__m128i *)p[2], b0);
+    _mm_storeu_si128((__m128i *)p[3], b1);
+    _mm_storeu_si128((__m128i *)p[4], c0);
+    _mm_storeu_si128((__m128i *)p[5], c1);
+    _mm_storeu_si128((__m128i *)p[6], d0);
+    _mm_storeu_si128((__m128i *)p[7], d1);
+}
+
+SSE41_ATTR static void blamka_permute_sse41(block *R) {
+    unsigned int i, k;
+
+    for (i = 0; i < 8; ++i) {
+        uint64_t *p[8];
+        for (k = 0; k < 8; ++k) {
+            p[k] = R->v + 16 * i + 2 * k;
+        }
+        blamka_round_sse41(p);
+    }
+    for (i = 0; i < 8; ++i) {
+        uint64_t *p[8];
+        for (k = 0; k < 8; ++k) {
+            p[k] = R->v + 2 * i + 16 * k;
+        }
+        blamka_round_sse41(p);
+    }
+}
+
+#undef G_BLAMKA_128
+#undef BLAMKA_128
+#undef ROTR64_63_128
+#undef ROTR64_16_128
+#undef ROTR64_24_128
+#undef ROTR64_32_128
+
+/* AVX2: rotations by byte shuffles */
+
+#define SIMD_ATTR __attribute__((target("avx2")))
+#define SIMD_FUNC(name) name##_avx2
+#define ROTR64_32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR64_24(x)                                                           \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(                                 \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10,                  \
+        3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR64_16(x)                                                           \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(                                 \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9,                  \
+        2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR64_63(x)                                                           \
+    _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+#include "simd-avx.h"
+
+#undef ROTR64_63
+#undef ROTR64_16
+#undef ROTR64_24
+#undef ROTR64_32
+#undef SIMD_FUNC
+#undef SIMD_ATTR
+
+#if defined(MTP_SIMD_AVX512)
+
+/* AVX-512: the same kernels on 256 bit vectors with native rotations */
+
+#define SIMD_ATTR __attribute__((target("avx2,avx512f,avx512vl")))
+#define SIMD_FUNC(name) name##_avx512
+#define ROTR64_32(x) _mm256_ror_epi64((x), 32)
+#define ROTR64_24(x) _mm256_ror_epi64((x), 24)
+#define ROTR64_16(x) _mm256_ror_epi64((x), 16)
+#define ROTR64_63(x) _mm256_ror_epi64((x), 63)
+
+#include "simd-avx.h"
+
+#undef ROTR64_63
+#undef ROTR64_16
+#undef ROTR64_24
+#undef ROTR64_32
+#undef SIMD_FUNC
+#undef SIMD_ATTR
+
+#endif
+#endif
+
+/* Selected instruction set, -1 until the first use */
+static volatile int mtp_isa_selected = -1;
+
+int mtp_isa_supported(int isa) {
+    switch (isa) {
+    case MTP_ISA_REF:
+        return 1;
+#if defined(MTP_SIMD_X86)
+    case MTP_ISA_SSE41:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+    case MTP_ISA_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#if defined(MTP_SIMD_AVX512)
+    case MTP_ISA_AVX512:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("avx512f") &&
+               __builtin_cpu_supports("avx512vl");
+#endif
+#endif
+    default:
+        return 0;
+    }
+}
+
+int mtp_isa_select(int isa) {
+    if (isa < 0) {
+        for (isa = MTP_ISA_COUNT - 1; !mtp_isa_supported(isa); --isa) {
+        }
+    } else if (!mtp_isa_supported(isa)) {
+        return mtp_isa_current();
+    }
+    mtp_isa_selected = isa;
+    return isa;
+}
+
+int mtp_isa_current(void) {
+    int isa = mtp_isa_selected;
+    return isa < 0 ? mtp_isa_select(-1) : isa;
+}
+
+const char *mtp_isa_name(int isa) {
+    switch (isa) {
+    case MTP_ISA_REF:
+        return "ref";
+    case MTP_ISA_SSE41:
+        return "sse4.1";
+    case MTP_ISA_AVX2:
+        return "avx2";
+    case MTP_ISA_AVX512:
+        return "avx512";
+    default:
+        return "unknown";
+    }
+}
+
+void blamka_permute(block *R) {
+    switch (mtp_isa_current()) {
+#if defined(MTP_SIMD_X86)
+#if defined(MTP_SIMD_AVX512)
+    case MTP_ISA_AVX512:
+        blamka_permute_avx512(R);
+        return;
+#endif
+    case MTP_ISA_AVX2:
+        blamka_permute_avx2(R);
+        return;
+    case MTP_ISA_SSE41:
+        blamka_permute_sse41(R);
+        return;
+#endif
+    default:
+        blamka_permute_ref(R);
+    }
+}
+
+int blake2b_compress_simd(uint64_t h[8], const uint64_t m[16],
+                          const uint64_t t[2], const uint64_t f[2],
+                          unsigned int rounds) {
+    switch (mtp_isa_current()) {
+#if defined(MTP_SIMD_X86)
+#if defined(MTP_SIMD_AVX512)
+    case MTP_ISA_AVX512:
+        blake2b_compress_avx512(h, m, t, f, rounds);
+        return 1;
+#endif
+    case MTP_ISA_AVX2:
+        blake2b_compress_avx2(h, m, t, f, rounds);
+        return 1;
+#endif
+    default:
+        /* No 128 bit Blake2b kernel, the scalar code is used */
+        return 0;
+    }
+}
+
+int blake2b_compress_lanes_simd(uint64_t h[8][4], const uint64_t m[16][4],
+                                uint64_t t, uint64_t f, unsigned int rounds) {
+    switch (mtp_isa_current()) {
+#if defined(MTP_SIMD_X86)
+#if defined(MTP_SIMD_AVX512)
+    case MTP_ISA_AVX512:
+        blake2b_compress_lanes_avx512(h, m, t, f, rounds);
+        return 1;
+#endif
+    case MTP_ISA_AVX2:
+        blake2b_compress_lanes_avx2(h, m, t, f, rounds);
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
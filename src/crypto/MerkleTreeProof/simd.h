@@ -0,0 +1,57 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef MTP_SIMD_H
+#define MTP_SIMD_H
+
+#include <stdint.h>
+
+#include "core.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Instruction sets of the vectorized Argon2 and Blake2b kernels */
+enum mtp_isa {
+    MTP_ISA_REF = 0,
+    MTP_ISA_SSE41,
+    MTP_ISA_AVX2,
+    MTP_ISA_AVX512,
+    MTP_ISA_COUNT
+};
+
+/* Whether the CPU, and the compiler, support `isa` */
+int mtp_isa_supported(int isa);
+
+/* Run the kernels of `isa` from now on, the best supported one if negative.
+ * Returns the instruction set in use, unchanged if `isa` is not supported. */
+int mtp_isa_select(int isa);
+
+/* Instruction set in use, the best supported one unless selected otherwise */
+int mtp_isa_current(void);
+
+const char *mtp_isa_name(int isa);
+
+/* Argon2 permutation: the Blake2 rounds over the columns, then the rows, of
+ * 64 bit words of `R`, as done by fill_block() */
+void blamka_permute(block *R);
+
+/* Blake2b compression of message `m` into `h` with `rounds` rounds, `t` and
+ * `f` being the counter and finalization words. Returns 0 when the current
+ * instruction set has no such kernel, leaving the work to the caller. */
+int blake2b_compress_simd(uint64_t h[8], const uint64_t m[16],
+                          const uint64_t t[2], const uint64_t f[2],
+                          unsigned int rounds);
+
+/* Same as blake2b_compress_simd() on 4 states side by side, words stored as
+ * [word][lane], sharing the same counter and finalization word */
+int blake2b_compress_lanes_simd(uint64_t h[8][4], const uint64_t m[16][4],
+                                uint64_t t, uint64_t f, unsigned int rounds);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -34,6 +34,14 @@
 #include <string.h>
 #include <openssl/sha.h>
 #include <iostream>
+#include <new>
+
+#include <boost/thread/tss.hpp>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCRYPT_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
 
 
 /*static inline uint32_t scrypt_be32dec(const void *pp)
@@ -315,9 +323,48 @@ void scrypt_detect_sse2(unsigned int cpuid_edx)
 #endif
 #endif
 
+namespace {
+
+/** Scratchpad of a thread, grown to the largest size asked and reused */
+struct ScryptScratchpad
+{
+    char *data;
+    size_t size;
+
+    ScryptScratchpad() : data(NULL), size(0) {}
+    ~ScryptScratchpad() { free(data); }
+};
+
+boost::thread_specific_ptr<ScryptScratchpad> threadScratchpad;
+
+char *scrypt_scratchpad(size_t size)
+{
+    ScryptScratchpad *scratchpad = threadScratchpad.get();
+    if (!scratchpad) {
+        scratchpad = new ScryptScratchpad();
+        threadScratchpad.reset(scratchpad);
+    }
+    if (scratchpad->size < size) {
+        free(scratchpad->data);
+        scratchpad->data = (char *) malloc(size);
+        if (!scratchpad->data) {
+            scratchpad->size = 0;
+            throw std::bad_alloc();
+        }
+        scratchpad->size = size;
+    }
+    return scratchpad->data;
+}
+
+}
+
+size_t scrypt_scratchpad_size(unsigned char Nfactor, int nLanes)
+{
+    return ((size_t)1 << (Nfactor + 1)) * 128 * nLanes + 63;
+}
+
 void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor) {
-    //char scratchpad[((1 << (Nfactor + 1)) * 128) + 63];
-    char *scratchpad = (char *) malloc((((1 << (Nfactor + 1)) * 128 ) + 63  ) * sizeof (char));
+    char *scratchpad = scrypt_scratchpad(scrypt_scratchpad_size(Nfactor));
 #if defined(USE_SSE2)
     // Detection would work, but in cases where we KNOW it always has SSE2,
         // it is faster to use directly than to use a function pointer or conditional.
@@ -332,5 +379,136 @@ void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor) {
     // Generic scrypt
     scrypt_N_1_1_256_sp_generic(input, output, scratchpad, Nfactor);
 #endif
-    free(scratchpad);
+}
+
+#if defined(SCRYPT_HAVE_AVX2)
+#define ROTL_8WAY(a, b) _mm256_or_si256(_mm256_slli_epi32((a), (b)), _mm256_srli_epi32((a), 32 - (b)))
+#define SALSA_STEP_8WAY(x, a, b, c, n) x[a] = _mm256_xor_si256(x[a], ROTL_8WAY(_mm256_add_epi32(x[b], x[c]), n))
+
+/* xor_salsa8() on 8 lanes, word k of every lane in B[k] */
+__attribute__((target("avx2")))
+static inline void xor_salsa8_8way(__m256i B[16], const __m256i Bx[16]) {
+    __m256i x[16];
+    int i, k;
+
+    for (k = 0; k < 16; k++)
+        x[k] = B[k] = _mm256_xor_si256(B[k], Bx[k]);
+    for (i = 0; i < 8; i += 2) {
+        /* Operate on columns. */
+        SALSA_STEP_8WAY(x, 4, 0, 12, 7);
+        SALSA_STEP_8WAY(x, 9, 5, 1, 7);
+        SALSA_STEP_8WAY(x, 14, 10, 6, 7);
+        SALSA_STEP_8WAY(x, 3, 15, 11, 7);
+
+        SALSA_STEP_8WAY(x, 8, 4, 0, 9);
+        SALSA_STEP_8WAY(x, 13, 9, 5, 9);
+        SALSA_STEP_8WAY(x, 2, 14, 10, 9);
+        SALSA_STEP_8WAY(x, 7, 3, 15, 9);
+
+        SALSA_STEP_8WAY(x, 12, 8, 4, 13);
+        SALSA_STEP_8WAY(x, 1, 13, 9, 13);
+        SALSA_STEP_8WAY(x, 6, 2, 14, 13);
+        SALSA_STEP_8WAY(x, 11, 7, 3, 13);
+
+        SALSA_STEP_8WAY(x, 0, 12, 8, 18);
+        SALSA_STEP_8WAY(x, 5, 1, 13, 18);
+        SALSA_STEP_8WAY(x, 10, 6, 2, 18);
+        SALSA_STEP_8WAY(x, 15, 11, 7, 18);
+
+        /* Operate on rows. */
+        SALSA_STEP_8WAY(x, 1, 0, 3, 7);
+        SALSA_STEP_8WAY(x, 6, 5, 4, 7);
+        SALSA_STEP_8WAY(x, 11, 10, 9, 7);
+        SALSA_STEP_8WAY(x, 12, 15, 14, 7);
+
+        SALSA_STEP_8WAY(x, 2, 1, 0, 9);
+        SALSA_STEP_8WAY(x, 7, 6, 5, 9);
+        SALSA_STEP_8WAY(x, 8, 11, 10, 9);
+        SALSA_STEP_8WAY(x, 13, 12, 15, 9);
+
+        SALSA_STEP_8WAY(x, 3, 2, 1, 13);
+        SALSA_STEP_8WAY(x, 4, 7, 6, 13);
+        SALSA_STEP_8WAY(x, 9, 8, 11, 13);
+        SALSA_STEP_8WAY(x, 14, 13, 12, 13);
+
+        SALSA_STEP_8WAY(x, 0, 3, 2, 18);
+        SALSA_STEP_8WAY(x, 5, 4, 7, 18);
+        SALSA_STEP_8WAY(x, 10, 9, 8, 18);
+        SALSA_STEP_8WAY(x, 15, 14, 13, 18);
+    }
+    for (k = 0; k < 16; k++)
+        B[k] = _mm256_add_epi32(B[k], x[k]);
+}
+
+#undef SALSA_STEP_8WAY
+#undef ROTL_8WAY
+
+/* scrypt_N_1_1_256_sp_generic() on 8 inputs at once. The scratchpad holds the
+ * 8 lanes interleaved word by word, so that the lookups of the second loop
+ * are a gather of one word per lane. */
+__attribute__((target("avx2")))
+static void scrypt_N_1_1_256_sp_avx2_8way(const char *const *input, char *const *output, char *scratchpad, unsigned char Nfactor) {
+    uint8_t B[8][128];
+    uint32_t W[8];
+    __m256i X[32];
+    __m256i *V;
+    uint32_t i, k, N;
+    int lane;
+
+    V = (__m256i *)(((uintptr_t)(scratchpad) + 63) & ~(uintptr_t)(63));
+
+    for (lane = 0; lane < 8; lane++)
+        PBKDF2_SHA256((const uint8_t *) input[lane], 80, (const uint8_t *) input[lane], 80, 1, B[lane], 128);
+
+    for (k = 0; k < 32; k++) {
+        for (lane = 0; lane < 8; lane++)
+            W[lane] = scrypt_le32dec(&B[lane][4 * k]);
+        X[k] = _mm256_loadu_si256((const __m256i *) W);
+    }
+    N = (1 << (Nfactor + 1));
+    for (i = 0; i < N; i++) {
+        memcpy(&V[i * 32], X, sizeof(X));
+        xor_salsa8_8way(&X[0], &X[16]);
+        xor_salsa8_8way(&X[16], &X[0]);
+    }
+    const __m256i mask = _mm256_set1_epi32(N - 1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (i = 0; i < N; i++) {
+        /* Offset of word 0 of block j of each lane, in words */
+        __m256i j = _mm256_add_epi32(_mm256_slli_epi32(_mm256_and_si256(X[16], mask), 8), lanes);
+        for (k = 0; k < 32; k++)
+            X[k] = _mm256_xor_si256(X[k], _mm256_i32gather_epi32((const int *) &V[k], j, 4));
+        xor_salsa8_8way(&X[0], &X[16]);
+        xor_salsa8_8way(&X[16], &X[0]);
+    }
+
+    for (k = 0; k < 32; k++) {
+        _mm256_storeu_si256((__m256i *) W, X[k]);
+        for (lane = 0; lane < 8; lane++)
+            scrypt_le32enc(&B[lane][4 * k], W[lane]);
+    }
+
+    for (lane = 0; lane < 8; lane++)
+        PBKDF2_SHA256((const uint8_t *) input[lane], 80, B[lane], 128, 1, (uint8_t *) output[lane], 32);
+}
+
+static bool scrypt_detect_avx2()
+{
+    static const bool fAVX2 = __builtin_cpu_supports("avx2");
+    return fAVX2;
+}
+#endif
+
+void scrypt_N_1_1_256_multi(const char *const *input, char *const *output, size_t n, unsigned char Nfactor) {
+    size_t i = 0;
+#if defined(SCRYPT_HAVE_AVX2)
+    // The gather offsets of the interleaved scratchpad are 32 bit
+    if (Nfactor <= SCRYPT_MAX_MULTI_NFACTOR && scrypt_detect_avx2()) {
+        char *scratchpad = scrypt_scratchpad(scrypt_scratchpad_size(Nfactor, 8));
+        for (; i + 8 <= n; i += 8)
+            scrypt_N_1_1_256_sp_avx2_8way(input + i, output + i, scratchpad, Nfactor);
+    }
+#endif
+    for (; i < n; i++)
+        scrypt_N_1_1_256(input[i], output[i], Nfactor);
 }
@@ -5,7 +5,18 @@
 
 static const int SCRYPT_SCRATCHPAD_SIZE = 131072 + 63;
 
+/** Largest N factor hashed several inputs at a time by scrypt_N_1_1_256_multi() */
+static const unsigned char SCRYPT_MAX_MULTI_NFACTOR = 20;
+
+/** Size of the scratchpad of `nLanes` inputs hashed at once, alignment included */
+size_t scrypt_scratchpad_size(unsigned char Nfactor, int nLanes = 1);
+
+/** Hash the 80 bytes at `input`. The scratchpad is kept by the calling thread
+ *  and reused by its next hashes. */
 void scrypt_N_1_1_256(const char *input, char *output, unsigned char Nfactor);
+
+/** Hash `n` inputs of the same N factor, 8 at a time on CPUs with AVX2 */
+void scrypt_N_1_1_256_multi(const char *const *input, char *const *output, size_t n, unsigned char Nfactor);
 void scrypt_N_1_1_256_sp_generic(const char *input, char *output, char *scratchpad, unsigned char Nfactor);
 
 #if defined(USE_SSE2)
@@ -1359,7 +1359,7 @@ static int exodus_initial_scan(int nFirstBlock)
         // Get block to parse.
         CBlock block;
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), false)) {
             break;
         }
 
@@ -1644,7 +1644,7 @@ UniValue exodus_listblocktransactions(const UniValue& params, bool fHelp)
         LOCK(cs_main);
         CBlockIndex* pBlockIndex = chainActive[blockHeight];
 
-        if (!ReadBlockFromDisk(block, pBlockIndex, Params().GetConsensus())) {
+        if (!ReadBlockFromDisk(block, pBlockIndex, Params().GetConsensus(), false)) {
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block from disk");
         }
     }
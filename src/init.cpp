@@ -41,6 +41,8 @@
 #include "validationinterface.h"
 #include "validation.h"
 #include "mtpstate.h"
+#include "mtpverifier.h"
+#include "libzerocoin/ParallelTasks.h"
 
 #ifdef ENABLE_WALLET
 #include "wallet/wallet.h"
@@ -372,6 +374,9 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-checklevel=<n>",
                                strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"),
                                          DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-paranoidblockreads",
+                               strprintf(_("Verify proof of work every time a block is read from disk, including blocks checked by -checkblocks and verifychain, even if it was verified when the block was connected (default: %u)"),
+                                         DEFAULT_PARANOID_BLOCK_READS));
     strUsage += HelpMessageOpt("-conf=<file>",
                                strprintf(_("Specify configuration file (default: %s)"), BITCOIN_CONF_FILENAME));
     if (mode == HMM_BITCOIND) {
@@ -565,6 +570,7 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-genproclimit=<n>", strprintf(
             _("Set the number of threads for coin generation if enabled (-1 = all cores, default: %d)"),
             DEFAULT_GENERATE_THREADS));
+    strUsage += HelpMessageOpt("-minerhugepages", strprintf(_("Back the MTP mining memory with huge pages if available (default: %u)"), DEFAULT_MINER_HUGEPAGES));
 
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
     strUsage += HelpMessageOpt("-logips",
@@ -1201,6 +1207,7 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fParanoidBlockReads = GetBoolArg("-paranoidblockreads", DEFAULT_PARANOID_BLOCK_READS);
 
     // mempool AC_CONFIG_SUBDIRSlimits
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
@@ -1383,6 +1390,12 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
+    // MTP proofs of received blocks are checked ahead on as many threads
+    if (nScriptCheckThreads)
+        mtpPreVerifier.Start(threadGroup, nScriptCheckThreads);
+    // Zerocoin proofs, and the spends of connected blocks, are split between
+    // the thread checking them and as many workers as script checks
+    libzerocoin::ParallelTasks::StartThreads(nScriptCheckThreads ? nScriptCheckThreads - 1 : 0);
 
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
@@ -2039,6 +2052,9 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
 
     threadGroup.create_thread(boost::bind(&ThreadCheckDarkSendPool));
 
+    // Catch up with the alternative modulus accumulator values of the coin groups loaded, then follow the new blocks
+    threadGroup.create_thread(&ThreadZerocoinAlternativeModulusAccumulators);
+
 
 
     // ********************************************************* Step 12: finished
@@ -2054,6 +2070,10 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
 
         // Run a thread to flush wallet periodically
         threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
+
+        // Pre-generate zerocoin mints in the background
+        if (GetArg("-zcmintpool", DEFAULT_ZEROCOIN_MINT_POOL_SIZE) > 0)
+            threadGroup.create_thread(&ThreadZerocoinMintPool);
     }
 #endif
 
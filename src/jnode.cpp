@@ -416,7 +416,7 @@ void CJnode::UpdateLastPaid(const CBlockIndex *pindex, int nMaxBlocksToScanBack)
             mnpayments.mapJnodeBlocks[BlockReading->nHeight].HasPayeeWithVotes(mnpayee, 2)) {
             // LogPrintf("i=%s, BlockReading->nHeight=%s\n", i, BlockReading->nHeight);
             CBlock block;
-            if (!ReadBlockFromDisk(block, BlockReading, Params().GetConsensus())) // shouldn't really happen
+            if (!ReadBlockFromDisk(block, BlockReading, Params().GetConsensus(), false)) // shouldn't really happen
             {
                 LogPrintf("ReadBlockFromDisk failed\n");
                 continue;
@@ -27,6 +27,9 @@ namespace libzerocoin {
         Bignum g_n = params->accumulatorQRNCommitmentGroup.g;
         Bignum h_n = params->accumulatorQRNCommitmentGroup.h;
 
+        const IntegerGroupParams &pok = params->accumulatorPoKCommitmentGroup;
+        const IntegerGroupParams &qrn = params->accumulatorQRNCommitmentGroup;
+
         Bignum e = commitmentToCoin.getContents();
         Bignum r = commitmentToCoin.getRandomness();
 
@@ -34,9 +37,10 @@ namespace libzerocoin {
         Bignum r_2 = Bignum::randBignum(params->accumulatorModulus / 4);
         Bignum r_3 = Bignum::randBignum(params->accumulatorModulus / 4);
 
-        this->C_e = g_n.pow_mod(e, params->accumulatorModulus) * h_n.pow_mod(r_1, params->accumulatorModulus);
-        this->C_u = witness.getValue() * h_n.pow_mod(r_2, params->accumulatorModulus);
-        this->C_r = g_n.pow_mod(r_2, params->accumulatorModulus) * h_n.pow_mod(r_3, params->accumulatorModulus);
+        // C_e, C_u and C_r are left unreduced, as they always were
+        this->C_e = qrn.multiExp(e, 0, params->accumulatorModulus) * qrn.multiExp(0, r_1, params->accumulatorModulus);
+        this->C_u = witness.getValue() * qrn.multiExp(0, r_2, params->accumulatorModulus);
+        this->C_r = qrn.multiExp(r_2, 0, params->accumulatorModulus) * qrn.multiExp(0, r_3, params->accumulatorModulus);
 
         Bignum r_alpha = Bignum::randBignum(params->maxCoinValue * Bignum(2).pow(params->k_prime + params->k_dprime));
         if (!(Bignum::randBignum(Bignum(3)) % 2)) {
@@ -78,32 +82,21 @@ namespace libzerocoin {
             r_delta = 0 - r_delta;
         }
 
-        this->st_1 = (sg.pow_mod(r_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
-                      sh.pow_mod(r_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                     params->accumulatorPoKCommitmentGroup.modulus;
-        this->st_2 = (((commitmentToCoin.getCommitmentValue() *
-                        sg.inverse(params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(r_gamma,
-                                                                                           params->accumulatorPoKCommitmentGroup.modulus)) *
-                      sh.pow_mod(r_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                     params->accumulatorPoKCommitmentGroup.modulus;
-        this->st_3 = ((sg * commitmentToCoin.getCommitmentValue()).pow_mod(r_sigma,
-                                                                           params->accumulatorPoKCommitmentGroup.modulus) *
-                      sh.pow_mod(r_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                     params->accumulatorPoKCommitmentGroup.modulus;
-
-        this->t_1 =
-                (h_n.pow_mod(r_zeta, params->accumulatorModulus) * g_n.pow_mod(r_epsilon, params->accumulatorModulus)) %
-                params->accumulatorModulus;
-        this->t_2 =
-                (h_n.pow_mod(r_eta, params->accumulatorModulus) * g_n.pow_mod(r_alpha, params->accumulatorModulus)) %
-                params->accumulatorModulus;
-        this->t_3 = (C_u.pow_mod(r_alpha, params->accumulatorModulus) *
-                     ((h_n.inverse(params->accumulatorModulus)).pow_mod(r_beta, params->accumulatorModulus))) %
-                    params->accumulatorModulus;
-        this->t_4 = (C_r.pow_mod(r_alpha, params->accumulatorModulus) *
-                     ((h_n.inverse(params->accumulatorModulus)).pow_mod(r_delta, params->accumulatorModulus)) *
-                     ((g_n.inverse(params->accumulatorModulus)).pow_mod(r_beta, params->accumulatorModulus))) %
-                    params->accumulatorModulus;
+        // (g^-1)^x is computed as g^-x
+        this->st_1 = pok.multiExp(r_alpha, r_phi, pok.modulus);
+        this->st_2 = pok.multiExp(0, r_psi, pok.modulus,
+                                  std::vector<Bignum>(1, commitmentToCoin.getCommitmentValue() * sg.inverse(pok.modulus)),
+                                  std::vector<Bignum>(1, r_gamma));
+        this->st_3 = pok.multiExp(0, r_xi, pok.modulus,
+                                  std::vector<Bignum>(1, sg * commitmentToCoin.getCommitmentValue()),
+                                  std::vector<Bignum>(1, r_sigma));
+
+        this->t_1 = qrn.multiExp(r_epsilon, r_zeta, params->accumulatorModulus);
+        this->t_2 = qrn.multiExp(r_alpha, r_eta, params->accumulatorModulus);
+        this->t_3 = qrn.multiExp(0, -r_beta, params->accumulatorModulus,
+                                 std::vector<Bignum>(1, C_u), std::vector<Bignum>(1, r_alpha));
+        this->t_4 = qrn.multiExp(-r_beta, -r_delta, params->accumulatorModulus,
+                                 std::vector<Bignum>(1, C_r), std::vector<Bignum>(1, r_alpha));
 
         CHashWriter hasher(0, 0);
         hasher << *params << sg << sh << g_n << h_n << commitmentToCoin.getCommitmentValue() << C_e << C_u << C_r
@@ -135,7 +128,8 @@ namespace libzerocoin {
         Bignum g_n = params->accumulatorQRNCommitmentGroup.g;
         Bignum h_n = params->accumulatorQRNCommitmentGroup.h;
 
-
+        const IntegerGroupParams &pok = params->accumulatorPoKCommitmentGroup;
+        const IntegerGroupParams &qrn = params->accumulatorQRNCommitmentGroup;
 
         //According to the proof, this hash should be of length k_prime bits.  It is currently greater than that, which should not be a problem, but we should check this.
         CHashWriter hasher(0, 0);
@@ -144,38 +138,30 @@ namespace libzerocoin {
 
         Bignum c = Bignum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-        Bignum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin *
-                                                                                              sg.inverse(
-                                                                                                      params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(
-                s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) *
-                             sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             (sg * valueOfCommitmentToCoin).pow_mod(s_sigma,
-                                                                    params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
-                            params->accumulatorPoKCommitmentGroup.modulus;
-
-        Bignum t_1_prime =
-                (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
-        Bignum t_2_prime =
-                (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
-
-        Bignum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) *
-                            C_u.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
-                           params->accumulatorModulus;
-
-        Bignum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) *
-                            ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
-                           params->accumulatorModulus;
+        // Each product is a single multi-exponentiation, with (g^-1)^x computed as g^-x
+        Bignum st_1_prime = pok.multiExp(s_alpha, s_phi, pok.modulus,
+                                         std::vector<Bignum>(1, valueOfCommitmentToCoin), std::vector<Bignum>(1, c));
+        Bignum st_2_prime = pok.multiExp(c, s_psi, pok.modulus,
+                                         std::vector<Bignum>(1, valueOfCommitmentToCoin * sg.inverse(pok.modulus)),
+                                         std::vector<Bignum>(1, s_gamma));
+        Bignum st_3_prime = pok.multiExp(c, s_xi, pok.modulus,
+                                         std::vector<Bignum>(1, sg * valueOfCommitmentToCoin),
+                                         std::vector<Bignum>(1, s_sigma));
+
+        Bignum t_1_prime = qrn.multiExp(s_epsilon, s_zeta, params->accumulatorModulus,
+                                        std::vector<Bignum>(1, C_r), std::vector<Bignum>(1, c));
+        Bignum t_2_prime = qrn.multiExp(s_alpha, s_eta, params->accumulatorModulus,
+                                        std::vector<Bignum>(1, C_e), std::vector<Bignum>(1, c));
+
+        std::vector<Bignum> t_3_bases, t_3_exps;
+        t_3_bases.push_back(a.getValue());
+        t_3_exps.push_back(c);
+        t_3_bases.push_back(C_u);
+        t_3_exps.push_back(s_alpha);
+        Bignum t_3_prime = qrn.multiExp(0, -s_beta, params->accumulatorModulus, t_3_bases, t_3_exps);
+
+        Bignum t_4_prime = qrn.multiExp(-s_beta, -s_delta, params->accumulatorModulus,
+                                        std::vector<Bignum>(1, C_r), std::vector<Bignum>(1, s_alpha));
 
         bool result = false;
 
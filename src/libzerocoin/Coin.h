@@ -91,6 +91,22 @@ private:
  * @warning and a TOTAL loss of anonymity.
  */
 class PrivateCoin {
+private:
+    template <typename Stream>
+    auto is_eof_helper(Stream &s, bool) -> decltype(s.eof()) {
+        return s.eof();
+    }
+
+    template <typename Stream>
+    bool is_eof_helper(Stream &s, int) {
+        return false;
+    }
+
+    template<typename Stream>
+    bool is_eof(Stream &s) {
+        return is_eof_helper(s, true);
+    }
+
 public:
     template<typename Stream>
     PrivateCoin(const Params* p, Stream& strm): params(p), publicCoin(p) {
@@ -125,6 +141,7 @@ public:
             std::copy(seckey.cbegin(), seckey.cend(), &ecdsaSeckey[0]);
     }
 
+    ADD_SERIALIZE_METHODS;
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(publicCoin);
@@ -132,7 +149,7 @@ public:
         READWRITE(serialNumber);
 
         if (ser_action.ForRead()) {
-            if (s.eof())
+            if (is_eof(s))
                 version = ZEROCOIN_TX_VERSION_1;
             else
                 READWRITE(version);
@@ -16,6 +16,7 @@
  */
 		
 #include "Zerocoin.h"
+#include "ParallelTasks.h"
 
 namespace libzerocoin {
 
@@ -108,9 +109,12 @@ bool CoinSpend::Verify(const Accumulator& a, const SpendMetaData &m) const {
             return false;
     }
 
+    return VerifyEcdsaSignature(metahash);
+}
 
+bool CoinSpend::VerifyEcdsaSignature(const uint256 &metahash) const {
     if (this->version != 2) {
-        return ret;
+        return true;
     }
     else {
         // Check if this is a coin that requires a signatures
@@ -155,4 +159,100 @@ const uint256 CoinSpend::signatureHash(const SpendMetaData &m) const {
 	return h.GetHash();
 }
 
+void CoinSpendBatchVerifier::Add(const CoinSpend* spend, const SpendMetaData& m, const std::vector<Accumulator>& accumulators) {
+	entries.push_back(Entry{spend, m, accumulators});
+}
+
+std::vector<bool> CoinSpendBatchVerifier::Verify() const {
+	try {
+		return VerifyBatch();
+	}
+	catch (const std::exception &) {
+		// find the spends that throw
+		std::vector<bool> result(entries.size());
+		for (size_t i = 0; i < entries.size(); i++)
+			result[i] = VerifyOne(entries[i]);
+		return result;
+	}
+}
+
+std::vector<bool> CoinSpendBatchVerifier::VerifyBatch() const {
+	ParallelTasks::DoNotDisturb dnd;
+
+	size_t n = entries.size();
+	// char instead of bool so the tasks can write them at the same time
+	std::vector<char> valid(n, 0), commitmentValid(n, 0);
+	std::vector<uint256> metahashes(n);
+	std::vector<std::vector<Bignum>> tprimes(n);
+	// (spend, round) for every round of the serial number signatures
+	std::vector<std::pair<size_t, uint32_t>> rounds;
+
+	for (size_t i = 0; i < n; i++) {
+		const CoinSpend *spend = entries[i].spend;
+		if (!spend->HasValidSerial())
+			continue;
+		valid[i] = 1;
+		metahashes[i] = spend->signatureHash(entries[i].metadata);
+		tprimes[i].resize(spend->params->zkp_iterations);
+		for (uint32_t j = 0; j < spend->params->zkp_iterations; j++)
+			rounds.push_back(std::make_pair(i, j));
+	}
+
+	ParallelTasks tasks;
+
+	// 1. The commitment proofs and the rounds of the serial number signatures,
+	// none of them depend on the accumulator
+	tasks.AddRange(0, n, [this, &valid, &commitmentValid](size_t i) {
+		const CoinSpend *spend = entries[i].spend;
+		if (valid[i])
+			commitmentValid[i] = spend->commitmentPoK.Verify(spend->serialCommitmentToCoinValue, spend->accCommitmentToCoinValue);
+	});
+	tasks.AddRange(0, rounds.size(), [this, &rounds, &tprimes](size_t k) {
+		size_t i = rounds[k].first;
+		const CoinSpend *spend = entries[i].spend;
+		tprimes[i][rounds[k].second] = spend->serialNumberSoK.ComputeTPrime(rounds[k].second, spend->coinSerialNumber,
+		                                                                   spend->serialCommitmentToCoinValue);
+	});
+	tasks.Wait();
+
+	for (size_t i = 0; i < n; i++) {
+		const CoinSpend *spend = entries[i].spend;
+		valid[i] = valid[i] && commitmentValid[i]
+		           && spend->serialNumberSoK.CheckTPrimes(spend->coinSerialNumber, spend->serialCommitmentToCoinValue,
+		                                                  spend->version == ZEROCOIN_TX_VERSION_1_5 ? metahashes[i] : uint256(),
+		                                                  tprimes[i])
+		           && spend->VerifyEcdsaSignature(metahashes[i]);
+	}
+
+	// 2. The accumulator proofs, against every accumulator until one matches
+	tasks.Reset();
+	tasks.AddRange(0, n, [this, &valid](size_t i) {
+		const CoinSpend *spend = entries[i].spend;
+		if (!valid[i])
+			return;
+		valid[i] = 0;
+		for (const Accumulator &a: entries[i].accumulators) {
+			if (a.getDenomination() == spend->denomination && spend->accumulatorPoK.Verify(a, spend->accCommitmentToCoinValue)) {
+				valid[i] = 1;
+				break;
+			}
+		}
+	});
+	tasks.Wait();
+
+	return std::vector<bool>(valid.begin(), valid.end());
+}
+
+bool CoinSpendBatchVerifier::VerifyOne(const Entry& entry) const {
+	try {
+		for (const Accumulator &a: entry.accumulators) {
+			if (entry.spend->Verify(a, entry.metadata))
+				return true;
+		}
+	}
+	catch (const std::exception &) {
+	}
+	return false;
+}
+
 } /* namespace libzerocoin */
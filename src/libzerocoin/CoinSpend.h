@@ -142,8 +142,11 @@ public:
 	}
 
 private:
+	friend class CoinSpendBatchVerifier;
+
 	const Params *params;
     const uint256 signatureHash(const SpendMetaData &m) const;
+    bool VerifyEcdsaSignature(const uint256 &metahash) const;
 	// Denomination is stored as an INT because storing
 	// and enum raises amigiuities in the serialize code //FIXME if possible
 	int denomination;
@@ -159,5 +162,41 @@ private:
 	uint256 accumulatorBlockHash;
 };
 
+/** Verifies a number of spends together, like all the spends of a block.
+ *
+ * The rounds of the serial number signatures of all the spends are computed in
+ * one parallel pass, and every signature is checked once however many
+ * accumulators its spend is tried against. Each spend gets its own result, so
+ * a bad spend does not hide the good ones.
+ */
+class CoinSpendBatchVerifier {
+public:
+	/** Adds a spend that holds if it verifies against one of the accumulators.
+	 * The spend is not copied and must outlive the verifier.
+	 */
+	void Add(const CoinSpend* spend, const SpendMetaData& m, const std::vector<Accumulator>& accumulators);
+
+	/** Verifies all the spends added.
+	 * If a proof throws, every spend is verified on its own and the ones that
+	 * throw fail.
+	 *
+	 * @return the result of every spend, in the order they were added
+	 */
+	std::vector<bool> Verify() const;
+
+	size_t size() const { return entries.size(); }
+
+private:
+	struct Entry {
+		const CoinSpend *spend;
+		SpendMetaData metadata;
+		std::vector<Accumulator> accumulators;
+	};
+	std::vector<Entry> entries;
+
+	std::vector<bool> VerifyBatch() const;
+	bool VerifyOne(const Entry& entry) const;
+};
+
 } /* namespace libzerocoin */
 #endif /* COINSPEND_H_ */
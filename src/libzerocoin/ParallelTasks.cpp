@@ -13,145 +13,264 @@
 #include "Zerocoin.h"
 #include "ParallelTasks.h"
 
-#define BOOST_THREAD_PROVIDES_FUTURE
-
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
-#include <boost/thread/future.hpp>
-#include <boost/chrono.hpp>
 
-#include <queue>
-#include <vector>
+#include <atomic>
+#include <deque>
+#include <exception>
 #include <list>
 #include <algorithm>
 #include <functional>
 
 namespace libzerocoin {
 
-#ifdef ZEROCOIN_THREADING
+// Maximum number of batches waiting for workers. Past it batches are run by
+// the thread waiting for them, which keeps the queue bounded without blocking
+constexpr static size_t maxQueuedBatches = 64;
+
+// Chunks per thread a batch is split in, more balance the load better
+constexpr static size_t chunksPerThread = 2;
+
+struct ParallelTasks::Batch {
+    std::function<void(size_t)> task;
+    size_t end;
+    size_t chunkSize;
+
+    // first index not taken yet
+    std::atomic<size_t> next;
+    // chunks not run yet
+    std::atomic<size_t> chunksLeft;
+
+    boost::mutex mutex;
+    boost::condition_variable doneCondition;
+    bool done;
+    std::exception_ptr error;
+
+    Batch(std::function<void(size_t)> taskIn, size_t begin, size_t endIn, size_t chunkSizeIn)
+        : task(std::move(taskIn)), end(endIn), chunkSize(chunkSizeIn), next(begin),
+          chunksLeft((endIn - begin + chunkSizeIn - 1) / chunkSizeIn), done(begin == endIn) {}
+
+    // take and run the next chunk, false if all of them were taken
+    bool RunChunk() {
+        size_t first = next.fetch_add(chunkSize);
+        if (first >= end)
+            return false;
+        size_t last = std::min(first + chunkSize, end);
+
+        // the tasks are independent, one failing does not stop the others
+        for (size_t i = first; i < last; i++) {
+            try {
+                task(i);
+            } catch (...) {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
 
-// Number of seconds before thread shuts down if idle
-constexpr static int secondsBeforeThreadShutdown = 10;
+        if (--chunksLeft == 0) {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            done = true;
+            doneCondition.notify_all();
+        }
+        return true;
+    }
 
-// Simple thread pool class for using multiple cores effeciently
+    void WaitDone() {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (!done)
+            doneCondition.wait(lock);
+    }
+};
+
+// Thread pool shared by all the ParallelTasks instances, for using multiple cores effeciently
 
 static class ParallelOpThreadPool {
 private:
     std::list<boost::thread>                  threads;
-    std::queue<boost::packaged_task<void>>    taskQueue;
-    boost::mutex                              taskQueueMutex;
-    boost::condition_variable                 taskQueueCondition;
+    std::deque<std::shared_ptr<ParallelTasks::Batch>> batchQueue;
+    boost::mutex                              batchQueueMutex;
+    boost::condition_variable                 batchQueueCondition;
 
+    bool                                      started;
     bool                                      shutdown;
-    size_t                                    numberOfThreads;
+    size_t                                    maxQueued;
+
+    std::atomic<uint64_t>                     numberOfBatches;
+    std::atomic<uint64_t>                     numberOfChunks;
+    std::atomic<uint64_t>                     numberOfWakeups;
+    std::atomic<uint64_t>                     numberOfOverflows;
 
     void ThreadProc() {
         for (;;) {
-            boost::packaged_task<void> job;
+            std::shared_ptr<ParallelTasks::Batch> batch;
             {
-                boost::unique_lock<boost::mutex> lock(taskQueueMutex);
-
-                taskQueueCondition.wait_for(lock, boost::chrono::seconds(secondsBeforeThreadShutdown),
-                                            [this] { return !taskQueue.empty() || shutdown; });
-                if (taskQueue.empty()) {
-                    // Either timeout or shutdown. If it's a timeout we need to delete ourself from the thread list and detach the thread
-                    // In case of shutdown thread list will be empty and destructor will wait for this thread completion
-                    boost::thread::id currentId = boost::this_thread::get_id();
-                    auto pThread = find_if(threads.begin(), threads.end(), [=](const boost::thread &t) { return t.get_id() == currentId; });
-                    if (pThread != threads.end()) {
-                        pThread->detach();
-                        threads.erase(pThread);
-                    }
-                    break;
+                boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+                while (batchQueue.empty() && !shutdown) {
+                    batchQueueCondition.wait(lock);
+                    if (!batchQueue.empty())
+                        numberOfWakeups++;
                 }
-                job = std::move(taskQueue.front());
-                taskQueue.pop();
+                if (shutdown)
+                    break;
+                batch = batchQueue.front();
             }
-            job();
+            RunAndRemove(batch);
         }
     }
 
-    void StartThreads() {
-        // should be called with mutex aquired
-        // start missing threads
-        while(threads.size() < numberOfThreads)
+    // should be called with mutex aquired
+    void StartThreadsLocked(size_t numberOfThreads) {
+        started = true;
+#ifdef ZEROCOIN_THREADING
+        while (threads.size() < numberOfThreads)
             threads.emplace_back(std::bind(&ParallelOpThreadPool::ThreadProc, this));
+#endif
     }
 
 public:
-    ParallelOpThreadPool() : shutdown(false), numberOfThreads(boost::thread::hardware_concurrency()) {}
+    ParallelOpThreadPool() : started(false), shutdown(false), maxQueued(0),
+            numberOfBatches(0), numberOfChunks(0), numberOfWakeups(0), numberOfOverflows(0) {}
 
     ~ParallelOpThreadPool() {
         std::list<boost::thread> threadsToJoin;
 
-        taskQueueMutex.lock();
-
-        shutdown = true;
-        taskQueueCondition.notify_all();
-
-        // move the list to separate variable to wait for the shutdown process to complete
-        threadsToJoin.swap(threads);
-
-        taskQueueMutex.unlock();
+        {
+            boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+            shutdown = true;
+            batchQueueCondition.notify_all();
+            threadsToJoin.swap(threads);
+        }
 
         // wait for all the threads
         for (boost::thread &t: threadsToJoin)
             t.join();
     }
 
-    // Post a task to the thread pool and return a future to wait for its completion
-    boost::future<void> PostTask(function<void()> task) {
-        boost::packaged_task<void> packagedTask(std::move(task));
-        boost::future<void> ret = packagedTask.get_future();
+    void StartThreads(size_t numberOfThreads) {
+        boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+        StartThreadsLocked(numberOfThreads);
+    }
 
-        taskQueueMutex.lock();
+    size_t NumberOfThreads() {
+        boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+        if (!started)
+            StartThreadsLocked(std::max<int>(boost::thread::hardware_concurrency(), 1) - 1);
+        return threads.size();
+    }
 
-        // lazy start threads on first request or after shutdown
-        if (threads.size() < numberOfThreads)
-            StartThreads();
+    // Queue a batch for the workers, false if the caller has to run it alone
+    bool PostBatch(std::shared_ptr<ParallelTasks::Batch> batch) {
+        numberOfBatches++;
+        size_t chunks = batch->chunksLeft;
+
+        boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+        if (threads.empty())
+            return false;
+        if (batchQueue.size() >= maxQueuedBatches) {
+            numberOfOverflows++;
+            return false;
+        }
+        batchQueue.push_back(batch);
+        maxQueued = std::max(maxQueued, batchQueue.size());
+
+        // the caller takes a chunk too, unless it adds more batches first
+        size_t numberToWake = std::min(threads.size(), std::max<size_t>(chunks - 1, 1));
+        for (size_t i = 0; i < numberToWake; i++)
+            batchQueueCondition.notify_one();
+        return true;
+    }
 
-        taskQueue.emplace(std::move(packagedTask));
-        taskQueueCondition.notify_one();
+    // Run the chunks of a batch left to take, then drop it from the queue
+    void RunAndRemove(const std::shared_ptr<ParallelTasks::Batch> &batch) {
+        while (batch->RunChunk())
+            numberOfChunks++;
 
-        taskQueueMutex.unlock();
+        boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+        auto it = std::find(batchQueue.begin(), batchQueue.end(), batch);
+        if (it != batchQueue.end())
+            batchQueue.erase(it);
+    }
 
-        return ret;
+    ParallelTasks::Stats GetStats() {
+        ParallelTasks::Stats stats;
+        boost::unique_lock<boost::mutex> lock(batchQueueMutex);
+        stats.nThreads = threads.size();
+        stats.nQueued = batchQueue.size();
+        stats.nMaxQueued = maxQueued;
+        stats.nBatches = numberOfBatches;
+        stats.nChunks = numberOfChunks;
+        stats.nWakeups = numberOfWakeups;
+        stats.nOverflows = numberOfOverflows;
+        return stats;
     }
 
 } s_parallelOpThreadPool;
 
-#else
+// High level API to create number of parallel tasks and wait for completion
 
-static class ParallelOpThreadPool {
-public:
-    boost::future<void> PostTask(function<void()> task) {
-        task();
-        boost::promise<void> promise;
-        promise.set_value();
-        return promise.get_future();
-    }
-} s_parallelOpThreadPool;
+ParallelTasks::ParallelTasks(int n) {
+    batches.reserve(n);
+}
 
-#endif
+ParallelTasks::~ParallelTasks() {
+    WaitAll(false);
+}
 
-// High level API to create number of parallel tasks and wait for completion
+void ParallelTasks::Add(std::function<void()> task) {
+    AddRange(0, 1, [task](size_t) { task(); });
+}
 
-ParallelTasks::ParallelTasks(int n) {
-    tasks.reserve(n);
+void ParallelTasks::AddRange(size_t begin, size_t end, std::function<void(size_t)> task) {
+    if (begin >= end)
+        return;
+
+    // no need to split when there are no workers to share with
+    size_t numberOfThreads = s_parallelOpThreadPool.NumberOfThreads();
+    size_t numberOfChunks = numberOfThreads ? (numberOfThreads + 1) * chunksPerThread : 1;
+    size_t chunkSize = std::max<size_t>((end - begin + numberOfChunks - 1) / numberOfChunks, 1);
+
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>(std::move(task), begin, end, chunkSize);
+    s_parallelOpThreadPool.PostBatch(batch);
+    batches.push_back(batch);
 }
 
-void ParallelTasks::Add(function<void()> task) {
-    tasks.push_back(s_parallelOpThreadPool.PostTask(std::move(task)));
+void ParallelTasks::WaitAll(bool fRethrow) {
+    // the tasks may reference variables of the caller, so it can't leave before they are done
+    boost::this_thread::disable_interruption dnd;
+
+    // help with our own batches first, the workers may be busy with others
+    for (const std::shared_ptr<Batch> &batch: batches)
+        s_parallelOpThreadPool.RunAndRemove(batch);
+
+    std::exception_ptr error;
+    for (const std::shared_ptr<Batch> &batch: batches) {
+        batch->WaitDone();
+        if (!error)
+            error = batch->error;
+    }
+    batches.clear();
+
+    if (error && fRethrow)
+        std::rethrow_exception(error);
 }
 
 void ParallelTasks::Wait() {
-    for (boost::future<void> &f: tasks)
-        f.get();
+    WaitAll(true);
 }
 
 void ParallelTasks::Reset() {
-    tasks.clear();
+    WaitAll(false);
+}
+
+void ParallelTasks::StartThreads(int nThreads) {
+    s_parallelOpThreadPool.StartThreads(std::max(nThreads, 0));
+}
+
+ParallelTasks::Stats ParallelTasks::GetStats() {
+    return s_parallelOpThreadPool.GetStats();
 }
 
 } // namespace libzerocoin
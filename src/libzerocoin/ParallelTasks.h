@@ -15,35 +15,74 @@
 
 /**
  * Implementation of thread pool for parallelizing spend creation and verification
- */ 
+ *
+ * The worker threads live as long as the process and are shared by all the
+ * ParallelTasks instances. Tasks are added as ranges of indices that workers
+ * take in chunks, so a proof wakes up a few threads instead of one per index,
+ * and the thread waiting for its tasks runs chunks of them too.
+ */
 
-#include <vector>
-#include <functional>
-
-#define BOOST_THREAD_PROVIDES_FUTURE
+#include <stdint.h>
 
+#include <functional>
+#include <memory>
+#include <vector>
 
-#include <boost/thread/future.hpp>
 #include <boost/thread.hpp>
 
 namespace libzerocoin {
 
 class ParallelTasks {
+public:
+    // tasks added together, defined in ParallelTasks.cpp
+    struct Batch;
+
+    struct Stats {
+        // number of worker threads
+        int nThreads;
+        // batches with chunks not taken yet
+        size_t nQueued;
+        // most batches ever queued at once
+        size_t nMaxQueued;
+        // batches added
+        uint64_t nBatches;
+        // chunks run, by the workers or by the waiting threads
+        uint64_t nChunks;
+        // times a worker thread woke up to find work
+        uint64_t nWakeups;
+        // batches run by their waiting thread alone because the queue was full
+        uint64_t nOverflows;
+    };
+
 private:
-    vector<boost::future<void>> tasks;
+    std::vector<std::shared_ptr<Batch>> batches;
+
+    void WaitAll(bool fRethrow);
 
 public:
     ParallelTasks(int n=0);
 
+    // waits for the tasks not waited for, they may reference the caller's variables
+    ~ParallelTasks();
+
     // add new task
     void Add(std::function<void()> task);
 
-    // wait for everything added so far
+    // add task(i) for every i in [begin, end), run in chunks of consecutive indices
+    void AddRange(size_t begin, size_t end, std::function<void(size_t)> task);
+
+    // wait for everything added so far, then rethrow the first exception a task threw
     void Wait();
 
-    // clear all the tasks from the waiting list
+    // clear all the tasks from the waiting list, waiting for them if needed
     void Reset();
 
+    // start the worker threads shared by all the instances, up to nThreads of them.
+    // Without a call the first tasks start one per core but one
+    static void StartThreads(int nThreads);
+
+    static Stats GetStats();
+
     // helper class to put thread interruption on pause
     class DoNotDisturb {
     private:
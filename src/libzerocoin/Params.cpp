@@ -25,6 +25,43 @@ Params::Params(CBigNum N, CBigNum Nseed, uint32_t securityLevel) {
 
 	this->accumulatorParams.initialized = true;
 	this->initialized = true;
+
+	precompute();
+}
+
+void Params::precompute() {
+	// Bounds on the exponents of honestly generated proofs, with some slack.
+	// Longer exponents still work, only without the precomputed powers.
+	// The challenges of the accumulator proof are 256 bit hashes.
+	const int challengeSize = 256;
+	IntegerGroupParams &serialGroup = this->serialNumberSoKCommitmentGroup;
+	IntegerGroupParams &pokGroup = this->accumulatorParams.accumulatorPoKCommitmentGroup;
+	IntegerGroupParams &qrnGroup = this->accumulatorParams.accumulatorQRNCommitmentGroup;
+	const int kBits = this->accumulatorParams.k_prime + this->accumulatorParams.k_dprime;
+	const int NBits = this->accumulatorParams.accumulatorModulus.bitSize();
+	const int coinBits = this->accumulatorParams.maxCoinValue.bitSize();
+
+	// Commitments and the randomness of CommitmentProofOfKnowledge
+	const int commitmentProofBits = COMMITMENT_EQUALITY_CHALLENGE_SIZE + COMMITMENT_EQUALITY_SECMARGIN +
+	        std::max(std::max(serialGroup.modulus.bitSize(), pokGroup.modulus.bitSize()),
+	                 std::max(serialGroup.groupOrder.bitSize(), pokGroup.groupOrder.bitSize())) + 2;
+
+	// Exponents of the serial number signature are reduced by the group
+	// orders, but for sprime = v - r * b^s_notprime
+	this->coinCommitmentGroup.precompute(this->coinCommitmentGroup.modulus,
+	        this->coinCommitmentGroup.groupOrder.bitSize() + 2);
+	serialGroup.precompute(serialGroup.modulus,
+	        std::max(commitmentProofBits, 2 * serialGroup.groupOrder.bitSize() + 2));
+
+	// s_xi and s_psi of the accumulator proof are c * r * (e +- 1)^-1
+	pokGroup.precompute(pokGroup.modulus,
+	        std::max(commitmentProofBits, std::max(coinBits + kBits,
+	                 challengeSize + 2 * pokGroup.groupOrder.bitSize()) + 2));
+
+	// r_beta and r_delta are (N / 4) * (PoK group modulus) * 2^(k' + k''),
+	// s_beta and s_delta add c * r_2 * e to them
+	qrnGroup.precompute(this->accumulatorParams.accumulatorModulus,
+	        std::max(NBits + pokGroup.modulus.bitSize() + kBits, challengeSize + NBits + coinBits) + 2);
 }
 
 AccumulatorAndProofParams::AccumulatorAndProofParams() {
@@ -35,6 +72,34 @@ IntegerGroupParams::IntegerGroupParams() {
 	this->initialized = false;
 }
 
+void IntegerGroupParams::precompute(const Bignum& m, int nMaxExpBits) {
+	// Montgomery multiplication needs an odd modulus
+	if (!BN_is_odd(&m)) {
+		this->ghPowers.reset();
+		return;
+	}
+	std::vector<Bignum> bases;
+	bases.push_back(this->g);
+	bases.push_back(this->h);
+	this->ghPowers = std::make_shared<CBigNumFixedBases>(bases, m, nMaxExpBits);
+}
+
+Bignum IntegerGroupParams::multiExp(const Bignum& gExp, const Bignum& hExp, const Bignum& m,
+                                    const std::vector<Bignum>& bases, const std::vector<Bignum>& exps) const {
+	std::vector<Bignum> ghExps;
+	ghExps.push_back(gExp);
+	ghExps.push_back(hExp);
+	if (this->ghPowers && this->ghPowers->modulus() == m) {
+		return this->ghPowers->pow_mod(ghExps, bases, exps);
+	}
+
+	std::vector<Bignum> allBases(bases), allExps(exps);
+	allBases.push_back(this->g);
+	allBases.push_back(this->h);
+	allExps.insert(allExps.end(), ghExps.begin(), ghExps.end());
+	return Bignum::mul_pow_mod(allBases, allExps, m);
+}
+
 Bignum IntegerGroupParams::randomElement() const {
 	// The generator of the group raised
 	// to a random number less than the order of the group
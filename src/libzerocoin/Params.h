@@ -13,6 +13,8 @@
 #define PARAMS_H_
 #include "Zerocoin.h"
 
+#include <memory>
+
 namespace libzerocoin {
 
 class IntegerGroupParams {
@@ -52,10 +54,34 @@ public:
 	 */
     CBigNum groupOrder;
 
+	/**
+	 * Precomputes the powers of g and h used by multiExp().
+	 * @param m the modulus to compute them by, which is not always "modulus"
+	 *        as some instances only hold a pair of generators
+	 * @param nMaxExpBits the longest exponents to precompute powers for
+	 */
+	void precompute(const CBigNum& m, int nMaxExpBits);
+
+	/**
+	 * Computes g^gExp * h^hExp * prod(bases[i]^exps[i]) mod m, with the
+	 * powers of g and h precomputed by precompute() when they were for m,
+	 * with a simultaneous multi-exponentiation otherwise.
+	 */
+	CBigNum multiExp(const CBigNum& gExp, const CBigNum& hExp, const CBigNum& m,
+	                 const std::vector<CBigNum>& bases = std::vector<CBigNum>(),
+	                 const std::vector<CBigNum>& exps = std::vector<CBigNum>()) const;
+
+	/**
+	 * Precomputed powers of g and h, not serialized and shared between copies.
+	 */
+	std::shared_ptr<const CBigNumFixedBases> ghPowers;
+
 	ADD_SERIALIZE_METHODS;
 
 	template <typename Stream, typename Operation>
 	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+		if (ser_action.ForRead())
+			ghPowers.reset();
 		READWRITE(initialized);
 		READWRITE(g);
 		READWRITE(h);
@@ -175,6 +201,12 @@ public:
 	**/
     Params(CBigNum accumulatorModulus, CBigNum Nseed, uint32_t securityLevel = ZEROCOIN_DEFAULT_SECURITYLEVEL);
 
+	/**
+	 * Precomputes the powers of the generators of all the groups for the
+	 * exponents of the proofs. Done by the constructor.
+	 */
+	void precompute();
+
 	bool initialized;
 
 	AccumulatorAndProofParams accumulatorParams;
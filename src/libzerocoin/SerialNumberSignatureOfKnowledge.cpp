@@ -29,11 +29,6 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 		throw ZerocoinException("Groups are not structured correctly.");
 	}
 
-	Bignum a = params->coinCommitmentGroup.g;
-	Bignum b = params->coinCommitmentGroup.h;
-	Bignum g = params->serialNumberSoKCommitmentGroup.g;
-	Bignum h = params->serialNumberSoKCommitmentGroup.h;
-
 	CHashWriter hasher(0,0);
 	hasher << *params << commitmentToCoin.getCommitmentValue() << coin.getSerialNumber();
     if (!msghash.IsNull())
@@ -56,14 +51,12 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 	// instead we generate the random values beforehand and run the calculations
 	// based on those values in parallel.
 
-    ParallelTasks challenges(params->zkp_iterations);
+    ParallelTasks challenges;
 
-	for(uint32_t i=0; i < params->zkp_iterations; i++) {
-		// compute g^{ {a^x b^r} h^v} mod p2
-        challenges.Add([this, i, &coin, &c, &r, &v] {
-            c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v[i]);
-        });
-	}
+	// compute g^{ {a^x b^r} h^v} mod p2
+    challenges.AddRange(0, params->zkp_iterations, [this, &coin, &c, &r, &v](size_t i) {
+        c[i] = challengeCalculation(coin.getSerialNumber(), r[i], v[i]);
+    });
     challenges.Wait();
 
 	// We can't hash data in parallel either
@@ -76,7 +69,7 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 	unsigned char *hashbytes =  (unsigned char*) &hash;
 
     challenges.Reset();
-	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+    challenges.AddRange(0, params->zkp_iterations, [this, hashbytes, &r, &v, &commitmentToCoin, &coin](size_t i) {
 		int bit = i % 8;
 		int byte = i / 8;
 
@@ -85,77 +78,80 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 			s_notprime[i]       = r[i];
 			sprime[i]           = v[i];
 		} else {
-            challenges.Add([this, i, &r, &v, &b, &commitmentToCoin, &coin] {
-                s_notprime[i]   = r[i] - coin.getRandomness();
-                sprime[i]       = v[i] - (commitmentToCoin.getRandomness() *
-			                              b.pow_mod(r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
-            });
+            s_notprime[i]   = r[i] - coin.getRandomness();
+            sprime[i]       = v[i] - (commitmentToCoin.getRandomness() *
+			                          params->coinCommitmentGroup.multiExp(0, r[i] - coin.getRandomness(), params->serialNumberSoKCommitmentGroup.groupOrder));
 		}
-    }
+    });
     challenges.Wait();
 }
 
 inline Bignum SerialNumberSignatureOfKnowledge::challengeCalculation(const Bignum& a_exp,const Bignum& b_exp,
         const Bignum& h_exp) const {
 
-	Bignum a = params->coinCommitmentGroup.g;
-	Bignum b = params->coinCommitmentGroup.h;
-	Bignum g = params->serialNumberSoKCommitmentGroup.g;
-	Bignum h = params->serialNumberSoKCommitmentGroup.h;
-
-	Bignum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
-	                   * b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
+	// The order of the serial number group is the modulus of the coin
+	// commitment group, so its precomputed powers are used for a and b
+	Bignum exponent = params->coinCommitmentGroup.multiExp(a_exp, b_exp, params->serialNumberSoKCommitmentGroup.groupOrder);
 
-	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
+	return params->serialNumberSoKCommitmentGroup.multiExp(exponent, h_exp, params->serialNumberSoKCommitmentGroup.modulus);
 }
 
-bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin,
-        const uint256 msghash) const {
-
-    ParallelTasks::DoNotDisturb dnd;
+Bignum SerialNumberSignatureOfKnowledge::ComputeTPrime(uint32_t i, const Bignum& coinSerialNumber,
+        const Bignum& valueOfCommitmentToCoin) const {
+	const unsigned char *hashbytes = (const unsigned char*) &this->hash;
+	int bit = i % 8;
+	int byte = i / 8;
+
+	bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
+	if (challenge_bit) {
+		return challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i]);
+	} else {
+		Bignum exp = params->coinCommitmentGroup.multiExp(0, s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
+		return params->serialNumberSoKCommitmentGroup.multiExp(0, sprime[i], params->serialNumberSoKCommitmentGroup.modulus,
+		                                                       std::vector<Bignum>(1, valueOfCommitmentToCoin),
+		                                                       std::vector<Bignum>(1, exp));
+	}
+}
 
-	Bignum a = params->coinCommitmentGroup.g;
-	Bignum b = params->coinCommitmentGroup.h;
-	Bignum g = params->serialNumberSoKCommitmentGroup.g;
-	Bignum h = params->serialNumberSoKCommitmentGroup.h;
+bool SerialNumberSignatureOfKnowledge::CheckTPrimes(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin,
+        const uint256 msghash, const vector<Bignum>& tprime) const {
 
 	// Make sure that the serial number has a unique representation
 	if (coinSerialNumber < 0 || coinSerialNumber >= params->coinCommitmentGroup.groupOrder){
 		return false;
 	}
 
-
 	CHashWriter hasher(0,0);
 	hasher << *params << valueOfCommitmentToCoin <<coinSerialNumber;
     if (!msghash.IsNull())
         hasher << msghash;
 
-	vector<CBigNum> tprime(params->zkp_iterations);
-	unsigned char *hashbytes = (unsigned char*) &this->hash;
+	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
+		hasher << tprime[i];
+	}
+    return hasher.GetArith256Hash() == hash;
+}
 
-    ParallelTasks challenges(params->zkp_iterations);
+bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin,
+        const uint256 msghash) const {
 
-	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
-        challenges.Add([this, i, hashbytes, &b, &h, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin] {
-            int bit = i % 8;
-            int byte = i / 8;
-            bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
-            if(challenge_bit) {
-                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i]);
-            } else {
-                Bignum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
-                tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-                             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
-                            params->serialNumberSoKCommitmentGroup.modulus;
-            }
-        });
+    ParallelTasks::DoNotDisturb dnd;
+
+	// Make sure that the serial number has a unique representation
+	if (coinSerialNumber < 0 || coinSerialNumber >= params->coinCommitmentGroup.groupOrder){
+		return false;
 	}
+
+	vector<CBigNum> tprime(params->zkp_iterations);
+
+    ParallelTasks challenges;
+
+    challenges.AddRange(0, params->zkp_iterations, [this, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin](size_t i) {
+        tprime[i] = ComputeTPrime(i, coinSerialNumber, valueOfCommitmentToCoin);
+    });
     challenges.Wait();
 
-	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
-		hasher << tprime[i];
-	}
-    return hasher.GetArith256Hash() == hash;
+    return CheckTPrimes(coinSerialNumber, valueOfCommitmentToCoin, msghash, tprime);
 }
 
 } /* namespace libzerocoin */
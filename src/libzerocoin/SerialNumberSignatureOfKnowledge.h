@@ -51,6 +51,14 @@ public:
 	 */
     bool Verify(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin,const uint256 msghash) const;
 
+	/** Verify() in two steps, for computing the rounds of many signatures together.
+	 * ComputeTPrime() gives the value of one round, independent of the others.
+	 * CheckTPrimes() checks the values of all the rounds against the challenge hash.
+	 */
+	Bignum ComputeTPrime(uint32_t i, const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin) const;
+	bool CheckTPrimes(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin, const uint256 msghash,
+	                  const vector<Bignum>& tprime) const;
+
 	ADD_SERIALIZE_METHODS;
 	template <typename Stream, typename Operation>
 	inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_BIGNUM_H
 #define BITCOIN_BIGNUM_H
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <openssl/bn.h>
@@ -47,6 +48,54 @@ public:
     bool operator!() { return (pctx == NULL); }
 };
 
+/** RAII encapsulated BN_MONT_CTX (OpenSSL Montgomery multiplication context) for an odd modulus */
+class CAutoBN_MONT_CTX
+{
+protected:
+    BN_MONT_CTX* pmont;
+
+    CAutoBN_MONT_CTX(const CAutoBN_MONT_CTX&);
+    CAutoBN_MONT_CTX& operator=(const CAutoBN_MONT_CTX&);
+
+public:
+    CAutoBN_MONT_CTX(const BIGNUM* m, BN_CTX* pctx)
+    {
+        pmont = BN_MONT_CTX_new();
+        if (pmont == NULL)
+            throw bignum_error("CAutoBN_MONT_CTX : BN_MONT_CTX_new() returned NULL");
+        if (!BN_MONT_CTX_set(pmont, m, pctx)) {
+            BN_MONT_CTX_free(pmont);
+            throw bignum_error("CAutoBN_MONT_CTX : BN_MONT_CTX_set failed");
+        }
+    }
+
+    ~CAutoBN_MONT_CTX()
+    {
+        BN_MONT_CTX_free(pmont);
+    }
+
+    /** r = a * b, all in Montgomery form */
+    void mul(BIGNUM* r, const BIGNUM* a, const BIGNUM* b, BN_CTX* pctx) const
+    {
+        if (!BN_mod_mul_montgomery(r, a, b, pmont, pctx))
+            throw bignum_error("CAutoBN_MONT_CTX::mul : BN_mod_mul_montgomery failed");
+    }
+
+    /** r = a in Montgomery form, a must be reduced */
+    void to(BIGNUM* r, const BIGNUM* a, BN_CTX* pctx) const
+    {
+        if (!BN_to_montgomery(r, a, pmont, pctx))
+            throw bignum_error("CAutoBN_MONT_CTX::to : BN_to_montgomery failed");
+    }
+
+    /** r = a out of Montgomery form */
+    void from(BIGNUM* r, const BIGNUM* a, BN_CTX* pctx) const
+    {
+        if (!BN_from_montgomery(r, a, pmont, pctx))
+            throw bignum_error("CAutoBN_MONT_CTX::from : BN_from_montgomery failed");
+    }
+};
+
 
 /** C++ wrapper for BIGNUM (OpenSSL bignum) */class CBigNum
 {
@@ -554,6 +603,85 @@ public:
         return ret;
     }
 
+    /**
+     * simultaneous modular multi-exponentiation: prod(bases[i]^exps[i]) mod m
+     * The windows of all the exponents are interleaved (Straus' method), so the
+     * squarings are shared between the bases instead of done once per base.
+     * As with pow_mod, a negative exponent raises the inverse of its base.
+     * @param bases the bases
+     * @param exps the exponents, one per base
+     * @param m modulus
+     */
+    static CBigNum mul_pow_mod(const std::vector<CBigNum>& bases, const std::vector<CBigNum>& exps, const CBigNum& m) {
+        if (bases.size() != exps.size())
+            throw bignum_error("CBigNum::mul_pow_mod : bases and exponents do not match");
+
+        CAutoBN_CTX pctx;
+        CBigNum ret = 1;
+        if (!BN_is_odd(&m)) {
+            // Montgomery multiplication needs an odd modulus
+            for (size_t i = 0; i < bases.size(); i++)
+                ret = ret.mul_mod(bases[i].pow_mod(exps[i], m), m);
+            return ret % m;
+        }
+
+        int nBits = 0;
+        for (size_t i = 0; i < exps.size(); i++)
+            nBits = std::max(nBits, BN_num_bits(&exps[i]));
+        if (nBits == 0)
+            return ret % m;
+        const int w = nBits > 768 ? 5 : nBits > 192 ? 4 : nBits > 32 ? 3 : 1;
+
+        // powers[i][d] = bases[i]^d for d < 2^w, in Montgomery form
+        CAutoBN_MONT_CTX mont(&m, pctx);
+        std::vector<std::vector<CBigNum> > powers(bases.size());
+        for (size_t i = 0; i < bases.size(); i++) {
+            if (BN_is_zero(&exps[i]))
+                continue;
+            CBigNum base = exps[i] < 0 ? bases[i].inverse(m) : bases[i];
+            if (!BN_nnmod(&base, &base, &m, pctx))
+                throw bignum_error("CBigNum::mul_pow_mod : BN_nnmod failed");
+            powers[i].resize(1 << w);
+            mont.to(&powers[i][1], &base, pctx);
+            for (int d = 2; d < (1 << w); d++)
+                mont.mul(&powers[i][d], &powers[i][d - 1], &powers[i][1], pctx);
+        }
+
+        CBigNum acc;
+        bool fStarted = false;
+        for (int pos = (nBits + w - 1) / w * w - w; pos >= 0; pos -= w) {
+            if (fStarted) {
+                for (int j = 0; j < w; j++)
+                    mont.mul(&acc, &acc, &acc, pctx);
+            }
+            for (size_t i = 0; i < exps.size(); i++) {
+                unsigned int d = exps[i].getbits(pos, w);
+                if (d == 0)
+                    continue;
+                if (fStarted) {
+                    mont.mul(&acc, &acc, &powers[i][d], pctx);
+                } else {
+                    acc = powers[i][d];
+                    fStarted = true;
+                }
+            }
+        }
+        mont.from(&ret, &acc, pctx);
+        return ret;
+    }
+
+    /**
+     * bits pos to pos + w - 1 of the absolute value of this, as an integer
+     * @param pos the lowest bit
+     * @param w the number of bits, at most the width of an unsigned int
+     */
+    unsigned int getbits(int pos, int w) const {
+        unsigned int ret = 0;
+        for (int i = w - 1; i >= 0; i--)
+            ret = (ret << 1) | (BN_is_bit_set(bn, pos + i) ? 1 : 0);
+        return ret;
+    }
+
     /**
      * Calculates the inverse of this element mod m.
      * i.e. i such this*i = 1 mod m
@@ -802,6 +930,142 @@ inline bool operator<(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(&a,
 inline bool operator>(const CBigNum& a, const CBigNum& b)  { return (BN_cmp(&a, &b) > 0); }
 inline std::ostream& operator<<(std::ostream &strm, const CBigNum &b) { return strm << b.ToString(10); }
 
+/**
+ * Fixed bases modulo a fixed odd modulus, with powers of the bases
+ * precomputed so that raising them takes about one modular multiplication
+ * per w bits of exponent and no squaring (Brickell, Gordon, McCurley and
+ * Wilson's method). Read only once built, so it can be shared between threads.
+ */
+class CBigNumFixedBases
+{
+public:
+    /**
+     * Precompute the powers of bases modulo m
+     * @param basesIn the bases
+     * @param mIn the modulus, which must be odd
+     * @param nMaxExpBits exponents up to this many bits use the precomputed
+     *        powers, longer ones fall back to CBigNum::mul_pow_mod
+     */
+    CBigNumFixedBases(const std::vector<CBigNum>& basesIn, const CBigNum& mIn, int nMaxExpBits)
+        : bases(basesIn), m(mIn), pctxBuild(), mont(&m, pctxBuild)
+    {
+        // Cost of an exponentiation is about nMaxExpBits / w multiplications
+        // per base plus 2^(w + 1) to combine the powers
+        const int nTotalBits = nMaxExpBits * std::max<int>(bases.size(), 1);
+        w = 1;
+        while (w < 8 && nTotalBits / (w + 1) + (2 << (w + 1)) < nTotalBits / w + (2 << w))
+            w++;
+        nWindows = (std::max(nMaxExpBits, 1) + w - 1) / w;
+
+        // powers[i][j] = bases[i]^(2^(w*j)) mod m, in Montgomery form
+        powers.resize(bases.size());
+        for (size_t i = 0; i < bases.size(); i++) {
+            CBigNum base;
+            if (!BN_nnmod(&base, &bases[i], &m, pctxBuild))
+                throw bignum_error("CBigNumFixedBases : BN_nnmod failed");
+            powers[i].resize(nWindows);
+            mont.to(&powers[i][0], &base, pctxBuild);
+            for (int j = 1; j < nWindows; j++) {
+                powers[i][j] = powers[i][j - 1];
+                for (int k = 0; k < w; k++)
+                    mont.mul(&powers[i][j], &powers[i][j], &powers[i][j], pctxBuild);
+            }
+        }
+    }
+
+    const CBigNum& modulus() const { return m; }
+
+    /**
+     * prod(bases[i]^exps[i]) * prod(otherBases[i]^otherExps[i]) mod m
+     * As with CBigNum::pow_mod, a negative exponent raises the inverse of its base.
+     * @param exps the exponents of the fixed bases, one per base
+     * @param otherBases further bases, without precomputed powers
+     * @param otherExps the exponents of otherBases
+     */
+    CBigNum pow_mod(const std::vector<CBigNum>& exps,
+                    const std::vector<CBigNum>& otherBases = std::vector<CBigNum>(),
+                    const std::vector<CBigNum>& otherExps = std::vector<CBigNum>()) const {
+        if (exps.size() != bases.size())
+            throw bignum_error("CBigNumFixedBases::pow_mod : bases and exponents do not match");
+
+        CAutoBN_CTX pctx;
+        std::vector<size_t> vPositive, vNegative;
+        std::vector<CBigNum> varBases(otherBases), varExps(otherExps);
+        for (size_t i = 0; i < exps.size(); i++) {
+            if (BN_is_zero(&exps[i]))
+                continue;
+            if (BN_num_bits(&exps[i]) > nWindows * w) {
+                varBases.push_back(bases[i]);
+                varExps.push_back(exps[i]);
+            } else if (exps[i] < 0) {
+                vNegative.push_back(i);
+            } else {
+                vPositive.push_back(i);
+            }
+        }
+
+        CBigNum ret = CBigNum::mul_pow_mod(varBases, varExps, m);
+        if (!vPositive.empty())
+            ret = ret.mul_mod(combine(exps, vPositive, pctx), m);
+        if (!vNegative.empty())
+            ret = ret.mul_mod(combine(exps, vNegative, pctx).inverse(m), m);
+        return ret;
+    }
+
+private:
+    std::vector<CBigNum> bases;
+    CBigNum m;
+    //! Only used while building the powers
+    CAutoBN_CTX pctxBuild;
+    CAutoBN_MONT_CTX mont;
+    int w;
+    int nWindows;
+    std::vector<std::vector<CBigNum> > powers;
+
+    CBigNumFixedBases(const CBigNumFixedBases&);
+    CBigNumFixedBases& operator=(const CBigNumFixedBases&);
+
+    /** prod(bases[i]^|exps[i]|) mod m over the given bases */
+    CBigNum combine(const std::vector<CBigNum>& exps, const std::vector<size_t>& vBases, BN_CTX* pctx) const {
+        // Bucket the powers by the window of the exponent they are raised to,
+        // then prod(d^(bucket d)) = prod over d of (prod of the buckets >= d)
+        std::vector<std::vector<const BIGNUM*> > buckets(1 << w);
+        for (size_t i : vBases) {
+            for (int j = 0; j < nWindows; j++) {
+                unsigned int d = exps[i].getbits(j * w, w);
+                if (d != 0)
+                    buckets[d].push_back(&powers[i][j]);
+            }
+        }
+
+        CBigNum a, b;
+        bool fA = false, fB = false;
+        for (int d = (1 << w) - 1; d > 0; d--) {
+            for (const BIGNUM* power : buckets[d]) {
+                if (fB) {
+                    mont.mul(&b, &b, power, pctx);
+                } else {
+                    if (!BN_copy(&b, power))
+                        throw bignum_error("CBigNumFixedBases::combine : BN_copy failed");
+                    fB = true;
+                }
+            }
+            if (!fB)
+                continue;
+            if (fA) {
+                mont.mul(&a, &a, &b, pctx);
+            } else {
+                a = b;
+                fA = true;
+            }
+        }
+
+        CBigNum ret;
+        mont.from(&ret, &a, pctx);
+        return ret;
+    }
+};
+
 typedef CBigNum Bignum;
 
 #endif
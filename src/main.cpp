@@ -5,6 +5,7 @@
 
 #include "main.h"
 #include "zerocoin.h"
+#include "libzerocoin/ParallelTasks.h"
 
 #include "addrman.h"
 #include "arith_uint256.h"
@@ -25,6 +26,7 @@
 #include "policy/policy.h"
 #include "pow.h"
 #include "primitives/block.h"
+#include "primitives/powcache.h"
 #include "primitives/transaction.h"
 #include "random.h"
 #include "script/script.h"
@@ -45,6 +47,7 @@
 #include "definition.h"
 #include "utiltime.h"
 #include "mtpstate.h"
+#include "mtpverifier.h"
 
 #include "darksend.h"
 #include "instantx.h"
@@ -95,6 +98,7 @@ bool fIsBareMultisigStd = DEFAULT_PERMIT_BAREMULTISIG;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fParanoidBlockReads = DEFAULT_PARANOID_BLOCK_READS;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -1109,7 +1113,7 @@ int64_t GetTransactionSigOpCost(const CTransaction &tx, const CCoinsViewCache &i
 
 
 //static libzerocoin::Params *ZCParams;
-bool CheckTransaction(const CTransaction &tx, CValidationState &state, uint256 hashTx,  bool isVerifyDB, int nHeight, bool isCheckWallet, bool fStatefulZerocoinCheck, CZerocoinTxInfo *zerocoinTxInfo) {
+bool CheckTransaction(const CTransaction &tx, CValidationState &state, uint256 hashTx,  bool isVerifyDB, int nHeight, bool isCheckWallet, bool fStatefulZerocoinCheck, CZerocoinTxInfo *zerocoinTxInfo, std::vector<CZerocoinSpendCheck> *pvZerocoinChecks) {
     LogPrintf("CheckTransaction nHeight=%s, isVerifyDB=%s, isCheckWallet=%s, txHash=%s\n", nHeight, isVerifyDB, isCheckWallet, tx.GetHash().ToString());
 //    LogPrintf("transaction = %s\n", tx.ToString());
     // Basic checks that don't depend on any context
@@ -1162,7 +1166,7 @@ bool CheckTransaction(const CTransaction &tx, CValidationState &state, uint256 h
 			    return state.DoS(10, false, REJECT_INVALID, "bad-txns-prevout-null");
 		    }
 	    }
-        if (!CheckZerocoinTransaction(tx, state, Params().GetConsensus(), hashTx, isVerifyDB, nHeight, isCheckWallet, fStatefulZerocoinCheck, zerocoinTxInfo))
+        if (!CheckZerocoinTransaction(tx, state, Params().GetConsensus(), hashTx, isVerifyDB, nHeight, isCheckWallet, fStatefulZerocoinCheck, zerocoinTxInfo, pvZerocoinChecks))
 		    return false;
     }
     return true;
@@ -1798,7 +1802,7 @@ GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::Params
 
     if (pindexSlow) {
         CBlock block;
-        if (ReadBlockFromDisk(block, pindexSlow, consensusParams)) {
+        if (ReadBlockFromDisk(block, pindexSlow, consensusParams, false)) {
             BOOST_FOREACH(
             const CTransaction &tx, block.vtx) {
                 if (tx.GetHash() == hash) {
@@ -1889,7 +1893,7 @@ bool WriteBlockToDisk(const CBlock &block, CDiskBlockPos &pos, const CMessageHea
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, const Consensus::Params &consensusParams) {
+bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, const Consensus::Params &consensusParams, bool fCheckPOW, bool fReadMTPData) {
     block.SetNull();
 
     // Open history file to read
@@ -1899,29 +1903,34 @@ bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, con
 
     // Read block
     try {
-        filein >> block;
+        if (fReadMTPData)
+            filein >> block;
+        else
+            block.SerializationOp(filein, CBlockHeader::CReadBlockSkipMTP(), SER_DISK, CLIENT_VERSION);
     }
     catch (const std::exception &e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    // Block data was verified when it was connected, no need to redo the expensive checks
+    if (!fCheckPOW)
+        return true;
+
     // Jemcash - MTP
-    if (!CheckMerkleTreeProof(block, consensusParams)){
+    // MTP proof can't be checked if MTP data wasn't read, the rest of PoW check is still done
+    if (fReadMTPData && !CheckMerkleTreeProof(block, consensusParams)){
     	return error("ReadBlockFromDisk: CheckMerkleTreeProof: Errors in block header at %s", pos.ToString());
     }
 
     // Check the header
-    if (!CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams)){
-        //Maybe cache is not valid
-        if (!CheckProofOfWork(block.GetPoWHash(nHeight, true), block.nBits, consensusParams)){
-            return error("ReadBlockFromDisk: CheckProofOfWork: Errors in block header at %s", pos.ToString());
-        }
-    }
+    if (!CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+        return error("ReadBlockFromDisk: CheckProofOfWork: Errors in block header at %s", pos.ToString());
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus::Params &consensusParams) {
-    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), pindex->nHeight, consensusParams))
+bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus::Params &consensusParams, bool fReadMTPData) {
+    bool fCheckPOW = fParanoidBlockReads || !(pindex->nStatus & BLOCK_POW_VERIFIED);
+    if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), consensusParams, fCheckPOW, fReadMTPData))
         return false;
     if (block.GetHash() != pindex->GetBlockHash()) {
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -2505,7 +2514,6 @@ bool DisconnectBlock(const CBlock &block, CValidationState &state, const CBlockI
 
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
-    block.InvalidateCachedPoWHash(pindex->nHeight);
 
     //The pfClean flag is specified only when called from CVerifyDB::VerifyDB.
     //When called from there, no real disconnect happens.
@@ -2752,6 +2760,8 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     int64_t nSigOpsCost = 0;
     CDiskTxPos pos(pindex->GetBlockPos(), GetSizeOfCompactSize(block.vtx.size()));
     std::vector <std::pair<uint256, CDiskTxPos>> vPos;
+    // Spend proofs of the block, verified together once all the transactions are checked
+    std::vector<CZerocoinSpendCheck> vBlockZerocoinChecks;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
     CDbIndexHelper dbIndexHelper(fAddressIndex, fSpentIndex);
@@ -2807,10 +2817,16 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
         }
 
         if (tx.IsZerocoinSpend() || tx.IsZerocoinMint()) {
-            // Check transaction against zerocoin state
-            if (!CheckTransaction(tx, state, txHash, false, pindex->nHeight, false, true, block.zerocoinTxInfo.get()))
+            // Check transaction against zerocoin state, spend proofs are verified in parallel
+            std::vector<CZerocoinSpendCheck> vZerocoinChecks;
+            if (!CheckTransaction(tx, state, txHash, false, pindex->nHeight, false, true, block.zerocoinTxInfo.get(),
+                                  nScriptCheckThreads ? &vZerocoinChecks : NULL))
                 return state.DoS(100, error("stateful zerocoin check failed"),
                                  REJECT_INVALID, "bad-txns-zerocoin");
+            for (CZerocoinSpendCheck &check: vZerocoinChecks) {
+                vBlockZerocoinChecks.emplace_back();
+                vBlockZerocoinChecks.back().swap(check);
+            }
         }
 
         if (!fJustCheck)
@@ -2881,8 +2897,22 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     }
     // END JNODE
 
-    if (!control.Wait())
+    // The spend proofs go to the zerocoin workers while the scripts are checked, several of them verified in one
+    // batch. The workers are shared with the proofs themselves, so -par isn't exceeded
+    bool fZerocoinValid = true;
+    libzerocoin::ParallelTasks zerocoinTasks;
+    if (vBlockZerocoinChecks.size() > 1)
+        zerocoinTasks.Add([&vBlockZerocoinChecks, &fZerocoinValid]() { fZerocoinValid = CheckZerocoinSpendsBatch(vBlockZerocoinChecks); });
+    else if (!vBlockZerocoinChecks.empty())
+        zerocoinTasks.Add([&vBlockZerocoinChecks, &fZerocoinValid]() { fZerocoinValid = vBlockZerocoinChecks[0](); });
+
+    bool fScriptsValid = control.Wait();
+    zerocoinTasks.Wait();
+    if (!fScriptsValid)
         return state.DoS(100, false);
+    if (!fZerocoinValid)
+        return state.DoS(100, error("ConnectBlock(): zerocoin spend verification failed"),
+                         REJECT_INVALID, "bad-txns-zerocoin");
     int64_t nTime4 = GetTimeMicros();
     nTimeVerify += nTime4 - nTime2;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime4 - nTime2),
@@ -2897,6 +2927,14 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     if (fJustCheck)
         return true;
 
+    // Jemcash - MTP
+    // Proof of work (including MTP proof) has been checked by CheckBlock above, remember it so
+    // subsequent reads of this block from disk don't have to verify it again
+    if (!(pindex->nStatus & BLOCK_POW_VERIFIED)) {
+        pindex->nStatus |= BLOCK_POW_VERIFIED;
+        setDirtyBlockIndex.insert(pindex);
+    }
+
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull() || !pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
         if (pindex->GetUndoPos().IsNull()) {
@@ -3092,6 +3130,18 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             // Flush the chainstate (which may refer to block index entries).
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            // Snapshot of the zerocoin state so the next start doesn't rebuild it from the genesis block, with the
+            // zerocoin supply of the same block
+            static uint256 hashLastZerocoinSnapshot;
+            if (chainActive.Tip() != NULL && chainActive.Tip()->GetBlockHash() != hashLastZerocoinSnapshot) {
+                CZerocoinStateSnapshot zerocoinSnapshot;
+                CZerocoinState::GetZerocoinState()->GetSnapshot(chainActive.Tip(), zerocoinSnapshot);
+                CZerocoinSupply zerocoinSupply;
+                bool fZerocoinSupply = ZerocoinGetSupply(zerocoinSupply);
+                if (!pblocktree->WriteZerocoinState(zerocoinSnapshot, fZerocoinSupply ? &zerocoinSupply : NULL))
+                    return AbortNode(state, "Failed to write zerocoin state to block index database");
+                hashLastZerocoinSnapshot = chainActive.Tip()->GetBlockHash();
+            }
             nLastFlush = nNow;
         }
         if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) &&
@@ -3897,6 +3947,10 @@ CBlockIndex *AddToBlockIndex(const CBlockHeader &block) {
     // Construct new block index object
     CBlockIndex *pindexNew = new CBlockIndex(block);
     assert(pindexNew);
+    // Keep the scrypt PoW hash, checked before getting here, so that it is
+    // never computed again
+    if (!block.IsMTP())
+        pindexNew->hashPoW = block.GetPoWHash();
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -4059,13 +4113,8 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
 
 //btzc: code from vertcoin, add
 bool CheckBlockHeader(const CBlockHeader &block, CValidationState &state, const Consensus::Params &consensusParams, bool fCheckPOW) {
-    int nHeight = ZerocoinGetNHeight(block);
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(nHeight), block.nBits, consensusParams)) {
-        //Maybe cache is not valid
-        if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(nHeight, true), block.nBits, consensusParams)) {
-            return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
-        }
-    }
+    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
     return true;
 }
 
@@ -4105,7 +4154,7 @@ bool CheckBlock(const CBlock &block, CValidationState &state,
             }
 
                 // Jemcash - MTP
-            if (block.IsMTP() && !CheckMerkleTreeProof(block, consensusParams))
+            if (block.IsMTP() && !block.fMTPVerified && !CheckMerkleTreeProof(block, consensusParams))
                 return state.DoS(100, false, REJECT_INVALID, "bad-diffbits", false, "incorrect proof of work");
         }
 
@@ -4421,6 +4470,12 @@ static bool AcceptBlockHeader(const CBlockHeader &block, CValidationState &state
 //        int nHeight = ZerocoinGetNHeight(block);
 //        int64_t start = std::chrono::duration_cast<std::chrono::milliseconds>(
 //                std::chrono::system_clock::now().time_since_epoch()).count();
+        // Pre-MTP blocks of the main chain have their PoW hash precomputed
+        BlockMap::iterator miPrevPoW = mapBlockIndex.find(block.hashPrevBlock);
+        uint256 powHash;
+        if (!block.IsMTP() && miPrevPoW != mapBlockIndex.end()
+                && GetPrecomputedPoWHash(miPrevPoW->second->nHeight + 1, hash, powHash))
+            powHashCache.Insert(hash, powHash);
         if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPOW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(),
                          FormatStateMessage(state));
@@ -4626,6 +4681,7 @@ void PruneOneBlockFile(const int fileNumber) {
         if (pindex->nFile == fileNumber) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nStatus &= ~BLOCK_POW_VERIFIED;
             pindex->nFile = 0;
             pindex->nDataPos = 0;
             pindex->nUndoPos = 0;
@@ -4895,7 +4951,12 @@ bool static LoadBlockIndexDB() {
 
     // some blocks in index can change as a result of ZerocoinBuildStateFromIndex() call
     set<CBlockIndex *> changes;
-    ZerocoinBuildStateFromIndex(&chainActive, changes);
+    CZerocoinStateSnapshot zerocoinSnapshot;
+    bool fZerocoinSnapshot = pblocktree->ReadZerocoinState(zerocoinSnapshot);
+    CZerocoinSupply zerocoinSupply;
+    bool fZerocoinSupply = pblocktree->ReadZerocoinSupply(zerocoinSupply);
+    ZerocoinBuildStateFromIndex(&chainActive, changes, fZerocoinSnapshot ? &zerocoinSnapshot : NULL,
+                                fZerocoinSupply ? &zerocoinSupply : NULL);
     if (!changes.empty()) {
         setDirtyBlockIndex.insert(changes.begin(), changes.end());
         FlushStateToDisk();
@@ -5074,7 +5135,7 @@ bool RewindBlockIndex(const CChainParams &params) {
             int > (pindexIter->nStatus & BLOCK_VALID_MASK, BLOCK_VALID_TREE) |
             (pindexIter->nStatus & ~BLOCK_VALID_MASK);
             // Remove have-data flags.
-            pindexIter->nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO);
+            pindexIter->nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO | BLOCK_POW_VERIFIED);
             // Remove storage location.
             pindexIter->nFile = 0;
             pindexIter->nDataPos = 0;
@@ -5179,6 +5240,9 @@ bool InitBlockIndex(const CChainParams &chainparams) {
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    // The zerocoin supply is counted as the chain is connected from the genesis block
+    ZerocoinResetSupply(chainparams.GetConsensus().hashGenesisBlock);
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -5308,9 +5372,7 @@ bool LoadExternalBlockFile(const CChainParams &chainparams, FILE *fileIn, CDiskB
                             head);
                     while (range.first != range.second) {
                         std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        uint256 hash = block.GetHash();
-                        int nHeight = mapBlockIndex[hash]->nHeight;
-                        if (ReadBlockFromDisk(block, it->second, nHeight, chainparams.GetConsensus())) {
+                        if (ReadBlockFromDisk(block, it->second, chainparams.GetConsensus())) {
                             LogPrint("reindex", "%s: Processing out of order child %s of %s\n", __func__,
                                      block.GetHash().ToString(),
                                      head.ToString());
@@ -7311,6 +7373,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
         CBlock block;
         vRecv >> block;
         LogPrint("net", "received block %s peer=%d\n", block.GetHash().ToString(), pfrom->id);
+        block.fMTPVerified = mtpPreVerifier.Collect(block);
         CValidationState state;
         // Process all blocks from whitelisted peers, even if not requested,
         // unless we're still syncing with the network.
@@ -7562,6 +7625,19 @@ bool ProcessMessages(CNode *pfrom) {
     // this maintains the order of responses
     if (!pfrom->vRecvGetData.empty()) return fOk;
 
+    // Have the MTP proofs of the queued blocks checked while the messages
+    // before them are processed, each block message is submitted once
+    if (!fImporting && !fReindex && mtpPreVerifier.IsRunning()) {
+        BOOST_FOREACH(CNetMessage &msg, pfrom->vRecvMsg) {
+            if (!msg.complete())
+                break;
+            if (!msg.fMTPSubmitted && msg.hdr.GetCommand() == NetMsgType::BLOCK) {
+                msg.hashMTPCheck = mtpPreVerifier.Submit(std::move(msg.vRecv));
+                msg.fMTPSubmitted = true;
+            }
+        }
+    }
+
     std::deque<CNetMessage>::iterator it = pfrom->vRecvMsg.begin();
     while (!pfrom->fDisconnect && it != pfrom->vRecvMsg.end()) {
         // Don't bother if send buffer is too full to respond anyway
@@ -7575,6 +7651,12 @@ bool ProcessMessages(CNode *pfrom) {
         if (!msg.complete())
             break;
 
+        // take the message back from the MTP pre-verifier
+        if (!msg.hashMTPCheck.IsNull()) {
+            mtpPreVerifier.Reclaim(msg.hashMTPCheck, msg.vRecv);
+            msg.hashMTPCheck.SetNull();
+        }
+
         // at this point, any failure means we can delete the current message
         it++;
 
@@ -1051,7 +1051,14 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
-void static JemcashMiner(const CChainParams &chainparams) {
+namespace {
+CCriticalSection cs_miningEngine;
+/** Solver shared by the worker threads of the running miner */
+boost::shared_ptr<mtp::MiningEngine> miningEngine;
+bool fMinerHugePages = false;
+}
+
+void static JemcashMiner(const CChainParams &chainparams, boost::shared_ptr<mtp::MiningEngine> engine) {
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("jemcash-miner");
 
@@ -1139,19 +1146,37 @@ void static JemcashMiner(const CChainParams &chainparams) {
 
                 while (true) {
                     if (pblock->IsMTP()) {
-                        //sleep(60);
                         LogPrintf("BEFORE: mtp_hash\n");
-                        thash = mtp::hash(*pblock, Params().GetConsensus().powLimit);
+                        if (!engine) {
+                            // The first miner thread mines the MTP blocks on
+                            // the engine, the other ones only mine scrypt
+                            LogPrintf("JemcashMiner: MTP blocks are mined by the first miner thread\n");
+                            return;
+                        }
+                        // The engine spreads the nonces over its threads and
+                        // gives up as soon as the block needs to be rebuilt.
+                        // It polls on this thread, take the locks so that the
+                        // peers and the tip are read consistently.
+                        auto fCancel = [&]() {
+                            if (boost::this_thread::interruption_requested())
+                                return true;
+                            if (chainparams.MiningRequiresPeers()) {
+                                LOCK(cs_vNodes);
+                                if (vNodes.empty())
+                                    return true;
+                            }
+                            if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
+                                return true;
+                            LOCK(cs_main);
+                            return pindexPrev != chainActive.Tip();
+                        };
+                        if (!engine->Solve(*pblock, Params().GetConsensus().powLimit, fCancel, thash))
+                            break;
                         pblock->mtpHashValue = thash;
                     }else {
-                        unsigned long int scrypt_scratpad_size_current_block =
-                                ((1 << (GetNfactor(pblock->nTime) + 1)) * 128) + 63;
-                        char *scratchpad = (char *) malloc(scrypt_scratpad_size_current_block * sizeof(char));
-                        scrypt_N_1_1_256_sp_generic(BEGIN(pblock->nVersion), BEGIN(thash), scratchpad,
-                                                    GetNfactor(pblock->nTime));
+                        scrypt_N_1_1_256(BEGIN(pblock->nVersion), BEGIN(thash), GetNfactor(pblock->nTime));
 //                        LogPrintf("scrypt thash: %s\n", thash.ToString().c_str());
 //                        LogPrintf("hashTarget: %s\n", hashTarget.ToString().c_str());
-                        free(scratchpad);
                     }
 
                     //LogPrintf("*****\nhash   : %s  \ntarget : %s\n", UintToArith256(thash).ToString(), hashTarget.ToString());
@@ -1218,16 +1243,44 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
     if (minerThreads != NULL)
     {
         minerThreads->interrupt_all();
+        // Wait for the miner to leave the engine, which may be reused below
+        minerThreads->join_all();
         delete minerThreads;
         minerThreads = NULL;
     }
 
-    if (nThreads == 0 || !fGenerate)
+    LOCK(cs_miningEngine);
+    if (nThreads == 0 || !fGenerate) {
+        // Release the MTP memory
+        miningEngine.reset();
         return;
+    }
+
+    // Scrypt blocks are mined by nThreads miner threads each building its
+    // own block. MTP blocks are only mined by the first one, the engine runs
+    // nThreads workers over the nonces of each of them. Keep its memory when
+    // only restarting with the same settings.
+    bool fHugePages = GetBoolArg("-minerhugepages", DEFAULT_MINER_HUGEPAGES);
+    if (!miningEngine || miningEngine->GetThreads() != nThreads || fMinerHugePages != fHugePages)
+        miningEngine.reset(new mtp::MiningEngine(nThreads, fHugePages));
+    fMinerHugePages = fHugePages;
 
     minerThreads = new boost::thread_group();
-    for (int i = 0; i < nThreads; i++)
-        minerThreads->create_thread(boost::bind(&JemcashMiner, boost::cref(chainparams)));
+    minerThreads->create_thread(boost::bind(&JemcashMiner, boost::cref(chainparams), miningEngine));
+    for (int i = 1; i < nThreads; i++)
+        minerThreads->create_thread(boost::bind(&JemcashMiner, boost::cref(chainparams), boost::shared_ptr<mtp::MiningEngine>()));
+}
+
+uint64_t GetMiningAttempts()
+{
+    LOCK(cs_miningEngine);
+    return miningEngine ? miningEngine->GetAttempts() : 0;
+}
+
+double GetMiningHashRate()
+{
+    LOCK(cs_miningEngine);
+    return miningEngine ? miningEngine->GetHashRate() : 0;
 }
 
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
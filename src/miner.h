@@ -24,6 +24,8 @@ namespace Consensus { struct Params; };
 
 static const bool DEFAULT_GENERATE = false;
 static const int DEFAULT_GENERATE_THREADS = 1;
+/** Default for -minerhugepages, back the MTP mining memory with huge pages */
+static const bool DEFAULT_MINER_HUGEPAGES = false;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
 
@@ -214,5 +216,9 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 /** Run the miner threads */
 void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainparams);
+/** Number of MTP nonces tried by the running miner */
+uint64_t GetMiningAttempts();
+/** MTP nonces tried per second by the running miner on the current block */
+double GetMiningHashRate();
 
 #endif // BITCOIN_MINER_H
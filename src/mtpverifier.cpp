@@ -0,0 +1,191 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "mtpverifier.h"
+
+#include "chainparams.h"
+#include "pow.h"
+#include "util.h"
+#include "version.h"
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+CMTPPreVerifier mtpPreVerifier;
+
+void CMTPPreVerifier::Start(boost::thread_group& threadGroup, int nThreadsIn)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nThreads = nThreadsIn;
+    }
+    for (int i = 0; i < nThreadsIn; i++)
+        threadGroup.create_thread(boost::bind(&CMTPPreVerifier::ThreadWorker, this));
+}
+
+bool CMTPPreVerifier::IsRunning()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return nThreads > 0;
+}
+
+void CMTPPreVerifier::ThreadWorker()
+{
+    RenameThread("jemcash-mtpcheck");
+    while (true) {
+        uint256 hash;
+        std::shared_ptr<CJob> job;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty())
+                condWorker.wait(lock);
+            hash = queue.front();
+            queue.pop_front();
+            std::map<uint256, std::shared_ptr<CJob> >::iterator mi = mapJobs.find(hash);
+            // Collected, dropped or queued again under the same hash
+            if (mi == mapJobs.end() || mi->second->state != CJob::PENDING)
+                continue;
+            job = mi->second;
+            job->state = CJob::READING;
+        }
+
+        // Read the header in place and rewind, the message is processed
+        // later. The stream only drops its data when read to the end, in which
+        // case the message had no transactions and fails to process anyway.
+        bool fValid = false;
+        bool fRead = false;
+        CDataStream::size_type nSize = job->data.size();
+        try {
+            job->data >> job->header;
+            fRead = true;
+        } catch (const std::exception&) {
+            // Malformed message, left to the regular processing to report
+        }
+        job->data.Rewind(nSize - job->data.size());
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            job->state = CJob::CHECKING;
+        }
+        condDone.notify_all();
+
+        try {
+            fValid = fRead
+                && job->header.GetHash() == hash
+                && CheckMerkleTreeProof(job->header, Params().GetConsensus());
+        } catch (const std::exception&) {
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            job->fValid = fValid;
+            job->state = CJob::DONE;
+        }
+        condDone.notify_all();
+    }
+}
+
+uint256 CMTPPreVerifier::Submit(CDataStream&& vRecv)
+{
+    // Only read the fixed part of the header to identify the block, the
+    // workers read the rest
+    static const size_t HEADER_PEEK_SIZE = 180;
+    CBlockHeader header;
+    try {
+        CDataStream ssHeader(vRecv.begin(), vRecv.begin() + std::min(vRecv.size(), HEADER_PEEK_SIZE),
+                SER_NETWORK, PROTOCOL_VERSION);
+        header.SerializationOp(ssHeader, CBlockHeader::CReadBlockHeader(), SER_NETWORK, PROTOCOL_VERSION);
+    } catch (const std::exception&) {
+        return uint256();
+    }
+    if (!header.IsMTP())
+        return uint256();
+    uint256 hash = header.GetHash();
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nThreads == 0 || mapJobs.count(hash))
+            return uint256();
+        mapJobs.insert(std::make_pair(hash, std::make_shared<CJob>(std::move(vRecv))));
+        queue.push_back(hash);
+        order.push_back(hash);
+        // Drop the oldest jobs nobody collected, but not the messages
+        std::deque<uint256>::iterator it = order.begin();
+        while (order.size() > MAX_JOBS && it != order.end()) {
+            std::map<uint256, std::shared_ptr<CJob> >::iterator mi = mapJobs.find(*it);
+            if (mi->second->fHasData) {
+                ++it;
+                continue;
+            }
+            mapJobs.erase(mi);
+            it = order.erase(it);
+        }
+    }
+    condWorker.notify_one();
+    return hash;
+}
+
+void CMTPPreVerifier::Reclaim(const uint256& hash, CDataStream& vRecv)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    std::map<uint256, std::shared_ptr<CJob> >::iterator mi = mapJobs.find(hash);
+    assert(mi != mapJobs.end() && mi->second->fHasData);
+    std::shared_ptr<CJob> job = mi->second;
+    if (job->state == CJob::PENDING) {
+        // The block is about to be processed, it is checked then
+        mapJobs.erase(mi);
+        order.erase(std::find(order.begin(), order.end(), hash));
+    }
+    while (job->state == CJob::READING)
+        condDone.wait(lock);
+    vRecv = std::move(job->data);
+    job->fHasData = false;
+}
+
+void CMTPPreVerifier::Discard(const uint256& hash)
+{
+    CDataStream data(SER_NETWORK, PROTOCOL_VERSION);
+    Reclaim(hash, data);
+    boost::unique_lock<boost::mutex> lock(mutex);
+    std::map<uint256, std::shared_ptr<CJob> >::iterator mi = mapJobs.find(hash);
+    if (mi != mapJobs.end()) {
+        mapJobs.erase(mi);
+        order.erase(std::find(order.begin(), order.end(), hash));
+    }
+}
+
+bool CMTPPreVerifier::Collect(const CBlock& block)
+{
+    if (!block.IsMTP() || !block.mtpHashData)
+        return false;
+
+    uint256 hash = block.GetHash();
+    std::shared_ptr<CJob> job;
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::map<uint256, std::shared_ptr<CJob> >::iterator mi = mapJobs.find(hash);
+        if (mi == mapJobs.end())
+            return false;
+        job = mi->second;
+        if (job->state == CJob::PENDING)
+            return false;
+        // The job of the same block from another peer stays until its message
+        // is reclaimed
+        if (!job->fHasData) {
+            mapJobs.erase(mi);
+            // Or a block sent again would have its new job dropped in its place
+            order.erase(std::find(order.begin(), order.end(), hash));
+        }
+        while (job->state != CJob::DONE)
+            condDone.wait(lock);
+    }
+
+    // Another peer may have sent the same header with different MTP data
+    return job->fValid
+        && job->header.mtpHashData
+        && job->header.mtpHashValue == block.mtpHashValue
+        && *job->header.mtpHashData == *block.mtpHashData;
+}
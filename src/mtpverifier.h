@@ -0,0 +1,106 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef __JEMCASH_MTPVERIFIER_H
+#define __JEMCASH_MTPVERIFIER_H
+
+#include "primitives/block.h"
+#include "streams.h"
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace boost { class thread_group; }
+
+/**
+ * Checks MTP proofs of received blocks ahead of their processing.
+ *
+ * MTP proofs only depend on the block header and its MTP data, so they can be
+ * checked as soon as a "block" message arrives, without cs_main and while the
+ * messages before it are being processed. Blocks are queued with Submit()
+ * and checked by worker threads in arrival order. The message is moved in
+ * rather than copied and must be taken back with Reclaim() before it is
+ * processed. When the block is finally processed, Collect() tells whether its
+ * proof was found valid, in which case CheckBlock() does not check it again.
+ */
+class CMTPPreVerifier
+{
+private:
+    struct CJob
+    {
+        enum State { PENDING, READING, CHECKING, DONE };
+
+        //! The "block" message, until it is reclaimed
+        CDataStream data;
+        bool fHasData;
+        //! Header and MTP data of the block, read by the worker
+        CBlockHeader header;
+        State state;
+        bool fValid;
+
+        CJob(CDataStream&& dataIn) : data(std::move(dataIn)), fHasData(true), state(PENDING), fValid(false) {}
+    };
+
+    //! Jobs are dropped past this count, oldest first, if nobody collects them.
+    //! Jobs still holding their message are kept until it is reclaimed.
+    static const size_t MAX_JOBS = 128;
+
+    //! Mutex to protect the inner state
+    boost::mutex mutex;
+
+    //! Worker threads block on this when out of work
+    boost::condition_variable condWorker;
+
+    //! Reclaim() and Collect() block on this while the job they want is running
+    boost::condition_variable condDone;
+
+    //! Jobs by block hash
+    std::map<uint256, std::shared_ptr<CJob> > mapJobs;
+
+    //! Hashes of the jobs to run, oldest first
+    std::deque<uint256> queue;
+
+    //! Hashes of all the jobs, oldest first, to drop the ones never collected
+    std::deque<uint256> order;
+
+    int nThreads;
+
+    void ThreadWorker();
+
+public:
+    CMTPPreVerifier() : nThreads(0) {}
+
+    //! Start `nThreads` worker threads in `threadGroup`
+    void Start(boost::thread_group& threadGroup, int nThreads);
+
+    //! Whether there are worker threads to submit blocks to
+    bool IsRunning();
+
+    /** Queue the check of the block in `vRecv`, a "block" message.
+     *  Returns the hash of the block if the message was moved in, to be
+     *  reclaimed, or a null hash if it was left in `vRecv`. */
+    uint256 Submit(CDataStream&& vRecv);
+
+    /** Move the message submitted for block `hash` back into `vRecv`, once
+     *  the header is read. A check not started yet is given up. */
+    void Reclaim(const uint256& hash, CDataStream& vRecv);
+
+    //! Drop the job of block `hash` with its message, the message is not processed
+    void Discard(const uint256& hash);
+
+    /** Whether the MTP proof of `block` was checked and found valid.
+     *  Waits if the check is running, but not if it did not start yet, as the
+     *  caller is better off checking the block itself. */
+    bool Collect(const CBlock& block);
+};
+
+extern CMTPPreVerifier mtpPreVerifier;
+
+#endif
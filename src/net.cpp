@@ -16,6 +16,7 @@
 #include "crypto/common.h"
 #include "crypto/sha256.h"
 #include "hash.h"
+#include "mtpverifier.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
 #include "ui_interface.h"
@@ -512,7 +513,16 @@ void CNode::CloseSocketDisconnect() {
     // in case this fails, we'll empty the recv buffer when the CNode is deleted
     TRY_LOCK(cs_vRecvMsg, lockRecv);
     if (lockRecv)
-        vRecvMsg.clear();
+        ClearRecvMsg();
+}
+
+// requires LOCK(cs_vRecvMsg)
+void CNode::ClearRecvMsg() {
+    // The MTP pre-verifier keeps the block messages it holds until told
+    BOOST_FOREACH(CNetMessage &msg, vRecvMsg)
+        if (!msg.hashMTPCheck.IsNull())
+            mtpPreVerifier.Discard(msg.hashMTPCheck);
+    vRecvMsg.clear();
 }
 
 void CNode::PushVersion() {
@@ -2864,6 +2874,8 @@ CNode::CNode(SOCKET hSocketIn, const CAddress &addrIn, const std::string &addrNa
 CNode::~CNode() {
     CloseSocket(hSocket);
 
+    ClearRecvMsg();
+
     if (pfilter)
         delete pfilter;
 
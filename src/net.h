@@ -248,12 +248,16 @@ public:
 
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
+    bool fMTPSubmitted;             // handed to the MTP pre-verifier, see CMTPPreVerifier
+    uint256 hashMTPCheck;           // the pre-verifier holds vRecv for this block until it is reclaimed
+
     CNetMessage(const CMessageHeader::MessageStartChars& pchMessageStartIn, int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), hdr(pchMessageStartIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
         nTime = 0;
+        fMTPSubmitted = false;
     }
 
     bool complete() const
@@ -526,13 +530,16 @@ public:
     {
         unsigned int total = 0;
         BOOST_FOREACH(const CNetMessage &msg, vRecvMsg)
-            total += msg.vRecv.size() + 24;
+            total += (msg.hashMTPCheck.IsNull() ? msg.vRecv.size() : msg.hdr.nMessageSize) + 24;
         return total;
     }
 
     // requires LOCK(cs_vRecvMsg)
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
 
+    // requires LOCK(cs_vRecvMsg)
+    void ClearRecvMsg();
+
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
     {
@@ -14,13 +14,16 @@
 #include "chainparams.h"
 #include "crypto/scrypt.h"
 #include "crypto/MerkleTreeProof/mtp.h"
+#include "primitives/powcache.h"
+#include "primitives/precomputed_hash.h"
 #include "util.h"
 #include <iostream>
 #include <chrono>
 #include <fstream>
 #include <algorithm>
+#include <map>
 #include <string>
-#include "precomputed_hash.h"
+#include <string.h>
 
 
 
@@ -45,6 +48,19 @@ unsigned char GetNfactor(int64_t nTimestamp) {
     return std::min(std::max(N, Params().GetConsensus().nMinNFactor), Params().GetConsensus().nMaxNFactor);
 }  
 
+bool GetPrecomputedPoWHash(int nHeight, const uint256& hash, uint256& powHash) {
+    static const size_t RECORD_SIZE = 64;
+    static const size_t nRecords = (sizeof(precomputedPoWHashes) - 1) / RECORD_SIZE;
+    if (nHeight < 0 || (size_t)nHeight >= nRecords)
+        return false;
+
+    const char *record = precomputedPoWHashes + nHeight * RECORD_SIZE;
+    if (memcmp(record, hash.begin(), 32) != 0)
+        return false;
+    memcpy(powHash.begin(), record + 32, 32);
+    return true;
+}
+
 uint256 CBlockHeader::GetHash() const {
     return SerializeHash(*this);
 }
@@ -55,38 +71,48 @@ bool CBlockHeader::IsMTP() const {
     return nTime > JC_GENESIS_BLOCK_TIME && nTime >= Params().GetConsensus().nMTPSwitchTime;
 }
 
-uint256 CBlockHeader::GetPoWHash(int nHeight, bool forceCalc) const {
-//    int64_t start = std::chrono::duration_cast<std::chrono::milliseconds>(
-//            std::chrono::system_clock::now().time_since_epoch()).count();
-    bool fTestNet = (Params().NetworkIDString() == CBaseChainParams::TESTNET);
-    if (!fTestNet) {
-        if (!forceCalc && mapPoWHash.count(nHeight)) {
-//        std::cout << "GetPowHash nHeight=" << nHeight << ", hash= " << mapPoWHash[nHeight].ToString() << std::endl;
-            return mapPoWHash[nHeight];
-        }
-    }
-    uint256 powHash;
+uint256 CBlockHeader::GetPoWHash() const {
     // Jemcash - MTP
+    if (IsMTP())
+        return mtpHashValue;
+
+    uint256 hash = GetHash();
+    uint256 powHash;
+    if (powHashCache.Get(hash, powHash))
+        return powHash;
     try {
-    	if (IsMTP()) {
-            powHash = mtpHashValue;
-		}else {
-            scrypt_N_1_1_256(BEGIN(nVersion), BEGIN(powHash), GetNfactor(nTime));
-        } 
+        scrypt_N_1_1_256(BEGIN(nVersion), BEGIN(powHash), GetNfactor(nTime));
     } catch (std::exception &e) {
         LogPrintf("exception: %s", e.what());
     }
-//    int64_t end = std::chrono::duration_cast<std::chrono::milliseconds>(
-//            std::chrono::system_clock::now().time_since_epoch()).count();
-//    std::cout << "GetPowHash nHeight=" << nHeight << ", hash= " << powHash.ToString() << " done in= " << (end - start) << " miliseconds" << std::endl;
-    mapPoWHash.insert(make_pair(nHeight, powHash));
-//    SetPoWHash(thash);
+    powHashCache.Insert(hash, powHash);
     return powHash;
 }
 
-void CBlockHeader::InvalidateCachedPoWHash(int nHeight) const {
-	if (mapPoWHash.count(nHeight) > 0)
-        mapPoWHash.erase(nHeight);
+void ComputePoWHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& powHashes) {
+    powHashes.assign(headers.size(), uint256());
+
+    // Headers to hash by N factor, the rest is cached or MTP
+    std::map<unsigned char, std::vector<size_t> > mapToHash;
+    for (size_t i = 0; i < headers.size(); i++) {
+        const CBlockHeader& header = headers[i];
+        if (header.IsMTP())
+            powHashes[i] = header.mtpHashValue;
+        else if (!powHashCache.Get(header.GetHash(), powHashes[i]))
+            mapToHash[GetNfactor(header.nTime)].push_back(i);
+    }
+
+    for (const auto& entry : mapToHash) {
+        std::vector<const char*> vInput;
+        std::vector<char*> vOutput;
+        for (size_t i : entry.second) {
+            vInput.push_back(BEGIN(headers[i].nVersion));
+            vOutput.push_back(BEGIN(powHashes[i]));
+        }
+        scrypt_N_1_1_256_multi(vInput.data(), vOutput.data(), vInput.size(), entry.first);
+        for (size_t i : entry.second)
+            powHashCache.Insert(headers[i].GetHash(), powHashes[i]);
+    }
 }
 
 std::string CBlock::ToString() const {
@@ -18,6 +18,10 @@
 
 unsigned char GetNfactor(int64_t nTimestamp);
 
+/** Look the precomputed scrypt PoW hash of main chain block `hash` at height
+ *  `nHeight` up, false if the block is not in the table */
+bool GetPrecomputedPoWHash(int nHeight, const uint256& hash, uint256& powHash);
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -36,7 +40,7 @@ class CMTPHashData {
 public:
     uint8_t hashRootMTP[16]; // 16 is 128 bit of blake2b
     uint64_t nBlockMTP[mtp::MTP_L*2][128]; // 128 is ARGON2_QWORDS_IN_BLOCK
-    std::deque<std::vector<uint8_t>> nProofMTP[mtp::MTP_L*3];
+    mtp::Proofs proofMTP;
 
     CMTPHashData() {
         memset(nBlockMTP, 0, sizeof(nBlockMTP));
@@ -54,14 +58,11 @@ public:
         READWRITE(hashRootMTP);
         READWRITE(nBlockMTP);
         for (int i = 0; i < mtp::MTP_L*3; i++) {
-            assert(nProofMTP[i].size() < 256);
-            uint8_t numberOfProofBlocks = (uint8_t)nProofMTP[i].size();
+            assert(proofMTP.Size(i) < 256);
+            uint8_t numberOfProofBlocks = (uint8_t)proofMTP.Size(i);
             READWRITE(numberOfProofBlocks);
-            for (const std::vector<uint8_t> &mtpData: nProofMTP[i]) {
-                // data size should be 16 for each block
-                assert(mtpData.size() == 16);
-                s.write((const char *)mtpData.data(), 16);
-            }
+            // data size is 16 for each block
+            s.write((const char *)proofMTP.Data(i), numberOfProofBlocks * 16);
         }
     }
 
@@ -70,14 +71,29 @@ public:
     inline void SerializationOp(Stream &s, CSerActionUnserialize ser_action, int nType, int nVersion) {
         READWRITE(hashRootMTP);
         READWRITE(nBlockMTP);
+        proofMTP.Clear();
         for (int i = 0; i < mtp::MTP_L*3; i++) {
             uint8_t numberOfProofBlocks;
             READWRITE(numberOfProofBlocks);
-            for (uint8_t j=0; j<numberOfProofBlocks; j++) {
-                vector<uint8_t> mtpData(16, 0);
-                s.read((char *)mtpData.data(), 16);
-                nProofMTP[i].emplace_back(std::move(mtpData));
-            }
+            s.read((char *)proofMTP.Append(numberOfProofBlocks), numberOfProofBlocks * 16);
+        }
+    }
+
+    bool operator==(const CMTPHashData &other) const
+    {
+        return memcmp(hashRootMTP, other.hashRootMTP, sizeof(hashRootMTP)) == 0
+            && memcmp(nBlockMTP, other.nBlockMTP, sizeof(nBlockMTP)) == 0
+            && proofMTP == other.proofMTP;
+    }
+
+    // Advance the stream past serialized MTP data without deserializing it
+    template <typename Stream>
+    static void Skip(Stream &s, int nType, int nVersion) {
+        s.ignore(sizeof(CMTPHashData::hashRootMTP) + sizeof(CMTPHashData::nBlockMTP));
+        for (int i = 0; i < mtp::MTP_L*3; i++) {
+            uint8_t numberOfProofBlocks;
+            ::Unserialize(s, numberOfProofBlocks, nType, nVersion);
+            s.ignore(numberOfProofBlocks * 16);
         }
     }
 };
@@ -119,6 +135,8 @@ public:
     class CSerializeBlockHeader {};
     class CReadBlockHeader : public CSerActionUnserialize, public CSerializeBlockHeader {};
     class CWriteBlockHeader : public CSerActionSerialize, public CSerializeBlockHeader {};
+    // Read everything but MTP data (mtpHashData is left empty)
+    class CReadBlockSkipMTP : public CSerActionUnserialize, public CSerializeBlockHeader {};
 
     template <typename Stream, typename Operation, typename = typename std::enable_if<!std::is_base_of<CSerializeBlockHeader,Operation>::value>::type>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
@@ -162,6 +180,14 @@ public:
         }
     }
 
+    template <typename Stream>
+    inline void SerializationOp(Stream &s, CReadBlockSkipMTP ser_action, int nType, int nVersion) {
+        SerializationOp(s, CReadBlockHeader(), nType, nVersion);
+        mtpHashData.reset();
+        if (IsMTP())
+            CMTPHashData::Skip(s, nType, nVersion);
+    }
+
     void SetNull()
     {
         nVersion = CBlockHeader::CURRENT_VERSION | (GetZerocoinChainID() * BLOCK_VERSION_CHAIN_START);
@@ -201,7 +227,9 @@ public:
 //        powHash = hash;
     }
 
-    uint256 GetPoWHash(int nHeight, bool forceCalc = false) const;
+    /** Scrypt hash of the header, or the MTP hash for MTP blocks. Scrypt
+     *  hashes are kept in powHashCache by block hash. */
+    uint256 GetPoWHash() const;
 
     uint256 GetHash() const;
 
@@ -210,7 +238,6 @@ public:
         return (int64_t)nTime;
     }
 
-    void InvalidateCachedPoWHash(int nHeight) const;
 
     bool IsMTP() const;
 };
@@ -227,6 +254,7 @@ public:
     mutable CTxOut txoutJnode; // jnode payment
     mutable std::vector<CTxOut> voutSuperblock; // superblock payment
     mutable bool fChecked;
+    mutable bool fMTPVerified; // MTP proof already checked, see CMTPPreVerifier
 
     // memory only, zerocoin tx info
     mutable std::shared_ptr<CZerocoinTxInfo> zerocoinTxInfo;
@@ -261,6 +289,12 @@ public:
         CBlockHeader::SerializationOp(s, ser_action, nType, nVersion);
     }
 
+    template <typename Stream>
+    inline void SerializationOp(Stream &s, CReadBlockSkipMTP ser_action, int nType, int nVersion) {
+        CBlockHeader::SerializationOp(s, ser_action, nType, nVersion);
+        READWRITE(vtx);
+    }
+
     void SetNull()
     {
         ZerocoinClean();
@@ -269,6 +303,7 @@ public:
         txoutJnode = CTxOut();
         voutSuperblock.clear();
         fChecked = false;
+        fMTPVerified = false;
     }
 
     CBlockHeader GetBlockHeader() const
@@ -332,4 +367,7 @@ struct CBlockLocator
 /** Compute the consensus-critical block weight (see BIP 141). */
 int64_t GetBlockWeight(const CBlock& tx);
 
+/** PoW hashes of `headers`, hashing the scrypt ones several at a time */
+void ComputePoWHashes(const std::vector<CBlockHeader>& headers, std::vector<uint256>& powHashes);
+
 #endif // BITCOIN_PRIMITIVES_BLOCK_H
@@ -0,0 +1,78 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/powcache.h"
+
+#include <algorithm>
+
+CPoWHashCache powHashCache;
+
+CPoWHashCache::CPoWHashCache(size_t nMaxEntries)
+    : nMaxShardEntries(std::max<size_t>(nMaxEntries / SHARDS, 1)),
+      nHits(0), nMisses(0), nEvictions(0)
+{
+}
+
+CPoWHashCache::Shard& CPoWHashCache::GetShard(const uint256& hash)
+{
+    // The low bytes are used by the hasher of the shard maps
+    return shards[*(hash.end() - 1) % SHARDS];
+}
+
+bool CPoWHashCache::Get(const uint256& hash, uint256& powHash)
+{
+    Shard& shard = GetShard(hash);
+    boost::unique_lock<boost::mutex> lock(shard.cs);
+    auto mi = shard.map.find(hash);
+    if (mi == shard.map.end()) {
+        nMisses++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, mi->second);
+    powHash = mi->second->second;
+    nHits++;
+    return true;
+}
+
+void CPoWHashCache::Insert(const uint256& hash, const uint256& powHash)
+{
+    Shard& shard = GetShard(hash);
+    boost::unique_lock<boost::mutex> lock(shard.cs);
+    auto mi = shard.map.find(hash);
+    if (mi != shard.map.end()) {
+        mi->second->second = powHash;
+        shard.lru.splice(shard.lru.begin(), shard.lru, mi->second);
+        return;
+    }
+    shard.lru.push_front(std::make_pair(hash, powHash));
+    shard.map.emplace(hash, shard.lru.begin());
+    while (shard.map.size() > nMaxShardEntries) {
+        shard.map.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+        nEvictions++;
+    }
+}
+
+void CPoWHashCache::Clear()
+{
+    for (Shard& shard : shards) {
+        boost::unique_lock<boost::mutex> lock(shard.cs);
+        shard.map.clear();
+        shard.lru.clear();
+    }
+}
+
+CPoWHashCache::Stats CPoWHashCache::GetStats()
+{
+    Stats stats;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+    stats.nEntries = 0;
+    for (Shard& shard : shards) {
+        boost::unique_lock<boost::mutex> lock(shard.cs);
+        stats.nEntries += shard.map.size();
+    }
+    return stats;
+}
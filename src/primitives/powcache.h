@@ -0,0 +1,82 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_PRIMITIVES_POWCACHE_H
+#define BITCOIN_PRIMITIVES_POWCACHE_H
+
+#include "uint256.h"
+
+#include <atomic>
+#include <list>
+#include <utility>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+
+/** Default for the number of PoW hashes kept in the cache */
+static const size_t DEFAULT_POW_HASH_CACHE_SIZE = 50000;
+
+/**
+ * Cache of scrypt PoW hashes of block headers, keyed by block hash.
+ *
+ * The entries are spread over shards by block hash, each with its own lock
+ * and its own least recently used list, so that the message handler, RPC and
+ * miner threads rarely wait for each other. Each shard holds at most its
+ * share of the total size, evicting its least recently used entries.
+ */
+class CPoWHashCache
+{
+public:
+    struct Stats
+    {
+        uint64_t nHits;
+        uint64_t nMisses;
+        uint64_t nEvictions;
+        size_t nEntries;
+    };
+
+    explicit CPoWHashCache(size_t nMaxEntries = DEFAULT_POW_HASH_CACHE_SIZE);
+
+    /** Look the PoW hash of block `hash` up, marking it as recently used */
+    bool Get(const uint256& hash, uint256& powHash);
+
+    /** Store the PoW hash of block `hash` */
+    void Insert(const uint256& hash, const uint256& powHash);
+
+    /** Remove all the entries, statistics are kept */
+    void Clear();
+
+    Stats GetStats();
+
+private:
+    static const int SHARDS = 16;
+
+    struct Hasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    typedef std::list<std::pair<uint256, uint256> > list_type;
+
+    struct Shard
+    {
+        boost::mutex cs;
+        //! Most recently used first
+        list_type lru;
+        boost::unordered_map<uint256, list_type::iterator, Hasher> map;
+    };
+
+    Shard shards[SHARDS];
+    size_t nMaxShardEntries;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nEvictions;
+
+    Shard& GetShard(const uint256& hash);
+};
+
+/** PoW hashes of recently seen block headers, see CBlockHeader::GetPoWHash() */
+extern CPoWHashCache powHashCache;
+
+#endif // BITCOIN_PRIMITIVES_POWCACHE_H
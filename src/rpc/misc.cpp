@@ -9,6 +9,7 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "primitives/powcache.h"
 #include "rpc/server.h"
 #include "timedata.h"
 #include "txmempool.h"
@@ -21,6 +22,7 @@
 #endif
 #include "txdb.h"
 #include "zerocoin.h"
+#include "libzerocoin/ParallelTasks.h"
 
 #include <stdint.h>
 
@@ -1030,93 +1032,49 @@ UniValue gettotalsupply(const UniValue& params, bool fHelp)
     return result;
 }
 
-namespace {
-bool getZerocoinSupply(CAmount & amount) {
-    using idx_rec = std::pair<CAddressIndexKey, CAmount>;
-    std::vector<idx_rec> addressIndex;
-
-    if(!GetAddressIndex(uint160(), AddressType::zerocoinSpend, addressIndex))
-        return false;
-
-    auto predicate = [](idx_rec const & lhs, idx_rec const & rhs) {
-        if(lhs.first.blockHeight < rhs.first.blockHeight)
-            return true;
-        if(lhs.first.blockHeight > rhs.first.blockHeight)
-            return false;
-        return lhs.first.txindex < lhs.first.txindex;
-    };
-
-    if(!std::is_sorted(addressIndex.begin(), addressIndex.end(), predicate))
-        std::sort(addressIndex.begin(), addressIndex.end(), predicate);
-
-    using spend_value = std::pair<uint256, size_t>;
-    std::map<CBigNum, spend_value> originalSerials;
-    CAmount amt = 0;
-
-    for(idx_rec const & idr : addressIndex) {
-        CTransaction tx;
-        uint256 hash;
-
-        if(!GetTransaction(idr.first.txhash, tx, Params().GetConsensus(), hash, true))
-            return false;
-
-        size_t num = 0;
-        for(CTxIn const & in : tx.vin) {
-            ++num;
-            if(!in.IsZerocoinSpend())
-                continue;
-
-            CBigNum zspendSerial = CBigNum(0);
-            libzerocoin::CoinDenomination zspendAmount;
-
-            try {
-                CDataStream serializedCoinSpend((const char *)&*(in.scriptSig.begin() + 4),
-                                            (const char *)&*in.scriptSig.end(),
-                                            SER_NETWORK, PROTOCOL_VERSION);
-                libzerocoin::CoinSpend spend(in.nSequence >= JC_MODULUS_V2_BASE_ID ? ZCParamsV2 : ZCParams, serializedCoinSpend);
-                zspendSerial = spend.getCoinSerialNumber();
-                zspendAmount = spend.getDenomination();
-            }
-            catch (const std::runtime_error &) {
-                continue;
-            }
-
-            auto const iter = originalSerials.find(zspendSerial);
-            if(iter == originalSerials.end())
-                originalSerials.insert({zspendSerial, spend_value(tx.GetHash(), num)});
-            else if(iter->second != spend_value(tx.GetHash(), num)){
-                amt += zspendAmount * COIN;
-            }
-        }
-    }
-    amount = amt;
-    return true;
-}
-}
-
 UniValue getzerocoinsupply(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
         throw runtime_error(
                 "getzerocoinsupply\n"
-                        "\nReturns zerocoin amount. This function is very slow by design.\n"
+                        "\nReturns the amount the zerocoin spends of serials used before added to the supply, with the amounts\n"
+                        "minted and spent per denomination.\n"
                         "\nArguments: none\n"
                         "\nResult:\n"
                         "{\n"
-                        "  \"total\"  (string) The total supply in duffs\n"
+                        "  \"total\"  (string) The amount spent again in duffs\n"
+                        "  \"denominations\": [\n"
+                        "    {\n"
+                        "      \"denomination\"  (numeric) The denomination\n"
+                        "      \"minted\"  (string) The amount minted in duffs\n"
+                        "      \"spent\"  (string) The amount spent in duffs\n"
+                        "    }, ...\n"
+                        "  ]\n"
                         "}\n"
                         "\nExamples:\n"
                 + HelpExampleCli("getzerocoinsupply", "")
                 + HelpExampleRpc("getzerocoinsupply", "")
         );
 
-    CAmount total = 0;
+    CZerocoinSupply supply;
+    {
+        LOCK(cs_main);
+        if(!ZerocoinGetSupply(supply))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "The zerocoin supply isn't counted in the database. Counting it requires reindexing.");
+    }
 
-    if(!getZerocoinSupply(total))
-        throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot read the zerocoin supply from the database. This functionality requires -addressindex to be enabled. Enabling -addressindex requires reindexing.");
+    UniValue denominations(UniValue::VARR);
+    for(std::pair<int, CAmount> const & minted : supply.minted) {
+        UniValue denomination(UniValue::VOBJ);
+        denomination.push_back(Pair("denomination", minted.first));
+        denomination.push_back(Pair("minted", minted.second));
+        denomination.push_back(Pair("spent", supply.spent[minted.first]));
+        denominations.push_back(denomination);
+    }
 
     UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("total", total));
+    result.push_back(Pair("total", supply.respent));
+    result.push_back(Pair("denominations", denominations));
 
     return result;
 }
@@ -1147,6 +1105,21 @@ UniValue getinfoex(const UniValue& params, bool fHelp)
         "  \"relayfee\": x.xxxx,         (numeric) minimum relay fee for non-free transactions in " + CURRENCY_UNIT + "/kB\n"
         "  \"errors\": \"...\"           (string) any error messages\n"
         "  \"moneysupply\": \"...\"      (numeric) current coinbase supply summed with the current zerocoin supply\n"
+        "  \"powcache\": {               (json object) cache of scrypt PoW hashes\n"
+        "    \"entries\": xxxxx,         (numeric) number of hashes in the cache\n"
+        "    \"hits\": xxxxx,            (numeric) number of lookups found in the cache\n"
+        "    \"misses\": xxxxx,          (numeric) number of lookups not found in the cache\n"
+        "    \"evictions\": xxxxx        (numeric) number of hashes dropped to keep the cache bounded\n"
+        "  },\n"
+        "  \"zerocoinworkers\": {        (json object) threads computing zerocoin proofs\n"
+        "    \"threads\": xxxxx,         (numeric) number of worker threads\n"
+        "    \"queued\": xxxxx,          (numeric) number of batches of tasks waiting for workers\n"
+        "    \"maxqueued\": xxxxx,       (numeric) most batches ever waiting at once\n"
+        "    \"batches\": xxxxx,         (numeric) number of batches of tasks added\n"
+        "    \"chunks\": xxxxx,          (numeric) number of chunks of tasks run\n"
+        "    \"wakeups\": xxxxx,         (numeric) number of times a worker woke up to find work\n"
+        "    \"overflows\": xxxxx        (numeric) number of batches run by their caller alone as the queue was full\n"
+        "  }\n"
         "}\n"
         "\nExamples:\n"
         + HelpExampleCli("getinfo", "")
@@ -1155,15 +1128,38 @@ UniValue getinfoex(const UniValue& params, bool fHelp)
 
     UniValue info = getinfo(params, fHelp);
 
-    CAmount total = 0, zerocoin = 0;
+    CAmount total = 0;
+    CZerocoinSupply zerocoin;
 
     if(!pblocktree->ReadTotalSupply(total))
         throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot read the total supply from the database");
 
-    if(!getZerocoinSupply(zerocoin))
-        throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot read the total supply from the database");
+    {
+        LOCK(cs_main);
+        if(!ZerocoinGetSupply(zerocoin))
+            throw JSONRPCError(RPC_DATABASE_ERROR, "Cannot read the zerocoin supply from the database");
+    }
 
-    info.push_back(Pair("moneysupply", total + zerocoin));
+    info.push_back(Pair("moneysupply", total + zerocoin.respent));
+
+    CPoWHashCache::Stats powCacheStats = powHashCache.GetStats();
+    UniValue powCache(UniValue::VOBJ);
+    powCache.push_back(Pair("entries", (uint64_t)powCacheStats.nEntries));
+    powCache.push_back(Pair("hits", powCacheStats.nHits));
+    powCache.push_back(Pair("misses", powCacheStats.nMisses));
+    powCache.push_back(Pair("evictions", powCacheStats.nEvictions));
+    info.push_back(Pair("powcache", powCache));
+
+    libzerocoin::ParallelTasks::Stats workerStats = libzerocoin::ParallelTasks::GetStats();
+    UniValue workers(UniValue::VOBJ);
+    workers.push_back(Pair("threads", workerStats.nThreads));
+    workers.push_back(Pair("queued", (uint64_t)workerStats.nQueued));
+    workers.push_back(Pair("maxqueued", (uint64_t)workerStats.nMaxQueued));
+    workers.push_back(Pair("batches", workerStats.nBatches));
+    workers.push_back(Pair("chunks", workerStats.nChunks));
+    workers.push_back(Pair("wakeups", workerStats.nWakeups));
+    workers.push_back(Pair("overflows", workerStats.nOverflows));
+    info.push_back(Pair("zerocoinworkers", workers));
 
     return info;
 }
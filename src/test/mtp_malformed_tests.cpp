@@ -158,9 +158,8 @@ BOOST_AUTO_TEST_CASE(mtp_malformed)
     memset(bMtp.mtpHashData->hashRootMTP, 0, sizeof(bMtp.mtpHashData->hashRootMTP));
     memset(bMtp.mtpHashData->nBlockMTP, 0, sizeof(bMtp.mtpHashData->nBlockMTP));
     for(unsigned int i = 0; i < 192; i++)
-        for(unsigned int j = 0; j < bMtp.mtpHashData->nProofMTP[i].size(); j++)
-            for(unsigned int k = 0; k < bMtp.mtpHashData->nProofMTP[i][j].size(); k++)
-                bMtp.mtpHashData->nProofMTP[i][j][k] = 0;
+        for(unsigned int k = 0; k < bMtp.mtpHashData->proofMTP.Size(i) * mtp::Proofs::NODE_SIZE; k++)
+            bMtp.mtpHashData->proofMTP.Data(i)[k] = 0;
     ProcessBlock(bMtp);
     BOOST_CHECK_MESSAGE(previousHeight == chainActive.Height(), "Block connected with incorrect proof");
 
@@ -172,9 +171,8 @@ BOOST_AUTO_TEST_CASE(mtp_malformed)
 
     bMtp = CreateBlock(noTxns, scriptPubKeyMtpMalformed, mtp);
     for(unsigned int i = 0; i < 192; i++)
-        for(unsigned int j = 0; j < bMtp.mtpHashData->nProofMTP[i].size(); j++)
-            for(unsigned int k = 0; k < bMtp.mtpHashData->nProofMTP[i][j].size(); k++)
-                bMtp.mtpHashData->nProofMTP[i][j][k] = 0;
+        for(unsigned int k = 0; k < bMtp.mtpHashData->proofMTP.Size(i) * mtp::Proofs::NODE_SIZE; k++)
+            bMtp.mtpHashData->proofMTP.Data(i)[k] = 0;
     ProcessBlock(bMtp);
     BOOST_CHECK_MESSAGE(previousHeight == chainActive.Height(), "Block connected with missing proof");
 
@@ -186,17 +184,20 @@ BOOST_AUTO_TEST_CASE(mtp_malformed)
         for(unsigned int j = 0; j < 128; j++)
         bMtp.mtpHashData->nBlockMTP[i][j] = rand();
     for(unsigned int i = 0; i < 192; i++)
-        for(unsigned int j = 0; j < bMtp.mtpHashData->nProofMTP[i].size(); j++)
-            for(unsigned int k = 0; k < bMtp.mtpHashData->nProofMTP[i][j].size(); k++)
-                bMtp.mtpHashData->nProofMTP[i][j][k] = rand()%256;
+        for(unsigned int k = 0; k < bMtp.mtpHashData->proofMTP.Size(i) * mtp::Proofs::NODE_SIZE; k++)
+            bMtp.mtpHashData->proofMTP.Data(i)[k] = rand()%256;
     ProcessBlock(bMtp);
     BOOST_CHECK_MESSAGE(previousHeight == chainActive.Height(), "Block connected with incorrect proof");
 
     bMtp = CreateBlock(noTxns, scriptPubKeyMtpMalformed, mtp);
     previousHeight = chainActive.Height();
-    for(unsigned int i = 0; i < 192; i++)
-        for(unsigned int j = 0; j < bMtp.mtpHashData->nProofMTP[i].size(); j++)
-            bMtp.mtpHashData->nProofMTP[i][j].resize(bMtp.mtpHashData->nProofMTP[i][j].size()/2);
+    {
+        // keep only the first half of every proof
+        mtp::Proofs truncated;
+        for(unsigned int i = 0; i < 192; i++)
+            truncated.Append(bMtp.mtpHashData->proofMTP.Data(i), bMtp.mtpHashData->proofMTP.Size(i)/2);
+        bMtp.mtpHashData->proofMTP = truncated;
+    }
     ProcessBlock(bMtp);
     BOOST_CHECK_MESSAGE(previousHeight == chainActive.Height(), "Block connected with incorrect proof");
 
@@ -209,11 +210,13 @@ BOOST_AUTO_TEST_CASE(mtp_malformed)
         == 0, "Serialize does not match unserialize");
     BOOST_CHECK_MESSAGE(memcmp(outh.nBlockMTP, bMtp.mtpHashData->nBlockMTP, sizeof(outh.nBlockMTP))
         == 0, "Serialize does not match unserialize");
-    for(unsigned int i = 0; i < 192; i++)
-        for(unsigned int j = 0; j < bMtp.mtpHashData->nProofMTP[i].size(); j++)
-            for(unsigned int k = 0; k < bMtp.mtpHashData->nProofMTP[i][j].size(); k++)
-                BOOST_CHECK_MESSAGE(outh.nProofMTP[i][j][k] == bMtp.mtpHashData->nProofMTP[i][j][k],
-                     "Serialize does not match unserialize");
+    for(unsigned int i = 0; i < 192; i++) {
+        BOOST_CHECK_MESSAGE(outh.proofMTP.Size(i) == bMtp.mtpHashData->proofMTP.Size(i),
+             "Serialize does not match unserialize");
+        BOOST_CHECK_MESSAGE(memcmp(outh.proofMTP.Data(i), bMtp.mtpHashData->proofMTP.Data(i),
+             bMtp.mtpHashData->proofMTP.Size(i) * mtp::Proofs::NODE_SIZE) == 0,
+             "Serialize does not match unserialize");
+    }
 
     mybufstream.clear();
     mybufstream << *bMtp.mtpHashData;
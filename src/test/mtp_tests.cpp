@@ -1,8 +1,20 @@
 #include "crypto/MerkleTreeProof/mtp.h"
+#include "crypto/MerkleTreeProof/merkle-tree.hpp"
+#include "crypto/MerkleTreeProof/simd.h"
+#include "crypto/MerkleTreeProof/blake2/blake2.h"
+#include "arith_uint256.h"
 #include "test/test_bitcoin.h"
 #include "random.h"
+#include "chainparams.h"
+#include "streams.h"
+#include "clientversion.h"
+#include "mtpverifier.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
 #include <iostream>
+#include <boost/multiprecision/cpp_int.hpp>
 #include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
 
 using namespace std;
 
@@ -40,7 +52,7 @@ BOOST_AUTO_TEST_CASE(mtp_impl_integrity_test)
     uint8_t hash_root_mtp[16];
     unsigned int nonce;
     uint64_t block_mtp[mtp::MTP_L*2][128];
-    std::deque<std::vector<uint8_t>> proof_mtp[mtp::MTP_L*3];
+    mtp::Proofs proof_mtp;
     uint256 output;
 
     mtp::impl::mtp_hash(input, target, hash_root_mtp, nonce, block_mtp, proof_mtp,
@@ -50,6 +62,54 @@ BOOST_AUTO_TEST_CASE(mtp_impl_integrity_test)
     bool ok = mtp::impl::mtp_verify(input, target, hash_root_mtp, nonce, block_mtp,
             proof_mtp, pow_limit);
     BOOST_CHECK_MESSAGE(ok, "mtp_verify() failed");
+
+    // The proof holds whatever the instruction set of the verifier
+    int isa = mtp_isa_current();
+    for (int i = 0; i < MTP_ISA_COUNT; i++) {
+        if (!mtp_isa_supported(i))
+            continue;
+        mtp_isa_select(i);
+        ok = mtp::impl::mtp_verify(input, target, hash_root_mtp, nonce, block_mtp,
+                proof_mtp, pow_limit);
+        BOOST_CHECK_MESSAGE(ok, std::string("mtp_verify() failed with ") + mtp_isa_name(i));
+    }
+    mtp_isa_select(isa);
+}
+
+BOOST_AUTO_TEST_CASE(mtp_simd_test)
+{
+    // Outputs of the reference code, every instruction set must match them
+    block input;
+    for (int i = 0; i < ARGON2_QWORDS_IN_BLOCK; i++)
+        input.v[i] = UINT64_C(0x9e3779b97f4a7c15) * (i + 1);
+    std::vector<uint8_t> message(8 * ARGON2_BLOCK_SIZE);
+    for (size_t i = 0; i < message.size(); i++)
+        message[i] = (uint8_t)(i * 131 + 7);
+
+    int isa = mtp_isa_current();
+    for (int i = 0; i < MTP_ISA_COUNT; i++) {
+        if (!mtp_isa_supported(i))
+            continue;
+        BOOST_CHECK_EQUAL(mtp_isa_select(i), i);
+        uint256 digest;
+
+        block permuted = input;
+        blamka_permute(&permuted);
+        blake2b(digest.begin(), 32, &permuted, sizeof(permuted), NULL, 0);
+        BOOST_CHECK_MESSAGE(HexStr(digest.begin(), digest.end()) == "dbb4d64d5b0a438309a02d77e0b3f91d3ab8b869ee755f248d3bead182b171d4",
+                std::string("blamka_permute() with ") + mtp_isa_name(i));
+
+        blake2b(digest.begin(), 32, message.data(), 1000, NULL, 0);
+        BOOST_CHECK_MESSAGE(HexStr(digest.begin(), digest.end()) == "109d4c66307a14be694feb326a7b83e35c22e0efbfe4a8ebb6360c6eca00b09e",
+                std::string("blake2b() with ") + mtp_isa_name(i));
+
+        uint8_t leaves[8 * MERKLE_TREE_ELEMENT_SIZE_B];
+        blake2b_4r_many(leaves, MERKLE_TREE_ELEMENT_SIZE_B, message.data(), ARGON2_BLOCK_SIZE, 8);
+        blake2b(digest.begin(), 32, leaves, sizeof(leaves), NULL, 0);
+        BOOST_CHECK_MESSAGE(HexStr(digest.begin(), digest.end()) == "5eafc7878b41000956dbdebbfa17bf9509dcd067f471883940e39f94066c460d",
+                std::string("blake2b_4r_many() with ") + mtp_isa_name(i));
+    }
+    mtp_isa_select(isa);
 }
 
 
@@ -94,5 +154,234 @@ BOOST_AUTO_TEST_CASE(mtp_block_integrity_test)
     BOOST_CHECK(false == mtp::verify(block3.nNonce+1, block3, pow_limit));
 }
 
+BOOST_AUTO_TEST_CASE(mtp_mining_engine_test)
+{
+    CBlock block;
+    block.nVersion = CBlock::CURRENT_VERSION;
+    block.hashPrevBlock = GetRandHash();
+    block.hashMerkleRoot = GetRandHash();
+    block.nTime = GetRandInt(std::numeric_limits<decltype(block.nTime)>::max());
+    block.nBits = 0x2000ffffUL;
+    block.nVersionMTP = 1;
+
+    uint256 pow_limit = uint256S("00ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+    mtp::MiningEngine engine(2);
+    uint256 hash;
+    BOOST_CHECK(engine.Solve(block, pow_limit, []() { return false; }, hash));
+    BOOST_CHECK(block.mtpHashData);
+    BOOST_CHECK(engine.GetAttempts() > 0);
+
+    uint256 hashVerified;
+    BOOST_CHECK(mtp::verify(block.nNonce, block, pow_limit, &hashVerified));
+    BOOST_CHECK(hash == hashVerified);
+
+    // The memory is kept for the next header, which is solved from its own nonce
+    ++block.nTime;
+    block.nNonce = 1000;
+    BOOST_CHECK(engine.Solve(block, pow_limit, []() { return false; }, hash));
+    BOOST_CHECK(block.nNonce >= 1000);
+    BOOST_CHECK(mtp::verify(block.nNonce, block, pow_limit));
+
+    // A cancelled search leaves the header alone
+    block.nBits = 0x1d00ffffUL;
+    block.nNonce = 0;
+    block.mtpHashData.reset();
+    BOOST_CHECK(!engine.Solve(block, pow_limit, []() { return true; }, hash));
+    BOOST_CHECK_EQUAL(block.nNonce, 0);
+    BOOST_CHECK(!block.mtpHashData);
+}
+
+BOOST_AUTO_TEST_CASE(mtp_block_skip_data_test)
+{
+    CBlock block;
+    block.nVersion = CBlock::CURRENT_VERSION;
+    block.hashPrevBlock = GetRandHash();
+    block.hashMerkleRoot = GetRandHash();
+    block.nTime = JC_GENESIS_BLOCK_TIME + 1000;
+    block.nBits = 0x2000ffffUL;
+    block.nVersionMTP = 0x1000;
+    block.mtpHashValue = GetRandHash();
+
+    Params(CBaseChainParams::REGTEST).SetRegTestMtpSwitchTime(block.nTime);
+    BOOST_CHECK(block.IsMTP());
+
+    block.mtpHashData = std::make_shared<CMTPHashData>();
+    for (int i = 0; i < mtp::MTP_L*3; i++) {
+        uint8_t *nodes = block.mtpHashData->proofMTP.Append(i % 23);
+        for (int j = 0; j < i % 23; j++)
+            memset(nodes + j*mtp::Proofs::NODE_SIZE, (uint8_t)(i+j), mtp::Proofs::NODE_SIZE);
+    }
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << 1;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 50;
+    block.vtx.push_back(tx);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+
+    CBlock blockRead;
+    blockRead.SerializationOp(ss, CBlockHeader::CReadBlockSkipMTP(), SER_DISK, CLIENT_VERSION);
+
+    BOOST_CHECK(ss.empty());
+    BOOST_CHECK(!blockRead.mtpHashData);
+    BOOST_CHECK(blockRead.GetHash() == block.GetHash());
+    BOOST_CHECK(blockRead.mtpHashValue == block.mtpHashValue);
+    BOOST_CHECK_EQUAL(blockRead.vtx.size(), 1);
+    BOOST_CHECK(blockRead.vtx[0].GetHash() == block.vtx[0].GetHash());
+
+    Params(CBaseChainParams::REGTEST).SetRegTestMtpSwitchTime(INT_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(mtp_pre_verifier_test)
+{
+    CBlock block;
+    block.nVersion = CBlock::CURRENT_VERSION;
+    block.hashPrevBlock = GetRandHash();
+    block.hashMerkleRoot = GetRandHash();
+    block.nTime = JC_GENESIS_BLOCK_TIME + 1000;
+    block.nBits = 0x2000ffffUL;
+    block.nVersionMTP = 0x1000;
+
+    Params(CBaseChainParams::REGTEST).SetRegTestMtpSwitchTime(block.nTime);
+    BOOST_CHECK(block.IsMTP());
+    block.mtpHashValue = mtp::hash(block, Params().GetConsensus().powLimit);
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block;
+
+    CMTPPreVerifier verifier;
+    boost::thread_group threadGroup;
+    verifier.Start(threadGroup, 2);
+
+    // The message is moved in and handed back as it was
+    CDataStream ssSubmitted(ss);
+    BOOST_CHECK(verifier.Submit(std::move(ssSubmitted)) == block.GetHash());
+    // Leave the workers plenty of time to check it
+    MilliSleep(2000);
+    verifier.Reclaim(block.GetHash(), ssSubmitted);
+    BOOST_CHECK(ssSubmitted.str() == ss.str());
+
+    CBlock blockTampered(block);
+    blockTampered.mtpHashData = std::make_shared<CMTPHashData>(*block.mtpHashData);
+    blockTampered.mtpHashData->nBlockMTP[0][0] ^= 1;
+    BOOST_CHECK(!verifier.Collect(blockTampered));
+
+    // Collected jobs are forgotten
+    ssSubmitted = ss;
+    BOOST_CHECK(verifier.Submit(std::move(ssSubmitted)) == block.GetHash());
+    MilliSleep(2000);
+    // Until its message is reclaimed, the job stays for it
+    BOOST_CHECK(verifier.Collect(block));
+    verifier.Reclaim(block.GetHash(), ssSubmitted);
+    BOOST_CHECK(verifier.Collect(block));
+    BOOST_CHECK(!verifier.Collect(block));
+
+    // Sent again, the block is not dropped for the jobs it had before: with
+    // other blocks up to MAX_JOBS in all its job stays
+    ssSubmitted = ss;
+    verifier.Submit(std::move(ssSubmitted));
+    std::vector<uint256> vOther;
+    for (uint32_t i = 1; i < 128; i++) {
+        CBlock blockOther(block);
+        blockOther.nNonce += i;
+        CDataStream ssOther(SER_NETWORK, PROTOCOL_VERSION);
+        ssOther << blockOther;
+        vOther.push_back(verifier.Submit(std::move(ssOther)));
+    }
+    MilliSleep(2000);
+    verifier.Reclaim(block.GetHash(), ssSubmitted);
+    BOOST_FOREACH(const uint256& hash, vOther)
+        verifier.Discard(hash);
+    BOOST_CHECK(verifier.Collect(block));
+
+    // A job not started is given up when its message is reclaimed
+    ssSubmitted = ss;
+    verifier.Submit(std::move(ssSubmitted));
+    verifier.Reclaim(block.GetHash(), ssSubmitted);
+    BOOST_CHECK(ssSubmitted.str() == ss.str());
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    Params(CBaseChainParams::REGTEST).SetRegTestMtpSwitchTime(INT_MAX);
+}
+
+BOOST_AUTO_TEST_CASE(mtp_merkle_tree_test)
+{
+    // Trees built from consecutive hashes must match the ones built from
+    // a list of elements, for every shape of the last layers
+    for (size_t n = 1; n <= 33; n++) {
+        std::vector<uint8_t> leaves(n * MERKLE_TREE_ELEMENT_SIZE_B);
+        for (size_t i = 0; i < leaves.size(); i++)
+            leaves[i] = insecure_rand();
+        MerkleTree::Elements elements;
+        for (size_t i = 0; i < n; i++)
+            elements.emplace_back(&leaves[i * MERKLE_TREE_ELEMENT_SIZE_B], &leaves[(i + 1) * MERKLE_TREE_ELEMENT_SIZE_B]);
+
+        MerkleTree tree(elements, true);
+        MerkleTree flatTree(leaves);
+        BOOST_CHECK(tree.getRoot() == flatTree.getRoot());
+        BOOST_CHECK_EQUAL(flatTree.size(), n);
+
+        for (size_t i = 0; i < n; i++) {
+            MerkleTree::Elements proof = tree.getProofOrdered(elements[i], i + 1);
+            BOOST_CHECK(proof == flatTree.proofForIndex(i));
+
+            std::vector<uint8_t> flatProof;
+            size_t size = flatTree.proofForIndex(i, flatProof);
+            BOOST_CHECK_EQUAL(size, proof.size());
+
+            // MTP trees always have a power of 2 leaves, the only shape for
+            // which checkProofOrdered() is expected to succeed everywhere
+            if ((n & (n - 1)) == 0) {
+                BOOST_CHECK(MerkleTree::checkProofOrdered(proof, flatTree.getRoot(), elements[i], i + 1));
+                BOOST_CHECK(MerkleTree::checkProofOrdered(flatProof.data(), size,
+                        flatTree.getRoot().data(), elements[i].data(), i + 1));
+            }
+        }
+        BOOST_CHECK_THROW(flatTree.proofForIndex(n), std::runtime_error);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mtp_block_index_test)
+{
+    // Indices of the opened blocks are y[j-1] mod M_COST, they used to be
+    // computed with boost::multiprecision and must not change
+    const uint32_t mCost = 1024 * 1024 * 4;
+    struct {
+        const char *y;
+        uint32_t modMCost;
+        uint32_t modPrime;
+    } vectors[] = {
+        {"0000000000000000000000000000000000000000000000000000000000000000", 0, 0},
+        {"ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", 4194303, 156648},
+        {"0000000000000000000000000000000000000000000000000000000000000001", 1, 1},
+        {"00000000000000000000000000000000000000000000000000000000003fffff", 4194303, 194291},
+        {"0000000000000000000000000000000000000000000000000000000000400000", 0, 194292},
+        {"0000000000000000000000000000000000000000000000000000000000400001", 1, 194293},
+        {"8000000000000000000000000000000000000000000000000000000000000000", 0, 578326},
+        {"d76d4330f1446beab0c11fdecb91ce375bc8fbbcbde5c0994164d8399f767c45", 3570757, 415121},
+        {"c6a5387777330bdbd7210dff076ce2ef87b0b125ec1d7da0a6eb8c9ebd69fe29", 2752041, 362227},
+        {"5f2dd97f1cfb10f62827688de6a16a3b0d464138a62332553fc1ea36f17fd374", 4182900, 931292},
+        {"3fd4235992edcf451a1afe878b33e968617959ce3f1f65a8de5271007814e8a2", 1370274, 29991},
+        {"de11cc9dea959c212e9c82b1478c281d687c966c377b9aa2bb2edb20035b7399", 1799065, 72643},
+    };
+    for (const auto &v : vectors) {
+        uint256 y = uint256S(v.y);
+        BOOST_CHECK_EQUAL(UintToArith256(y).Mod32(mCost), v.modMCost);
+        BOOST_CHECK_EQUAL(UintToArith256(y).Mod32(1000003), v.modPrime);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        uint256 y = GetRandHash();
+        uint32_t d = (i % 2) ? mCost : (insecure_rand() | 1);
+        boost::multiprecision::uint256_t t("0x" + y.GetHex());
+        BOOST_CHECK_EQUAL(UintToArith256(y).Mod32(d), (uint32_t)(t % d));
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
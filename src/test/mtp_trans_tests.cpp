@@ -145,6 +145,16 @@ BOOST_AUTO_TEST_CASE(mtp_transition)
     BOOST_CHECK_MESSAGE(previousHeight == chainActive.Height() - 1, "Block not connected");
     coinbaseTxns.push_back(b.vtx[0]);
     LOCK(cs_main);
+
+    // Connected block should be marked as verified and read back without redoing MTP verification
+    {
+        CBlockIndex *pindex = mapBlockIndex[b.GetHash()];
+        BOOST_CHECK_MESSAGE(pindex->nStatus & BLOCK_POW_VERIFIED, "Block proof not marked as verified");
+        CBlock blockFromDisk;
+        BOOST_CHECK(ReadBlockFromDisk(blockFromDisk, pindex, Params().GetConsensus()));
+        BOOST_CHECK(blockFromDisk.GetHash() == b.GetHash());
+        BOOST_CHECK(blockFromDisk.mtpHashData && CheckMerkleTreeProof(blockFromDisk, Params().GetConsensus()));
+    }
     {
         LOCK(pwalletMain->cs_wallet);
         pwalletMain->AddToWalletIfInvolvingMe(b.vtx[0], &b, true);
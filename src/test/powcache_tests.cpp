@@ -0,0 +1,80 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/powcache.h"
+
+#include "primitives/block.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powcache_tests, BasicTestingSetup)
+
+static uint256 HashInShard(uint8_t nShard, uint8_t n)
+{
+    // The shard is picked from the last byte
+    uint256 hash;
+    *hash.begin() = n;
+    *(hash.end() - 1) = nShard;
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(powcache_lru_test)
+{
+    // 16 shards of 2 entries each
+    CPoWHashCache cache(32);
+    uint256 a = HashInShard(0, 1), b = HashInShard(0, 2), c = HashInShard(0, 3);
+    uint256 other = HashInShard(1, 1);
+    uint256 pow;
+
+    BOOST_CHECK(!cache.Get(a, pow));
+    cache.Insert(a, b);
+    cache.Insert(b, c);
+    cache.Insert(other, a);
+    BOOST_CHECK(cache.Get(a, pow));
+    BOOST_CHECK(pow == b);
+
+    // b is now the least recently used of its shard and goes first
+    cache.Insert(c, a);
+    BOOST_CHECK(!cache.Get(b, pow));
+    BOOST_CHECK(cache.Get(a, pow));
+    BOOST_CHECK(cache.Get(c, pow));
+    BOOST_CHECK(pow == a);
+    // Other shards are not affected
+    BOOST_CHECK(cache.Get(other, pow));
+
+    // Inserting again updates the value
+    cache.Insert(c, b);
+    BOOST_CHECK(cache.Get(c, pow));
+    BOOST_CHECK(pow == b);
+
+    CPoWHashCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nEntries, 3U);
+    BOOST_CHECK_EQUAL(stats.nHits, 5U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 2U);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 1U);
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Get(a, pow));
+    BOOST_CHECK_EQUAL(cache.GetStats().nEntries, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(powcache_block_header_test)
+{
+    CBlockHeader header = Params().GenesisBlock().GetBlockHeader();
+    BOOST_CHECK(!header.IsMTP());
+
+    powHashCache.Clear();
+    uint64_t nHits = powHashCache.GetStats().nHits;
+    uint256 powHash = header.GetPoWHash();
+    BOOST_CHECK_EQUAL(powHashCache.GetStats().nHits, nHits);
+    BOOST_CHECK(header.GetPoWHash() == powHash);
+    BOOST_CHECK_EQUAL(powHashCache.GetStats().nHits, nHits + 1);
+
+    // Headers differing only by their nonce are cached apart
+    ++header.nNonce;
+    BOOST_CHECK(header.GetPoWHash() != powHash);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/scrypt.h"
+
+#include "test/test_bitcoin.h"
+#include "utilstrencodings.h"
+
+#include <string.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(scrypt_tests, BasicTestingSetup)
+
+static void FillInput(char *input, int n)
+{
+    for (int i = 0; i < 80; i++)
+        input[i] = (char)(n * 31 + i * 13);
+}
+
+BOOST_AUTO_TEST_CASE(scrypt_known_answers)
+{
+    char input[80], output[32];
+
+    FillInput(input, 0);
+    scrypt_N_1_1_256(input, output, 10);
+    BOOST_CHECK_EQUAL(HexStr(output, output + 32), "c144278db7050de249ec7071cd6bcd92201f3dcda4dc398ab9c3286a37c37802");
+
+    // The scratchpad of the thread grows for the larger N factor
+    FillInput(input, 1);
+    scrypt_N_1_1_256(input, output, 12);
+    BOOST_CHECK_EQUAL(HexStr(output, output + 32), "72e8051c0088ec045ef4afea14de76d77e5e6dbc0f7910c8dae56bd7b43a172f");
+
+    // And is reused by the smaller one
+    FillInput(input, 0);
+    scrypt_N_1_1_256(input, output, 10);
+    BOOST_CHECK_EQUAL(HexStr(output, output + 32), "c144278db7050de249ec7071cd6bcd92201f3dcda4dc398ab9c3286a37c37802");
+}
+
+BOOST_AUTO_TEST_CASE(scrypt_multi)
+{
+    // Not a multiple of the lane count, so some are hashed one by one
+    static const int COUNT = 19;
+    char inputs[COUNT][80], outputs[COUNT][32], expected[COUNT][32];
+    const char *vInput[COUNT];
+    char *vOutput[COUNT];
+
+    for (int i = 0; i < COUNT; i++) {
+        FillInput(inputs[i], i);
+        vInput[i] = inputs[i];
+        vOutput[i] = outputs[i];
+        scrypt_N_1_1_256(inputs[i], expected[i], 10);
+    }
+
+    scrypt_N_1_1_256_multi(vInput, vOutput, COUNT, 10);
+    for (int i = 0; i < COUNT; i++)
+        BOOST_CHECK(memcmp(outputs[i], expected[i], 32) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
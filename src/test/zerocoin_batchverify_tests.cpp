@@ -0,0 +1,61 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "libzerocoin/Zerocoin.h"
+#include "zerocoin.h"
+#include "test/test_bitcoin.h"
+
+#include <memory>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace libzerocoin;
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_batchverify_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(zerocoin_batchverify_test)
+{
+    const int nSpends = 3;
+    std::vector<std::unique_ptr<PrivateCoin>> coins;
+    Accumulator accumulator(ZCParamsV2, ZQ_LOVELACE);
+    for (int i = 0; i < nSpends; i++) {
+        coins.emplace_back(new PrivateCoin(ZCParamsV2, ZQ_LOVELACE, ZEROCOIN_TX_VERSION_2));
+        accumulator += coins.back()->getPublicCoin();
+    }
+    Accumulator otherAccumulator(ZCParamsV2, ZQ_LOVELACE);
+    otherAccumulator += coins[0]->getPublicCoin();
+
+    std::vector<std::unique_ptr<CoinSpend>> spends;
+    std::vector<SpendMetaData> metadata;
+    for (int i = 0; i < nSpends; i++) {
+        AccumulatorWitness witness(ZCParamsV2, Accumulator(ZCParamsV2, ZQ_LOVELACE), coins[i]->getPublicCoin());
+        for (int j = 0; j < nSpends; j++) {
+            if (j != i)
+                witness += coins[j]->getPublicCoin();
+        }
+        metadata.push_back(SpendMetaData(1, ArithToUint256(arith_uint256(i + 1))));
+        spends.emplace_back(new CoinSpend(ZCParamsV2, *coins[i], accumulator, witness, metadata[i]));
+        spends.back()->setVersion(ZEROCOIN_TX_VERSION_2);
+    }
+
+    // A spend holds if one of its accumulators does
+    CoinSpendBatchVerifier batch;
+    for (int i = 0; i < nSpends; i++)
+        batch.Add(spends[i].get(), metadata[i], {otherAccumulator, accumulator});
+    BOOST_CHECK(batch.Verify() == std::vector<bool>(nSpends, true));
+
+    // Failing spends are told apart from the others
+    CoinSpendBatchVerifier badBatch;
+    badBatch.Add(spends[0].get(), metadata[0], {accumulator});
+    badBatch.Add(spends[1].get(), metadata[0], {accumulator});
+    badBatch.Add(spends[2].get(), metadata[2], {otherAccumulator});
+    std::vector<bool> results = badBatch.Verify();
+    BOOST_CHECK(results[0]);
+    BOOST_CHECK(!results[1]);
+    BOOST_CHECK(!results[2]);
+    for (int i = 0; i < 3; i++)
+        BOOST_CHECK_EQUAL(results[i], spends[i]->Verify(i == 2 ? otherAccumulator : accumulator, metadata[i == 1 ? 0 : i]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
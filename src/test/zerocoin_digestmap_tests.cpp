@@ -0,0 +1,90 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zerocoin_digestmap.h"
+
+#include "libzerocoin/Zerocoin.h"
+#include "random.h"
+#include "test/test_bitcoin.h"
+
+#include <algorithm>
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_digestmap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(zerocoin_digestmap_test)
+{
+    // Few numbers for many entries, so most have several values and probe sequences run into each other
+    std::vector<CBigNum> numbers;
+    for (int i = 0; i < 300; i++)
+        numbers.push_back(CBigNum(i) * CBigNum(i % 2 ? 1 : -1) + CBigNum(1000000 * (i % 7)));
+
+    CBigNumDigestMap<int> digestMap;
+    std::map<CBigNum, std::vector<int> > expected;
+    size_t nExpected = 0;
+    for (int round = 0; round < 20000; round++) {
+        const CBigNum& bn = numbers[insecure_rand() % numbers.size()];
+        std::vector<int>& values = expected[bn];
+        int value = insecure_rand() % 4;
+        switch (insecure_rand() % 8) {
+        case 0: {
+            // erase one value
+            std::vector<int>::iterator it = std::find(values.begin(), values.end(), value);
+            BOOST_CHECK_EQUAL(digestMap.erase_if(bn, [value](int v) { return v == value; }), it != values.end());
+            if (it != values.end()) {
+                values.erase(it);
+                nExpected--;
+            }
+            break;
+        }
+        case 1:
+            // erase them all
+            BOOST_CHECK_EQUAL(digestMap.erase(bn), values.size());
+            nExpected -= values.size();
+            values.clear();
+            break;
+        default:
+            digestMap.insert(bn, value);
+            values.push_back(value);
+            nExpected++;
+        }
+
+        BOOST_CHECK_EQUAL(digestMap.size(), nExpected);
+        BOOST_CHECK_EQUAL(digestMap.count(bn), values.size());
+        const int* found = digestMap.find_if(bn, [value](int v) { return v == value; });
+        BOOST_CHECK_EQUAL(found != NULL, std::count(values.begin(), values.end(), value) > 0);
+        BOOST_CHECK(found == NULL || *found == value);
+    }
+
+    size_t nEntries = 0;
+    digestMap.ForEach([&nEntries](const uint256& digest, int) { nEntries++; BOOST_CHECK(!digest.IsNull()); });
+    BOOST_CHECK_EQUAL(nEntries, nExpected);
+    for (std::map<CBigNum, std::vector<int> >::const_iterator it = expected.begin(); it != expected.end(); ++it)
+        BOOST_CHECK_EQUAL(digestMap.count(GetBigNumDigest(it->first)), it->second.size());
+
+    // Copies are independent, clearing frees the table
+    CBigNumDigestMap<int> copy = digestMap;
+    digestMap.clear();
+    BOOST_CHECK(digestMap.empty() && digestMap.DynamicMemoryUsage() == 0);
+    BOOST_CHECK(digestMap.find(numbers[0]) == NULL);
+    BOOST_CHECK_EQUAL(copy.size(), nExpected);
+
+    // Reserved room is not grown into
+    digestMap.reserve(1000);
+    size_t nUsage = digestMap.DynamicMemoryUsage();
+    for (int i = 0; i < 1000; i++)
+        digestMap.insert(CBigNum(i), i);
+    BOOST_CHECK_EQUAL(digestMap.DynamicMemoryUsage(), nUsage);
+    BOOST_CHECK(*digestMap.find(CBigNum(999)) == 999);
+
+    CBigNumDigestSet digestSet;
+    digestSet.insert(CBigNum(5));
+    digestSet.insert(CBigNum(5));
+    BOOST_CHECK_EQUAL(digestSet.count(CBigNum(5)), 2U);
+    BOOST_CHECK_EQUAL(digestSet.count(CBigNum(-5)), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
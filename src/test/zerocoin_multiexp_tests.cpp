@@ -0,0 +1,80 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "libzerocoin/Zerocoin.h"
+#include "streams.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_multiexp_tests, BasicTestingSetup)
+
+static CBigNum RandomExponent(int nBits, bool fNegative)
+{
+    CBigNum exp = CBigNum::RandKBitBigum(nBits);
+    return fNegative ? -exp : exp;
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_multiexp_test)
+{
+    CBigNum m = CBigNum::generatePrime(512) * CBigNum::generatePrime(512);
+    CBigNum g = CBigNum::randBignum(m), h = CBigNum::randBignum(m), base = CBigNum::randBignum(m);
+
+    std::vector<CBigNum> fixedBases;
+    fixedBases.push_back(g);
+    fixedBases.push_back(h);
+    CBigNumFixedBases powers(fixedBases, m, 600);
+
+    // Exponents shorter and longer than the precomputed powers, of both signs and zero
+    for (int i = 0; i < 40; i++) {
+        std::vector<CBigNum> exps;
+        exps.push_back(i % 5 == 0 ? CBigNum(0) : RandomExponent(1 + i * 20, i % 3 == 0));
+        exps.push_back(RandomExponent(1 + i * 7, i % 4 == 0));
+        CBigNum exp = RandomExponent(256, i % 2 == 0);
+
+        CBigNum expected = g.pow_mod(exps[0], m).mul_mod(h.pow_mod(exps[1], m), m).mul_mod(base.pow_mod(exp, m), m);
+
+        std::vector<CBigNum> allBases(fixedBases), allExps(exps);
+        allBases.push_back(base);
+        allExps.push_back(exp);
+        BOOST_CHECK(CBigNum::mul_pow_mod(allBases, allExps, m) == expected);
+        BOOST_CHECK(powers.pow_mod(exps, std::vector<CBigNum>(1, base), std::vector<CBigNum>(1, exp)) == expected);
+    }
+
+    // Even moduli are not for Montgomery multiplication
+    CBigNum even = m + 1;
+    std::vector<CBigNum> exps(2, CBigNum(12345));
+    BOOST_CHECK(CBigNum::mul_pow_mod(fixedBases, exps, even) == g.pow_mod(exps[0], even).mul_mod(h.pow_mod(exps[1], even), even));
+
+    // A negative exponent needs its base to be invertible
+    BOOST_CHECK_THROW(CBigNum::mul_pow_mod(std::vector<CBigNum>(1, m), std::vector<CBigNum>(1, CBigNum(-1)), m), bignum_error);
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_multiexp_params_test)
+{
+    libzerocoin::IntegerGroupParams group;
+    group.modulus = CBigNum::generatePrime(256);
+    group.g = CBigNum::randBignum(group.modulus);
+    group.h = CBigNum::randBignum(group.modulus);
+    CBigNum gExp = RandomExponent(300, false), hExp = RandomExponent(200, true);
+    CBigNum expected = group.g.pow_mod(gExp, group.modulus).mul_mod(group.h.pow_mod(hExp, group.modulus), group.modulus);
+
+    BOOST_CHECK(!group.ghPowers);
+    BOOST_CHECK(group.multiExp(gExp, hExp, group.modulus) == expected);
+    group.precompute(group.modulus, 256);
+    BOOST_CHECK(group.ghPowers);
+    BOOST_CHECK(group.multiExp(gExp, hExp, group.modulus) == expected);
+
+    // Powers modulo another modulus are not used
+    CBigNum other = CBigNum::generatePrime(256);
+    BOOST_CHECK(group.multiExp(gExp, hExp, other) == group.g.pow_mod(gExp, other).mul_mod(group.h.pow_mod(hExp, other), other));
+
+    // Deserialization drops the powers
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << group;
+    ss >> group;
+    BOOST_CHECK(!group.ghPowers);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
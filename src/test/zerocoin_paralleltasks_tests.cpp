@@ -0,0 +1,61 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "libzerocoin/Zerocoin.h"
+#include "libzerocoin/ParallelTasks.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <stdexcept>
+
+#include <boost/test/unit_test.hpp>
+
+using libzerocoin::ParallelTasks;
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_paralleltasks_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(zerocoin_paralleltasks_test)
+{
+    ParallelTasks::StartThreads(3);
+    ParallelTasks::Stats statsBefore = ParallelTasks::GetStats();
+    BOOST_CHECK(statsBefore.nThreads >= 3);
+
+    // Every index is run once, whoever runs it
+    std::vector<std::atomic<int> > runs(1000);
+    for (std::atomic<int> &n : runs)
+        n = 0;
+    std::atomic<int> single(0);
+    {
+        ParallelTasks tasks;
+        tasks.AddRange(10, runs.size(), [&runs](size_t i) { runs[i]++; });
+        tasks.AddRange(0, 10, [&runs](size_t i) { runs[i]++; });
+        tasks.AddRange(5, 5, [&runs](size_t i) { runs[i]++; });
+        tasks.Add([&single] { single++; });
+        tasks.Wait();
+    }
+    for (std::atomic<int> &n : runs)
+        BOOST_CHECK_EQUAL(n, 1);
+    BOOST_CHECK_EQUAL(single, 1);
+
+    ParallelTasks::Stats stats = ParallelTasks::GetStats();
+    BOOST_CHECK_EQUAL(stats.nBatches, statsBefore.nBatches + 3);
+    BOOST_CHECK(stats.nChunks > statsBefore.nChunks);
+    BOOST_CHECK_EQUAL(stats.nQueued, 0);
+
+    // The first exception is thrown by Wait once all the tasks are done
+    std::atomic<int> count(0);
+    ParallelTasks failing;
+    failing.AddRange(0, 100, [&count](size_t i) {
+        count++;
+        if (i == 50)
+            throw std::runtime_error("task failed");
+    });
+    BOOST_CHECK_THROW(failing.Wait(), std::runtime_error);
+    BOOST_CHECK_EQUAL(count, 100);
+
+    // Waiting again does not throw again
+    failing.Wait();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,429 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zerocoin.h"
+
+#include "main.h"
+#include "txdb.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(zerocoin_state_tests, BasicTestingSetup)
+
+// Chain of block index entries from height 0, with random hashes
+static void BuildTestChain(int nBlocks, std::vector<uint256> &hashes, std::vector<CBlockIndex> &blocks)
+{
+    hashes.resize(nBlocks);
+    blocks.resize(nBlocks);
+    for (int i = 0; i < nBlocks; i++) {
+        hashes[i] = GetRandHash();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].nHeight = i;
+        blocks[i].pprev = i ? &blocks[i - 1] : NULL;
+        blocks[i].BuildSkip();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_coin_group_blocks)
+{
+    const int denomination = 1, id = 1;
+    const pair<int,int> denomAndId(denomination, id);
+    const bool fModulusV2 = IsZerocoinTxV2(libzerocoin::ZQ_LOVELACE, Params().GetConsensus(), id);
+
+    // Mints of the group every third block from height 2 to 20
+    const int nBlocks = 24;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    BuildTestChain(nBlocks, hashes, blocks);
+    for (int i = 0; i < nBlocks; i++) {
+        if (i >= 2 && i <= 20 && i % 3 == 2) {
+            blocks[i].mintedPubCoins[denomAndId] = std::vector<CBigNum>(2, CBigNum(i));
+            blocks[i].accumulatorChanges[denomAndId] = make_pair(CBigNum(1000 + i), 2);
+        }
+    }
+
+    CZerocoinState state;
+    for (int i = 0; i < nBlocks; i++)
+        state.AddBlock(&blocks[i], Params().GetConsensus());
+
+    CBigNum accumulator;
+    uint256 blockHash;
+    BOOST_CHECK_EQUAL(state.GetAccumulatorValueForSpend(NULL, INT_MAX, denomination, id, accumulator, blockHash, fModulusV2), 14);
+    BOOST_CHECK(accumulator == CBigNum(1020) && blockHash == hashes[20]);
+    BOOST_CHECK_EQUAL(state.GetAccumulatorValueForSpend(NULL, 10, denomination, id, accumulator, blockHash, fModulusV2), 6);
+    BOOST_CHECK(accumulator == CBigNum(1008) && blockHash == hashes[8]);
+    BOOST_CHECK_EQUAL(state.GetAccumulatorValueForSpend(NULL, 1, denomination, id, accumulator, blockHash, fModulusV2), 0);
+
+    // All the blocks of the group, latest first
+    std::vector<CBlockIndex *> accBlocks;
+    state.GetAccumulatorBlocksForSpend(denomination, id, NULL, accBlocks);
+    BOOST_CHECK_EQUAL(accBlocks.size(), 7U);
+    BOOST_CHECK(accBlocks.front() == &blocks[20] && accBlocks.back() == &blocks[2]);
+
+    // Named blocks within the group, mints or not, unknown or outside ones fall back to the first block
+    for (int i = 0; i < nBlocks; i++)
+        mapBlockIndex[hashes[i]] = &blocks[i];
+    state.GetAccumulatorBlocksForSpend(denomination, id, &hashes[11], accBlocks);
+    BOOST_CHECK(accBlocks.size() == 1 && accBlocks[0] == &blocks[11]);
+    state.GetAccumulatorBlocksForSpend(denomination, id, &hashes[12], accBlocks);
+    BOOST_CHECK(accBlocks.size() == 1 && accBlocks[0] == &blocks[12]);
+    state.GetAccumulatorBlocksForSpend(denomination, id, &hashes[22], accBlocks);
+    BOOST_CHECK(accBlocks.size() == 1 && accBlocks[0] == &blocks[2]);
+    uint256 unknownHash = GetRandHash();
+    state.GetAccumulatorBlocksForSpend(denomination, id, &unknownHash, accBlocks);
+    BOOST_CHECK(accBlocks.size() == 1 && accBlocks[0] == &blocks[2]);
+    for (int i = 0; i < nBlocks; i++)
+        mapBlockIndex.erase(hashes[i]);
+
+    // Disconnecting moves the group back to its previous block with mints
+    for (int i = nBlocks - 1; i >= 18; i--)
+        state.RemoveBlock(&blocks[i]);
+    CZerocoinState::CoinGroupInfo coinGroup;
+    BOOST_CHECK(state.GetCoinGroupInfo(denomination, id, coinGroup));
+    BOOST_CHECK(coinGroup.firstBlock == &blocks[2] && coinGroup.lastBlock == &blocks[17]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 12);
+    BOOST_CHECK_EQUAL(state.GetAccumulatorValueForSpend(NULL, INT_MAX, denomination, id, accumulator, blockHash, fModulusV2), 12);
+    BOOST_CHECK(accumulator == CBigNum(1017) && blockHash == hashes[17]);
+
+    for (int i = 17; i >= 0; i--)
+        state.RemoveBlock(&blocks[i]);
+    BOOST_CHECK(!state.GetCoinGroupInfo(denomination, id, coinGroup));
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_advance_witness)
+{
+    const int denomination = 1, id = 1;
+    const pair<int,int> denomAndId(denomination, id);
+    const bool fModulusV2 = IsZerocoinTxV2(libzerocoin::ZQ_LOVELACE, Params().GetConsensus(), id);
+    libzerocoin::Params *zcParams = fModulusV2 ? ZCParamsV2 : ZCParams;
+
+    // Two mints every other block, the accumulator values are not checked
+    const int nBlocks = 16;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    BuildTestChain(nBlocks, hashes, blocks);
+    for (int i = 0; i < nBlocks; i++) {
+        if (i % 2 == 1) {
+            blocks[i].mintedPubCoins[denomAndId].push_back(CBigNum(2 * i + 1));
+            blocks[i].mintedPubCoins[denomAndId].push_back(CBigNum(2 * i + 3));
+            blocks[i].accumulatorChanges[denomAndId] = make_pair(zcParams->accumulatorParams.accumulatorBase + i, 2);
+        }
+    }
+    CChain chain;
+    chain.SetTip(&blocks.back());
+
+    CZerocoinState state;
+    for (int i = 0; i < nBlocks; i++)
+        state.AddBlock(&blocks[i], Params().GetConsensus());
+
+    // The witness of a coin of block 5 brought from height 8 to 14 is the one computed at 14 from scratch
+    CBigNum pubCoin(13);
+    CBigNum witness = state.GetWitnessForSpend(&chain, 8, denomination, id, pubCoin, fModulusV2).getValue();
+    state.AdvanceWitnessForSpend(8, 14, denomination, id, pubCoin, fModulusV2, witness);
+    BOOST_CHECK(witness == state.GetWitnessForSpend(&chain, 14, denomination, id, pubCoin, fModulusV2).getValue());
+
+    // No coins in between, nothing changes
+    CBigNum sameWitness = witness;
+    state.AdvanceWitnessForSpend(14, 14, denomination, id, pubCoin, fModulusV2, sameWitness);
+    BOOST_CHECK(sameWitness == witness);
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_index_fields)
+{
+    const pair<int,int> denomAndId(1, 1);
+    CBlockIndex index;
+    BOOST_CHECK(index.mintedPubCoins.empty());
+    BOOST_CHECK_EQUAL(index.accumulatorChanges.count(denomAndId), 0U);
+    BOOST_CHECK(index.spentSerials.find(CBigNum(1)) == index.spentSerials.end());
+
+    index.mintedPubCoins[denomAndId].push_back(CBigNum(5));
+    index.accumulatorChanges[denomAndId] = make_pair(CBigNum(7), 1);
+    index.spentSerials.insert(CBigNum(9));
+    index.alternativeAccumulatorChanges[denomAndId] = make_pair(CBigNum(11), 1);
+    BOOST_CHECK_EQUAL(index.mintedPubCoins.size(), 1U);
+    BOOST_CHECK_EQUAL(index.spentSerials.count(CBigNum(9)), 1U);
+
+    // Serialized like the containers they hold, empty or not
+    map<pair<int,int>, vector<CBigNum>> mintedPubCoins;
+    mintedPubCoins[denomAndId].push_back(CBigNum(5));
+    CDataStream ssLazy(SER_DISK, CLIENT_VERSION), ssPlain(SER_DISK, CLIENT_VERSION);
+    ssLazy << index.mintedPubCoins << CBlockIndex().spentSerials;
+    ssPlain << mintedPubCoins << set<CBigNum>();
+    BOOST_CHECK(ssLazy.str() == ssPlain.str());
+
+    CBlockIndex copy(index);
+    BOOST_CHECK(copy.mintedPubCoins.get() == index.mintedPubCoins.get());
+    copy.mintedPubCoins[denomAndId].push_back(CBigNum(6));
+    BOOST_CHECK_EQUAL(index.mintedPubCoins.get().at(denomAndId).size(), 1U);
+
+    CLazyContainer<map<pair<int,int>, vector<CBigNum>>> read;
+    ssLazy >> read;
+    BOOST_CHECK(read.get() == mintedPubCoins);
+
+    index.alternativeAccumulatorChanges.erase(denomAndId);
+    BOOST_CHECK(index.alternativeAccumulatorChanges.empty());
+    index.SetNull();
+    BOOST_CHECK(index.mintedPubCoins.empty() && index.accumulatorChanges.empty() && index.spentSerials.empty());
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_snapshot)
+{
+    const int denomination = 1, id = 1;
+    const pair<int,int> denomAndId(denomination, id);
+
+    // A mint every other block from height 1, the snapshot is taken at height 8
+    const int nBlocks = 14, nSnapshotHeight = 8;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    BuildTestChain(nBlocks, hashes, blocks);
+    for (int i = 0; i < nBlocks; i++) {
+        if (i % 2 == 1) {
+            blocks[i].mintedPubCoins[denomAndId].push_back(CBigNum(100 + i));
+            blocks[i].accumulatorChanges[denomAndId] = make_pair(CBigNum(1000 + i), 1);
+        }
+        mapBlockIndex[hashes[i]] = &blocks[i];
+    }
+    CChain chain;
+    chain.SetTip(&blocks.back());
+
+    CZerocoinState state;
+    for (int i = 0; i <= nSnapshotHeight; i++)
+        state.AddBlock(&blocks[i], Params().GetConsensus());
+    // enough serials to take more than one database record
+    for (int i = 0; i < 5000; i++)
+        state.AddSpend(CBigNum(i));
+
+    CZerocoinStateSnapshot snapshot, readSnapshot;
+    state.GetSnapshot(&blocks[nSnapshotHeight], snapshot);
+    CBlockTreeDB db(1 << 20, true);
+    CZerocoinSupply supply, readSupply;
+    supply.hashBlock = hashes[nSnapshotHeight];
+    supply.AddMint(1);
+    BOOST_CHECK(db.WriteZerocoinState(snapshot, &supply));
+    BOOST_CHECK(db.ReadZerocoinState(readSnapshot));
+    BOOST_CHECK(db.ReadZerocoinSupply(readSupply));
+    BOOST_CHECK(readSupply.hashBlock == supply.hashBlock && readSupply.minted == supply.minted);
+    BOOST_CHECK(readSnapshot.hashBlock == hashes[nSnapshotHeight] && readSnapshot.nHeight == nSnapshotHeight);
+    BOOST_CHECK_EQUAL(readSnapshot.mintedPubCoins.size(), 4U);
+    BOOST_CHECK_EQUAL(readSnapshot.usedCoinSerialDigests.size(), 5000U);
+
+    // A smaller snapshot replaces it
+    CZerocoinStateSnapshot smallSnapshot;
+    CZerocoinState().GetSnapshot(&blocks[0], smallSnapshot);
+    BOOST_CHECK(db.WriteZerocoinState(smallSnapshot, NULL));
+    BOOST_CHECK(db.ReadZerocoinState(readSnapshot));
+    BOOST_CHECK(!db.ReadZerocoinSupply(readSupply));
+    BOOST_CHECK(readSnapshot.usedCoinSerialDigests.empty() && readSnapshot.coinGroups.empty());
+
+    // The blocks after the snapshot are replayed on top of it
+    CZerocoinState *zerocoinState = CZerocoinState::GetZerocoinState();
+    set<CBlockIndex *> changes;
+    BOOST_CHECK(ZerocoinBuildStateFromIndex(&chain, changes, &snapshot));
+    BOOST_CHECK(changes.empty());
+    CZerocoinState::CoinGroupInfo coinGroup;
+    BOOST_CHECK(zerocoinState->GetCoinGroupInfo(denomination, id, coinGroup));
+    BOOST_CHECK(coinGroup.firstBlock == &blocks[1] && coinGroup.lastBlock == &blocks[13]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 7);
+    BOOST_CHECK(zerocoinState->HasCoin(CBigNum(103)) && zerocoinState->HasCoin(CBigNum(113)));
+    BOOST_CHECK(zerocoinState->IsUsedCoinSerial(CBigNum(4999)));
+    zerocoinState->Reset();
+
+    // Snapshots not matching the blocks of the chain are not loaded
+    CZerocoinStateSnapshot badSnapshot = snapshot;
+    badSnapshot.hashBlock = hashes[nSnapshotHeight - 1];
+    BOOST_CHECK(!state.LoadSnapshot(&chain, badSnapshot));
+    badSnapshot = snapshot;
+    badSnapshot.coinGroups[0].blocks.back().second++;
+    BOOST_CHECK(!state.LoadSnapshot(&chain, badSnapshot));
+    BOOST_CHECK(!state.GetCoinGroupInfo(denomination, id, coinGroup));
+    BOOST_CHECK(state.LoadSnapshot(&chain, snapshot));
+    BOOST_CHECK(state.GetCoinGroupInfo(denomination, id, coinGroup));
+    BOOST_CHECK(coinGroup.lastBlock == &blocks[7] && coinGroup.nCoins == 4);
+
+    for (int i = 0; i < nBlocks; i++)
+        mapBlockIndex.erase(hashes[i]);
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_alternative_modulus)
+{
+    const int denomination = 1, id = 1;
+    const pair<int,int> denomAndId(denomination, id);
+    const Consensus::Params &params = Params().GetConsensus();
+    const bool fModulusV2 = IsZerocoinTxV2(libzerocoin::ZQ_LOVELACE, params, id);
+    libzerocoin::Params *altParams = fModulusV2 ? ZCParams : ZCParamsV2;
+    // a height the group may be spent with the alternative modulus at
+    const int nHeight = fModulusV2 ? 0 : params.nModulusV2StartBlock;
+
+    // One to three mints every other block, the native accumulator values are not checked
+    const int nBlocks = 12;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    BuildTestChain(nBlocks, hashes, blocks);
+    for (int i = 0; i < nBlocks; i++) {
+        if (i % 2 == 1) {
+            for (int j = 0; j <= i % 3; j++)
+                blocks[i].mintedPubCoins[denomAndId].push_back(CBigNum(1000 + 10 * i + j));
+            blocks[i].accumulatorChanges[denomAndId] = make_pair(CBigNum(i), i % 3 + 1);
+        }
+    }
+    CChain chain;
+    chain.SetTip(&blocks.back());
+
+    CZerocoinState state;
+    for (int i = 0; i < nBlocks; i++)
+        state.AddBlock(&blocks[i], params);
+
+    // Jobs limited to a few coins stop at a block boundary and the next ones continue from there
+    std::vector<CZerocoinState::AlternativeModulusJob> jobs;
+    BOOST_CHECK(!state.GetAlternativeModulusJobs(nHeight, 4, jobs));
+    BOOST_CHECK_EQUAL(jobs.size(), 1U);
+    BOOST_CHECK_EQUAL(jobs[0].blocks.size(), 2U);
+    jobs[0].Run();
+    state.SetAlternativeModulusValues(jobs[0]);
+    BOOST_CHECK_EQUAL(blocks[3].alternativeAccumulatorChanges.count(denomAndId), 1U);
+    BOOST_CHECK_EQUAL(blocks[5].alternativeAccumulatorChanges.count(denomAndId), 0U);
+
+    // Blocks that left the group in the meantime don't get their values
+    BOOST_CHECK(state.GetAlternativeModulusJobs(nHeight, SIZE_MAX, jobs));
+    BOOST_CHECK_EQUAL(jobs.size(), 1U);
+    jobs[0].Run();
+    state.RemoveBlock(&blocks[11]);
+    state.SetAlternativeModulusValues(jobs[0]);
+    BOOST_CHECK_EQUAL(blocks[9].alternativeAccumulatorChanges.count(denomAndId), 1U);
+    BOOST_CHECK_EQUAL(blocks[11].alternativeAccumulatorChanges.count(denomAndId), 0U);
+    state.AddBlock(&blocks[11], params);
+
+    // The rest is computed on demand, each value is the one of accumulating the coins one at a time
+    state.CalculateAlternativeModulusAccumulatorValues(&chain, denomination, id);
+    libzerocoin::Accumulator accumulator(altParams, libzerocoin::ZQ_LOVELACE);
+    for (int i = 1; i < nBlocks; i += 2) {
+        BOOST_FOREACH(const CBigNum &coin, blocks[i].mintedPubCoins[denomAndId])
+            accumulator += libzerocoin::PublicCoin(altParams, coin, libzerocoin::ZQ_LOVELACE);
+        BOOST_CHECK(blocks[i].alternativeAccumulatorChanges.count(denomAndId) == 1);
+        BOOST_CHECK(blocks[i].alternativeAccumulatorChanges[denomAndId].first == accumulator.getValue());
+        BOOST_CHECK_EQUAL(blocks[i].alternativeAccumulatorChanges[denomAndId].second, i % 3 + 1);
+    }
+
+    // Nothing left to do
+    BOOST_CHECK(state.GetAlternativeModulusJobs(nHeight, SIZE_MAX, jobs));
+    BOOST_CHECK(jobs.empty());
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_supply)
+{
+    CZerocoinSupply change;
+    change.AddMint(10);
+    change.AddMint(10);
+    change.AddMint(1);
+    change.AddSpend(10, false);
+    change.AddSpend(10, true);
+    change.AddSpend(10, true, -1);
+    BOOST_CHECK_EQUAL(change.minted[10], 20 * COIN);
+    BOOST_CHECK_EQUAL(change.minted[1], COIN);
+    BOOST_CHECK_EQUAL(change.spent[10], 10 * COIN);
+    BOOST_CHECK_EQUAL(change.respent, 0);
+
+    const CChainParams &chainParams = Params();
+    const Consensus::Params &params = chainParams.GetConsensus();
+
+    // A mint in block 1, serial 7 spent in block 2 and again with serial 8 in block 3, which adds to the supply as
+    // it's before spend v1.5
+    const int nBlocks = 4;
+    BOOST_REQUIRE(nBlocks <= params.nSpendV15StartBlock);
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    BuildTestChain(nBlocks, hashes, blocks);
+    for (int i = 0; i < nBlocks; i++)
+        mapBlockIndex[hashes[i]] = &blocks[i];
+
+    libzerocoin::Params *zcParams = IsZerocoinTxV2(libzerocoin::ZQ_LOVELACE, params, 1) ? ZCParamsV2 : ZCParams;
+    libzerocoin::PrivateCoin coin(zcParams, libzerocoin::ZQ_LOVELACE);
+    std::vector<CBlock> blockData(nBlocks);
+    for (int i = 1; i < nBlocks; i++)
+        blockData[i].zerocoinTxInfo = std::make_shared<CZerocoinTxInfo>();
+    blockData[1].zerocoinTxInfo->mints.push_back(make_pair(1, coin.getPublicCoin().getValue()));
+    blockData[2].zerocoinTxInfo->spentSerials[CBigNum(7)] = 10;
+    blockData[3].zerocoinTxInfo->spentSerials[CBigNum(7)] = 10;
+    blockData[3].zerocoinTxInfo->spentSerials[CBigNum(8)] = 25;
+    for (int i = 1; i < nBlocks; i++)
+        blockData[i].zerocoinTxInfo->Complete();
+
+    CBlockTreeDB *pblocktreeOld = pblocktree;
+    pblocktree = new CBlockTreeDB(1 << 20, true);
+    CZerocoinState *zerocoinState = CZerocoinState::GetZerocoinState();
+    zerocoinState->Reset();
+
+    CZerocoinSupply supply;
+    ZerocoinResetSupply(hashes[0]);
+    for (int i = 1; i < nBlocks; i++) {
+        CValidationState state;
+        BOOST_CHECK(ConnectBlockZC(state, chainParams, &blocks[i], &blockData[i]));
+    }
+    BOOST_CHECK(ZerocoinGetSupply(supply));
+    BOOST_CHECK(supply.hashBlock == hashes[3]);
+    BOOST_CHECK_EQUAL(supply.minted[1], COIN);
+    BOOST_CHECK_EQUAL(supply.spent[10], 20 * COIN);
+    BOOST_CHECK_EQUAL(supply.spent[25], 25 * COIN);
+    BOOST_CHECK_EQUAL(supply.respent, 10 * COIN);
+
+    // Disconnecting the block spending serial 7 again takes the re-spend out of the supply. The state forgets every
+    // spend of the serial, as it always did
+    DisconnectTipZC(blockData[3], &blocks[3]);
+    BOOST_CHECK(!zerocoinState->IsUsedCoinSerial(CBigNum(7)));
+    BOOST_CHECK(!zerocoinState->IsUsedCoinSerial(CBigNum(8)));
+    BOOST_CHECK(ZerocoinGetSupply(supply));
+    BOOST_CHECK(supply.hashBlock == hashes[2]);
+    BOOST_CHECK_EQUAL(supply.spent[10], 10 * COIN);
+    BOOST_CHECK_EQUAL(supply.spent[25], 0);
+    BOOST_CHECK_EQUAL(supply.respent, 0);
+
+    DisconnectTipZC(blockData[2], &blocks[2]);
+    DisconnectTipZC(blockData[1], &blocks[1]);
+    BOOST_CHECK(ZerocoinGetSupply(supply));
+    BOOST_CHECK(supply.hashBlock == hashes[0] && supply.minted[1] == 0 && supply.spent[10] == 0);
+
+    // A block not following the one the supply is at stops counting
+    CValidationState state;
+    BOOST_CHECK(ConnectBlockZC(state, chainParams, &blocks[2], &blockData[2]));
+    BOOST_CHECK(!ZerocoinGetSupply(supply));
+
+    // At startup the supply is replayed from the block it was written at up to the tip
+    zerocoinState->Reset();
+    for (int i = 1; i < nBlocks; i++) {
+        CValidationState state;
+        BOOST_CHECK(ConnectBlockZC(state, chainParams, &blocks[i], &blockData[i]));
+    }
+    CZerocoinSupply written;
+    written.hashBlock = hashes[0];
+    CChain chain;
+    chain.SetTip(&blocks[1]);
+    set<CBlockIndex *> changes;
+    ZerocoinBuildStateFromIndex(&chain, changes, NULL, &written);
+    BOOST_CHECK(ZerocoinGetSupply(supply));
+    BOOST_CHECK(supply.hashBlock == hashes[1] && supply.minted[1] == COIN);
+
+    // Not when written at a block the state is past, or one off the chain
+    CZerocoinStateSnapshot snapshot;
+    zerocoinState->GetSnapshot(&blocks[1], snapshot);
+    ZerocoinBuildStateFromIndex(&chain, changes, &snapshot, &written);
+    BOOST_CHECK(!ZerocoinGetSupply(supply));
+    CZerocoinSupply offChain;
+    offChain.hashBlock = GetRandHash();
+    ZerocoinBuildStateFromIndex(&chain, changes, NULL, &offChain);
+    BOOST_CHECK(!ZerocoinGetSupply(supply));
+
+    // Blocks with spends are read from disk, where these aren't
+    chain.SetTip(&blocks[3]);
+    ZerocoinBuildStateFromIndex(&chain, changes, NULL, &written);
+    BOOST_CHECK(!ZerocoinGetSupply(supply));
+
+    zerocoinState->Reset();
+    delete pblocktree;
+    pblocktree = pblocktreeOld;
+    for (int i = 0; i < nBlocks; i++)
+        mapBlockIndex.erase(hashes[i]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,10 +8,12 @@
 #include "chainparams.h"
 #include "hash.h"
 #include "pow.h"
+#include "primitives/powcache.h"
 #include "uint256.h"
 #include "main.h"
 #include "consensus/consensus.h"
 #include "base58.h"
+#include "zerocoin.h"
 
 #include <stdint.h>
 
@@ -27,12 +29,18 @@ static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_BLOCK_POW_HASH = 'h';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 static const char DB_TOTAL_SUPPLY = 'S';
+static const char DB_ZEROCOIN_STATE = 'Z';
+static const char DB_ZEROCOIN_SUPPLY = 'z';
+
+// Entries of the zerocoin state snapshot stored per database record
+static const size_t ZEROCOIN_STATE_PART_SIZE = 4096;
 
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
@@ -152,6 +160,9 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     batch.Write(DB_LAST_BLOCK, nLastFile);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
     	batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        // Apart from the index entry, which older versions rewrite without it
+        if (!(*it)->hashPoW.IsNull())
+            batch.Write(make_pair(DB_BLOCK_POW_HASH, (*it)->GetBlockHash()), (*it)->hashPoW);
     }
     return WriteBatch(batch, true);
 }
@@ -315,8 +326,24 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
     //bool fTestNet = (Params().NetworkIDString() == CBaseChainParams::TESTNET);
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
+    // Scrypt PoW hashes stored so far, by block hash
+    boost::unordered_map<uint256, uint256, BlockHasher> mapPoWHashes;
+    pcursor->Seek(make_pair(DB_BLOCK_POW_HASH, uint256()));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (!pcursor->GetKey(key) || key.first != DB_BLOCK_POW_HASH)
+            break;
+        if (!pcursor->GetValue(mapPoWHashes[key.second]))
+            return error("LoadBlockIndex() : failed to read PoW hash");
+        pcursor->Next();
+    }
+
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
 
+    // Blocks whose scrypt PoW hash wasn't stored yet
+    std::vector<CBlockIndex*> vPoWHashMissing;
+
     // Load mapBlockIndex
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
@@ -350,13 +377,24 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
                     pindexNew->reserved[1] = diskindex.reserved[1];
                 }                
 
-                pindexNew->accumulatorChanges = diskindex.accumulatorChanges;
-                pindexNew->mintedPubCoins     = diskindex.mintedPubCoins;
-                pindexNew->spentSerials       = diskindex.spentSerials;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->nBits, consensusParams))
-                    if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(true), pindexNew->nBits, consensusParams))
-                        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+                pindexNew->accumulatorChanges = std::move(diskindex.accumulatorChanges);
+                pindexNew->mintedPubCoins     = std::move(diskindex.mintedPubCoins);
+                pindexNew->spentSerials       = std::move(diskindex.spentSerials);
+
+                boost::unordered_map<uint256, uint256, BlockHasher>::const_iterator itPoWHash =
+                        mapPoWHashes.find(pindexNew->GetBlockHash());
+                if (itPoWHash != mapPoWHashes.end())
+                    pindexNew->hashPoW = itPoWHash->second;
+
+                if (pindexNew->hashPoW.IsNull() && !pindexNew->GetBlockHeader().IsMTP()) {
+                    // Hashed in batches once all the entries are read
+                    uint256 powHash;
+                    if (GetPrecomputedPoWHash(pindexNew->nHeight, pindexNew->GetBlockHash(), powHash))
+                        powHashCache.Insert(pindexNew->GetBlockHash(), powHash);
+                    vPoWHashMissing.push_back(pindexNew);
+                } else if (!CheckProofOfWork(pindexNew->GetBlockPoWHash(), pindexNew->nBits, consensusParams)) {
+                    return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+                }
 
                 pcursor->Next();
             } else {
@@ -367,6 +405,28 @@ bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256
         }
     }
 
+    if (!vPoWHashMissing.empty()) {
+        std::vector<CBlockHeader> vHeaders;
+        vHeaders.reserve(vPoWHashMissing.size());
+        for (const CBlockIndex* pindex : vPoWHashMissing)
+            vHeaders.push_back(pindex->GetBlockHeader());
+        std::vector<uint256> vPoWHashes;
+        ComputePoWHashes(vHeaders, vPoWHashes);
+        for (size_t i = 0; i < vPoWHashMissing.size(); i++) {
+            CBlockIndex* pindex = vPoWHashMissing[i];
+            if (!CheckProofOfWork(vPoWHashes[i], pindex->nBits, consensusParams))
+                return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindex->ToString());
+            pindex->hashPoW = vPoWHashes[i];
+        }
+
+        CDBBatch batch(*this);
+        for (const CBlockIndex* pindex : vPoWHashMissing)
+            batch.Write(make_pair(DB_BLOCK_POW_HASH, pindex->GetBlockHash()), pindex->hashPoW);
+        if (!WriteBatch(batch))
+            return error("LoadBlockIndex(): failed to store PoW hashes");
+        LogPrintf("%s: stored the PoW hashes of %u blocks\n", __func__, vPoWHashMissing.size());
+    }
+
     return true;
 }
 
@@ -408,6 +468,76 @@ bool CBlockTreeDB::ReadTotalSupply(CAmount & supply)
     return false;
 }
 
+bool CBlockTreeDB::WriteZerocoinSupply(const CZerocoinSupply &supply)
+{
+    return Write(DB_ZEROCOIN_SUPPLY, supply);
+}
+
+bool CBlockTreeDB::ReadZerocoinSupply(CZerocoinSupply &supply)
+{
+    return Read(DB_ZEROCOIN_SUPPLY, supply);
+}
+
+// The snapshot is stored as a header record ('h'), the number of parts of each of the big collections ('p') and the
+// parts themselves ('m' for mints, 's' for serials), all written in one batch
+template<typename T>
+static uint32_t WriteZerocoinStateParts(CDBBatch &batch, char type, const std::vector<T> &entries, uint32_t nOldParts)
+{
+    uint32_t nParts = (entries.size() + ZEROCOIN_STATE_PART_SIZE - 1) / ZEROCOIN_STATE_PART_SIZE;
+    for (uint32_t i = 0; i < nParts; i++) {
+        size_t first = i * ZEROCOIN_STATE_PART_SIZE, last = std::min(first + ZEROCOIN_STATE_PART_SIZE, entries.size());
+        batch.Write(make_pair(DB_ZEROCOIN_STATE, make_pair(type, i)), std::vector<T>(entries.begin() + first, entries.begin() + last));
+    }
+    // parts of the previous snapshot past the end of this one
+    for (uint32_t i = nParts; i < nOldParts; i++)
+        batch.Erase(make_pair(DB_ZEROCOIN_STATE, make_pair(type, i)));
+    return nParts;
+}
+
+template<typename T>
+static bool ReadZerocoinStateParts(CBlockTreeDB &db, char type, uint32_t nParts, std::vector<T> &entries)
+{
+    entries.clear();
+    std::vector<T> part;
+    for (uint32_t i = 0; i < nParts; i++) {
+        if (!db.Read(make_pair(DB_ZEROCOIN_STATE, make_pair(type, i)), part))
+            return false;
+        entries.insert(entries.end(), part.begin(), part.end());
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WriteZerocoinState(const CZerocoinStateSnapshot &snapshot, const CZerocoinSupply *supply)
+{
+    std::pair<uint32_t, uint32_t> oldParts(0, 0);
+    Read(make_pair(DB_ZEROCOIN_STATE, 'p'), oldParts);
+
+    CDBBatch batch(*this);
+    std::pair<uint32_t, uint32_t> parts;
+    parts.first = WriteZerocoinStateParts(batch, 'm', snapshot.mintedPubCoins, oldParts.first);
+    parts.second = WriteZerocoinStateParts(batch, 's', snapshot.usedCoinSerialDigests, oldParts.second);
+    batch.Write(make_pair(DB_ZEROCOIN_STATE, 'p'), parts);
+    batch.Write(make_pair(DB_ZEROCOIN_STATE, 'h'), snapshot);
+    if (supply != NULL)
+        batch.Write(DB_ZEROCOIN_SUPPLY, *supply);
+    else
+        batch.Erase(DB_ZEROCOIN_SUPPLY);
+    return WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::ReadZerocoinState(CZerocoinStateSnapshot &snapshot)
+{
+    std::pair<uint32_t, uint32_t> parts;
+    if (!Read(make_pair(DB_ZEROCOIN_STATE, 'h'), snapshot) || !Read(make_pair(DB_ZEROCOIN_STATE, 'p'), parts))
+        return false;
+    if (snapshot.nSnapshotVersion != CZerocoinStateSnapshot::CURRENT_VERSION) {
+        LogPrintf("%s: ignoring zerocoin state snapshot of version %d\n", __func__, snapshot.nSnapshotVersion);
+        return false;
+    }
+    return ReadZerocoinStateParts(*this, 'm', parts.first, snapshot.mintedPubCoins) &&
+           ReadZerocoinStateParts(*this, 's', parts.second, snapshot.usedCoinSerialDigests);
+}
+
 /******************************************************************************/
 
 CDbIndexHelper::CDbIndexHelper(bool addressIndex_, bool spentIndex_)
@@ -20,6 +20,8 @@
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CZerocoinStateSnapshot;
+class CZerocoinSupply;
 class uint256;
 
 //! -dbcache default (MiB)
@@ -134,6 +136,11 @@ public:
     int GetBlockIndexVersion();
     bool AddTotalSupply(CAmount const & supply);
     bool ReadTotalSupply(CAmount & supply);
+    bool WriteZerocoinSupply(const CZerocoinSupply &supply);
+    bool ReadZerocoinSupply(CZerocoinSupply &supply);
+    //! Write the snapshot with the zerocoin supply of the same block, which is erased when it isn't counted
+    bool WriteZerocoinState(const CZerocoinStateSnapshot &snapshot, const CZerocoinSupply *supply);
+    bool ReadZerocoinState(CZerocoinStateSnapshot &snapshot);
 };
 
 
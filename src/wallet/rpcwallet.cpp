@@ -2719,11 +2719,11 @@ UniValue mintzerocoin(const UniValue& params, bool fHelp)
     // Always use modulus v2
     libzerocoin::Params *zcParams = ZCParamsV2;
 
-    // The following constructor does all the work of minting a brand
-    // new zerocoin. It stores all the private values inside the
+    // Take a pre-generated zerocoin out of the wallet's pool or mint a brand
+    // new one. It stores all the private values inside the
     // PrivateCoin object. This includes the coin secrets, which must be
     // stored in a secure location (wallet) at the client.
-    libzerocoin::PrivateCoin newCoin(zcParams, denomination, ZEROCOIN_TX_VERSION_2);
+    libzerocoin::PrivateCoin newCoin = pwalletMain->NewZerocoinMint(denomination);
     // Get a copy of the 'public' portion of the coin. You should
     // embed this into a Zerocoin 'MINT' transaction along with a series
     // of currency inputs totaling the assigned value of one zerocoin.
@@ -2844,11 +2844,11 @@ UniValue mintmanyzerocoin(const UniValue& params, bool fHelp)
         }
 
         for(int64_t i=0; i<amount; i++){
-            // The following constructor does all the work of minting a brand
-            // new zerocoin. It stores all the private values inside the
+            // Take a pre-generated zerocoin out of the wallet's pool or mint a brand
+            // new one. It stores all the private values inside the
             // PrivateCoin object. This includes the coin secrets, which must be
             // stored in a secure location (wallet) at the client.
-            libzerocoin::PrivateCoin newCoin(zcParams, denomination, ZEROCOIN_TX_VERSION_2);
+            libzerocoin::PrivateCoin newCoin = pwalletMain->NewZerocoinMint(denomination);
             // Get a copy of the 'public' portion of the coin. You should
             // embed this into a Zerocoin 'MINT' transaction along with a series
             // of currency inputs totaling the assigned value of one zerocoin.
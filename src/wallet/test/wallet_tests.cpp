@@ -3,6 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "wallet/wallet.h"
+#include "wallet/walletdb.h"
+#include "main.h"
+#include "random.h"
 
 #include <set>
 #include <stdint.h>
@@ -351,4 +354,97 @@ BOOST_AUTO_TEST_CASE(ApproximateBestSubset)
     BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
 }*/
 
+BOOST_AUTO_TEST_CASE(zerocoin_mint_pool)
+{
+    LOCK(pwalletMain->cs_wallet);
+    BOOST_CHECK(pwalletMain->TopUpZerocoinMintPool(1));
+    BOOST_CHECK_EQUAL(pwalletMain->mapZerocoinMintPool[libzerocoin::ZQ_LOVELACE].size(), 1U);
+    BOOST_CHECK_EQUAL(pwalletMain->mapZerocoinMintPool[libzerocoin::ZQ_WILLIAMSON].size(), 1U);
+
+    int64_t nIndex = *pwalletMain->mapZerocoinMintPool[libzerocoin::ZQ_LOVELACE].begin();
+    CZerocoinMintPoolEntry entry;
+    BOOST_CHECK(CWalletDB(pwalletMain->strWalletFile).ReadZerocoinMintPoolEntry(nIndex, entry));
+    BOOST_CHECK(!entry.fCrypted);
+
+    // The pooled mint is handed out once, then mints are generated on the spot
+    libzerocoin::PrivateCoin coin = pwalletMain->NewZerocoinMint(libzerocoin::ZQ_LOVELACE);
+    BOOST_CHECK(coin.getPublicCoin().validate());
+    BOOST_CHECK_EQUAL(coin.getVersion(), ZEROCOIN_TX_VERSION_2);
+    BOOST_CHECK(pwalletMain->mapZerocoinMintPool[libzerocoin::ZQ_LOVELACE].empty());
+    BOOST_CHECK(!CWalletDB(pwalletMain->strWalletFile).ReadZerocoinMintPoolEntry(nIndex, entry));
+
+    libzerocoin::PrivateCoin newCoin = pwalletMain->NewZerocoinMint(libzerocoin::ZQ_LOVELACE);
+    BOOST_CHECK(newCoin.getPublicCoin().getDenomination() == libzerocoin::ZQ_LOVELACE);
+    BOOST_CHECK(newCoin.getSerialNumber() != coin.getSerialNumber());
+
+    pwalletMain->EraseZerocoinMintPool();
+    BOOST_CHECK(pwalletMain->mapZerocoinMintPool.empty());
+}
+
+static CZerocoinWitnessEntry ZerocoinWitnessWithCheckpoints(const CBigNum& pubCoin, int id, bool fModulusV2, const std::vector<int>& heights)
+{
+    CZerocoinWitnessEntry entry;
+    entry.pubCoin = pubCoin;
+    entry.denomination = libzerocoin::ZQ_LOVELACE;
+    entry.id = id;
+    entry.fModulusV2 = fModulusV2;
+    BOOST_FOREACH(int nHeight, heights) {
+        CZerocoinWitnessEntry::Checkpoint checkpoint;
+        checkpoint.nHeight = nHeight;
+        checkpoint.hashBlock = GetRandHash();
+        checkpoint.witness = pubCoin + nHeight;
+        entry.checkpoints.push_back(checkpoint);
+    }
+    return entry;
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_witnesses)
+{
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    CBigNum spentPubCoin(1001), unspentPubCoin(2002);
+
+    // A mint of group 1 spent with witnesses kept for both moduli, and an unspent one of group 2
+    std::vector<CZerocoinWitnessEntry> witnesses;
+    witnesses.push_back(ZerocoinWitnessWithCheckpoints(spentPubCoin, 1, false, {5}));
+    witnesses.push_back(ZerocoinWitnessWithCheckpoints(spentPubCoin, 1, true, {5}));
+    witnesses.push_back(ZerocoinWitnessWithCheckpoints(unspentPubCoin, 2, true, {5, 10}));
+    BOOST_FOREACH(const CZerocoinWitnessEntry& witness, witnesses) {
+        pwalletMain->LoadZerocoinWitness(witness);
+        BOOST_CHECK(walletdb.WriteZerocoinWitness(witness));
+    }
+    CZerocoinEntry spentMint;
+    spentMint.value = spentPubCoin;
+    spentMint.denomination = libzerocoin::ZQ_LOVELACE;
+    spentMint.IsUsed = true;
+    BOOST_CHECK(walletdb.WriteZerocoinEntry(spentMint));
+
+    // Once group 1 gets coins its spent mints lose their witnesses whatever the modulus, other groups are left alone.
+    // The coin of the block isn't the wallet's
+    CBlockIndex confirmed;
+    confirmed.nHeight = 12;
+    confirmed.mintedPubCoins[make_pair((int)libzerocoin::ZQ_LOVELACE, 1)].push_back(CBigNum(3003));
+    pwalletMain->UpdateZerocoinWitnesses(&confirmed, &confirmed, true);
+    CZerocoinWitnessEntry witness;
+    BOOST_CHECK_EQUAL(pwalletMain->mapZerocoinWitnesses.size(), 1U);
+    BOOST_CHECK(!walletdb.ReadZerocoinWitness(spentPubCoin, false, witness));
+    BOOST_CHECK(!walletdb.ReadZerocoinWitness(spentPubCoin, true, witness));
+
+    // Disconnecting block 10 drops the checkpoint holding its coins
+    CBlockIndex disconnected;
+    disconnected.nHeight = 10;
+    pwalletMain->RollBackZerocoinWitnesses(&disconnected);
+    BOOST_CHECK(walletdb.ReadZerocoinWitness(unspentPubCoin, true, witness));
+    BOOST_CHECK_EQUAL(witness.checkpoints.size(), 1U);
+    BOOST_CHECK_EQUAL(pwalletMain->mapZerocoinWitnesses[make_pair(unspentPubCoin, true)].checkpoints.size(), 1U);
+
+    // Down to block 5 the mint itself may be gone, so is its witness
+    disconnected.nHeight = 5;
+    pwalletMain->RollBackZerocoinWitnesses(&disconnected);
+    BOOST_CHECK(pwalletMain->mapZerocoinWitnesses.empty());
+    BOOST_CHECK(!walletdb.ReadZerocoinWitness(unspentPubCoin, true, witness));
+
+    BOOST_CHECK(walletdb.EraseZerocoinEntry(spentMint));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
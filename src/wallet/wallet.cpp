@@ -304,8 +304,10 @@ bool CWallet::Unlock(const SecureString &strWalletPassphrase) {
                 return false;
             if (!crypter.Decrypt(pMasterKey.second.vchCryptedKey, vMasterKey))
                 continue; // try another master key
-            if (CCryptoKeyStore::Unlock(vMasterKey))
+            if (CCryptoKeyStore::Unlock(vMasterKey)) {
+                ResumeZerocoinMintPoolTopUp();
                 return true;
+            }
         }
     }
     return false;
@@ -644,6 +646,8 @@ bool CWallet::EncryptWallet(const SecureString &strWalletPassphrase) {
         }
 
         NewKeyPool();
+        // the pre-generated mints were stored unencrypted
+        EraseZerocoinMintPool();
         Lock();
 
         // Need to completely rewrite the wallet file; if we don't, bdb might keep
@@ -1396,7 +1400,7 @@ int CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool fUpdate) {
                                                                              (dProgressTip - dProgressStart) * 100))));
 
             CBlock block;
-            ReadBlockFromDisk(block, pindex, Params().GetConsensus());
+            ReadBlockFromDisk(block, pindex, Params().GetConsensus(), false);
             BOOST_FOREACH(CTransaction & tx, block.vtx)
             {
                 if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
@@ -3254,11 +3258,11 @@ bool CWallet::CreateZerocoinMintModel(string &stringError, std::vector<std::pair
         }
 
         for(int64_t i=0; i<amount; i++){
-            // The following constructor does all the work of minting a brand
-            // new zerocoin. It stores all the private values inside the
+            // Take a pre-generated zerocoin out of the wallet's pool or mint a brand
+            // new one. It stores all the private values inside the
             // PrivateCoin object. This includes the coin secrets, which must be
             // stored in a secure location (wallet) at the client.
-            libzerocoin::PrivateCoin newCoin(zcParams, denomination, ZEROCOIN_TX_VERSION_2);
+            libzerocoin::PrivateCoin newCoin = NewZerocoinMint(denomination);
             // Get a copy of the 'public' portion of the coin. You should
             // embed this into a Zerocoin 'MINT' transaction along with a series
             // of currency inputs totaling the assigned value of one zerocoin.
@@ -3339,10 +3343,12 @@ bool CWallet::CreateZerocoinMintModel(string &stringError, string denomAmount) {
 	}
 
     // The following constructor does all the work of minting a brand
-    // new zerocoin. It stores all the private values inside the
+    // new zerocoin, unless a pre-generated one is taken out of the pool.
+    // It stores all the private values inside the
     // PrivateCoin object. This includes the coin secrets, which must be
     // stored in a secure location (wallet) at the client.
-    libzerocoin::PrivateCoin newCoin(zcParams, denomination, mintVersion);
+    libzerocoin::PrivateCoin newCoin = mintVersion == ZEROCOIN_TX_VERSION_2 ? NewZerocoinMint(denomination)
+                                                                            : libzerocoin::PrivateCoin(zcParams, denomination, mintVersion);
 
     // Get a copy of the 'public' portion of the coin. You should
     // embed this into a Zerocoin 'MINT' transaction along with a series
@@ -3934,13 +3940,13 @@ bool CWallet::CreateZerocoinSpendTransaction(std::string &thirdPartyaddress, int
                 return false;
             }
 
-            // 4. Get witness from the index
+            // 4. Get witness, kept up to date by the wallet
             libzerocoin::AccumulatorWitness witness =
-                    zerocoinState->GetWitnessForSpend(&chainActive,
-                                                      chainActive.Height()-(JC_MINT_CONFIRMATIONS-1),
-                                                      denomination, coinId,
-                                                      coinToUse.value,
-                                                      fModulusV2);
+                    GetZerocoinWitness(chainActive.Tip(),
+                                       chainActive.Height()-(JC_MINT_CONFIRMATIONS-1),
+                                       denomination, coinId,
+                                       coinToUse.value,
+                                       fModulusV2);
 
             int serializedId = coinId + (fModulusV2 ? JC_MODULUS_V2_BASE_ID : 0);
 
@@ -4203,11 +4209,11 @@ bool CWallet::CreateMultipleZerocoinSpendTransaction(std::string &thirdPartyaddr
                 }
                  // 4. Get witness for the accumulator and selected coin
                 libzerocoin::AccumulatorWitness witness =
-                        zerocoinState->GetWitnessForSpend(&chainActive,
-                                                          chainActive.Height()-(JC_MINT_CONFIRMATIONS-1),
-                                                          denomination, coinId,
-                                                          coinToUse.value,
-                                                          fModulusV2);
+                        GetZerocoinWitness(chainActive.Tip(),
+                                           chainActive.Height()-(JC_MINT_CONFIRMATIONS-1),
+                                           denomination, coinId,
+                                           coinToUse.value,
+                                           fModulusV2);
 
                 // Generate TxIn info
                 int serializedId = coinId + (fModulusV2 ? JC_MODULUS_V2_BASE_ID : 0);
@@ -4293,13 +4299,12 @@ bool CWallet::CreateMultipleZerocoinSpendTransaction(std::string &thirdPartyaddr
                 CZerocoinEntry coinToUse = tempStorage.coinToUse;
 
                  //have to recreate coin witness as it can't be stored in an object, hence we can't store it in tempStorage..
-                CZerocoinState *zerocoinState = CZerocoinState::GetZerocoinState();
                 libzerocoin::AccumulatorWitness witness =
-                zerocoinState->GetWitnessForSpend(&chainActive,
-                                                  chainActive.Height()-(JC_MINT_CONFIRMATIONS-1),
-                                                  tempStorage.denomination, tempStorage.coinId,
-                                                  coinToUse.value,
-                                                  fModulusV2);
+                GetZerocoinWitness(chainActive.Tip(),
+                                   chainActive.Height()-(JC_MINT_CONFIRMATIONS-1),
+                                   tempStorage.denomination, tempStorage.coinId,
+                                   coinToUse.value,
+                                   fModulusV2);
 
                 // Recreate CoinSpend object
                  libzerocoin::CoinSpend spend(zcParams, 
@@ -5401,6 +5406,9 @@ std::string CWallet::GetWalletHelpString(bool showDebug) {
     strUsage += HelpMessageOpt("-disablewallet", _("Do not load the wallet and disable wallet RPC calls"));
     strUsage += HelpMessageOpt("-keypool=<n>",
                                strprintf(_("Set key pool size to <n> (default: %u)"), DEFAULT_KEYPOOL_SIZE));
+    strUsage += HelpMessageOpt("-zcmintpool=<n>",
+                               strprintf(_("Keep <n> zerocoin mints of each denomination generated ahead of time (default: %u)"),
+                                         DEFAULT_ZEROCOIN_MINT_POOL_SIZE));
     strUsage += HelpMessageOpt("-fallbackfee=<amt>", strprintf(
             _("A fee rate (in %s/kB) that will be used when fee estimation has insufficient data (default: %s)"),
             CURRENCY_UNIT, FormatMoney(DEFAULT_FALLBACK_FEE)));
@@ -5868,6 +5876,311 @@ bool CMerkleTx::AcceptToMemoryPool(
     }
 }
 
+void CWallet::LoadZerocoinWitness(const CZerocoinWitnessEntry &entry) {
+    LOCK(cs_wallet);
+    mapZerocoinWitnesses[std::make_pair(entry.pubCoin, entry.fModulusV2)] = entry;
+}
+
+libzerocoin::AccumulatorWitness CWallet::GetZerocoinWitness(const CBlockIndex *pindexTip, int maxHeight, int denomination,
+                                                            int id, const CBigNum &pubCoin, bool fModulusV2) {
+    AssertLockHeld(cs_main);
+    LOCK(cs_wallet);
+
+    CZerocoinState *zerocoinState = CZerocoinState::GetZerocoinState();
+    CZerocoinWitnessEntry &entry = mapZerocoinWitnesses[std::make_pair(pubCoin, fModulusV2)];
+    if (entry.id != id || entry.denomination != denomination) {
+        entry.SetNull();
+        entry.pubCoin = pubCoin;
+        entry.denomination = denomination;
+        entry.id = id;
+        entry.fModulusV2 = fModulusV2;
+    }
+
+    // Start from the latest checkpoint still in the chain that doesn't hold coins past maxHeight
+    const CBlockIndex *pindexMax = pindexTip->GetAncestor(maxHeight);
+    bool fChanged = false;
+    while (!entry.checkpoints.empty()) {
+        const CZerocoinWitnessEntry::Checkpoint &checkpoint = entry.checkpoints.back();
+        if (checkpoint.nHeight <= maxHeight && pindexMax->GetAncestor(checkpoint.nHeight)->GetBlockHash() == checkpoint.hashBlock)
+            break;
+        entry.checkpoints.pop_back();
+        fChanged = true;
+    }
+
+    CBigNum witnessValue;
+    if (!entry.checkpoints.empty()) {
+        witnessValue = entry.checkpoints.back().witness;
+        zerocoinState->AdvanceWitnessForSpend(entry.checkpoints.back().nHeight, maxHeight, denomination, id,
+                                              pubCoin, fModulusV2, witnessValue);
+        if (witnessValue != entry.checkpoints.back().witness)
+            fChanged = true;
+    }
+    else {
+        witnessValue = zerocoinState->GetWitnessForSpend(&chainActive, maxHeight, denomination, id,
+                                                         pubCoin, fModulusV2).getValue();
+        fChanged = true;
+    }
+
+    if (fChanged) {
+        CZerocoinWitnessEntry::Checkpoint checkpoint;
+        checkpoint.nHeight = maxHeight;
+        checkpoint.hashBlock = pindexMax->GetBlockHash();
+        checkpoint.witness = witnessValue;
+        entry.checkpoints.push_back(checkpoint);
+        if (entry.checkpoints.size() > CZerocoinWitnessEntry::MAX_CHECKPOINTS)
+            entry.checkpoints.erase(entry.checkpoints.begin());
+        if (fFileBacked)
+            CWalletDB(strWalletFile).WriteZerocoinWitness(entry);
+    }
+
+    libzerocoin::Params *zcParams = fModulusV2 ? ZCParamsV2 : ZCParams;
+    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
+    return libzerocoin::AccumulatorWitness(zcParams, libzerocoin::Accumulator(zcParams, witnessValue, d),
+                                           libzerocoin::PublicCoin(zcParams, pubCoin, d));
+}
+
+void CWallet::UpdateZerocoinWitnesses(const CBlockIndex *pindexTip, const CBlockIndex *pindexConfirmed, bool fModulusV2) {
+    AssertLockHeld(cs_main);
+    if (pindexConfirmed->mintedPubCoins.empty() || !fFileBacked)
+        return;
+
+    LOCK(cs_wallet);
+
+    // Witnesses of the groups that got coins take them, the ones of mints spent since are dropped. Spent mints of
+    // groups getting no more coins keep theirs, they don't change anyway
+    CWalletDB walletdb(strWalletFile);
+    std::map<std::pair<CBigNum, bool>, CZerocoinWitnessEntry>::iterator it = mapZerocoinWitnesses.begin();
+    while (it != mapZerocoinWitnesses.end()) {
+        const CZerocoinWitnessEntry &entry = it->second;
+        if (pindexConfirmed->mintedPubCoins.count(make_pair(entry.denomination, entry.id)) == 0) {
+            ++it;
+            continue;
+        }
+
+        CZerocoinEntry pubCoinItem;
+        if (!walletdb.ReadZerocoinEntry(entry.pubCoin, pubCoinItem) || pubCoinItem.IsUsed) {
+            walletdb.EraseZerocoinWitness(entry);
+            mapZerocoinWitnesses.erase(it++);
+            continue;
+        }
+        if (entry.fModulusV2 == fModulusV2)
+            GetZerocoinWitness(pindexTip, pindexConfirmed->nHeight, entry.denomination, entry.id, entry.pubCoin, fModulusV2);
+        ++it;
+    }
+
+    // The wallet's own mints among the coins of the block get a witness
+    BOOST_FOREACH(const PAIRTYPE(const PAIRTYPE(int, int), vector<CBigNum>) &coins, pindexConfirmed->mintedPubCoins) {
+        BOOST_FOREACH(const CBigNum &pubCoin, coins.second) {
+            CZerocoinEntry pubCoinItem;
+            if (mapZerocoinWitnesses.count(std::make_pair(pubCoin, fModulusV2)) == 0 &&
+                    walletdb.ReadZerocoinEntry(pubCoin, pubCoinItem) && !pubCoinItem.IsUsed)
+                GetZerocoinWitness(pindexTip, pindexConfirmed->nHeight, coins.first.first, coins.first.second, pubCoin, fModulusV2);
+        }
+    }
+}
+
+void CWallet::RollBackZerocoinWitnesses(const CBlockIndex *pindex) {
+    LOCK(cs_wallet);
+
+    std::map<std::pair<CBigNum, bool>, CZerocoinWitnessEntry>::iterator it = mapZerocoinWitnesses.begin();
+    while (it != mapZerocoinWitnesses.end()) {
+        CZerocoinWitnessEntry &entry = it->second;
+        size_t nCheckpoints = entry.checkpoints.size();
+        while (!entry.checkpoints.empty() && entry.checkpoints.back().nHeight >= pindex->nHeight)
+            entry.checkpoints.pop_back();
+        if (entry.checkpoints.size() == nCheckpoints) {
+            ++it;
+            continue;
+        }
+
+        // Without checkpoints the witness is computed from scratch anyway, and the mint may have been in pindex
+        if (entry.checkpoints.empty()) {
+            if (fFileBacked)
+                CWalletDB(strWalletFile).EraseZerocoinWitness(entry);
+            mapZerocoinWitnesses.erase(it++);
+        }
+        else {
+            if (fFileBacked)
+                CWalletDB(strWalletFile).WriteZerocoinWitness(entry);
+            ++it;
+        }
+    }
+}
+
+void CWallet::LoadZerocoinMintPoolEntry(int64_t nIndex, const CZerocoinMintPoolEntry &entry) {
+    LOCK(cs_wallet);
+    mapZerocoinMintPool[entry.denomination].insert(nIndex);
+}
+
+bool CWallet::TopUpZerocoinMintPool(unsigned int nSize) {
+    if (!fFileBacked)
+        return false;
+
+    unsigned int nTargetSize;
+    if (nSize > 0)
+        nTargetSize = nSize;
+    else
+        nTargetSize = max(GetArg("-zcmintpool", DEFAULT_ZEROCOIN_MINT_POOL_SIZE), (int64_t) 0);
+
+    const libzerocoin::CoinDenomination denominations[] = {libzerocoin::ZQ_LOVELACE, libzerocoin::ZQ_GOLDWASSER,
+            libzerocoin::ZQ_RACKOFF, libzerocoin::ZQ_PEDERSEN, libzerocoin::ZQ_WILLIAMSON};
+    BOOST_FOREACH(libzerocoin::CoinDenomination denomination, denominations) {
+        for (;;) {
+            {
+                LOCK(cs_wallet);
+                if (mapZerocoinMintPool[denomination].size() >= nTargetSize)
+                    break;
+                // the coin secrets can't be stored without the master key
+                if (IsLocked())
+                    return false;
+            }
+
+            // The prime search takes a while, the wallet is not held meanwhile
+            libzerocoin::PrivateCoin coin(ZCParamsV2, denomination, ZEROCOIN_TX_VERSION_2);
+            boost::this_thread::interruption_point();
+            if (!coin.getPublicCoin().validate())
+                continue;
+
+            CDataStream ssCoin(SER_DISK, CLIENT_VERSION);
+            ssCoin << coin;
+            CKeyingMaterial vchCoin(ssCoin.begin(), ssCoin.end());
+
+            CZerocoinMintPoolEntry entry;
+            entry.nTime = GetTime();
+            entry.denomination = denomination;
+
+            LOCK(cs_wallet);
+            if (IsCrypted()) {
+                entry.fCrypted = true;
+                entry.nIV = GetRandHash();
+                if (!EncryptWithMasterKey(vchCoin, entry.nIV, entry.vchCoin))
+                    return false;
+            }
+            else {
+                entry.vchCoin.assign(vchCoin.begin(), vchCoin.end());
+            }
+
+            int64_t nIndex = 1;
+            BOOST_FOREACH(const PAIRTYPE(int, std::set<int64_t>) &pool, mapZerocoinMintPool) {
+                if (!pool.second.empty())
+                    nIndex = max(nIndex, *pool.second.rbegin() + 1);
+            }
+            if (!CWalletDB(strWalletFile).WriteZerocoinMintPoolEntry(nIndex, entry))
+                throw runtime_error(std::string(__func__) + ": writing generated mint failed");
+            mapZerocoinMintPool[denomination].insert(nIndex);
+            LogPrintf("zerocoin mint pool added mint %d, denomination=%d, size=%u\n", nIndex, denomination,
+                      mapZerocoinMintPool[denomination].size());
+        }
+    }
+    return true;
+}
+
+libzerocoin::PrivateCoin CWallet::NewZerocoinMint(libzerocoin::CoinDenomination denomination) {
+    // The pool is short of a mint either way
+    ScheduleZerocoinMintPoolTopUp();
+
+    if (fFileBacked) {
+        LOCK(cs_wallet);
+        std::set<int64_t> &pool = mapZerocoinMintPool[denomination];
+        CWalletDB walletdb(strWalletFile);
+        while (!pool.empty()) {
+            int64_t nIndex = *pool.begin();
+            CZerocoinMintPoolEntry entry;
+            if (!walletdb.ReadZerocoinMintPoolEntry(nIndex, entry))
+                throw runtime_error(std::string(__func__) + ": read failed");
+
+            CKeyingMaterial vchCoin;
+            if (entry.fCrypted) {
+                if (!DecryptWithMasterKey(entry.vchCoin, entry.nIV, vchCoin))
+                    break;
+            }
+            else {
+                vchCoin.assign(entry.vchCoin.begin(), entry.vchCoin.end());
+            }
+
+            // A mint leaves the pool before it is used, it is never handed out twice
+            walletdb.EraseZerocoinMintPoolEntry(nIndex);
+            pool.erase(nIndex);
+
+            try {
+                CDataStream ssCoin((const char *)vchCoin.data(), (const char *)vchCoin.data() + vchCoin.size(),
+                                   SER_DISK, CLIENT_VERSION);
+                libzerocoin::PrivateCoin coin(ZCParamsV2, ssCoin);
+                if (coin.getVersion() == ZEROCOIN_TX_VERSION_2 && coin.getPublicCoin().getDenomination() == denomination)
+                    return coin;
+            }
+            catch (const std::exception &) {
+            }
+            LogPrintf("%s: dropped invalid mint %d of the zerocoin mint pool\n", __func__, nIndex);
+        }
+    }
+
+    return libzerocoin::PrivateCoin(ZCParamsV2, denomination, ZEROCOIN_TX_VERSION_2);
+}
+
+void CWallet::EraseZerocoinMintPool() {
+    LOCK(cs_wallet);
+    if (fFileBacked) {
+        CWalletDB walletdb(strWalletFile);
+        BOOST_FOREACH(const PAIRTYPE(int, std::set<int64_t>) &pool, mapZerocoinMintPool) {
+            BOOST_FOREACH(int64_t nIndex, pool.second)
+                walletdb.EraseZerocoinMintPoolEntry(nIndex);
+        }
+    }
+    mapZerocoinMintPool.clear();
+}
+
+// The mint pool thread only works once mints were taken from the pool, nothing is generated ahead of a first use
+static boost::mutex csZerocoinMintPoolTopUp;
+static boost::condition_variable condZerocoinMintPoolTopUp;
+//! Mints were taken from the pool since the thread last topped it up
+static bool fZerocoinMintPoolTopUpRequested = false;
+//! The last top up didn't complete, it is tried again once the wallet gets unlocked
+static bool fZerocoinMintPoolTopUpDeferred = false;
+
+void ScheduleZerocoinMintPoolTopUp() {
+    boost::unique_lock<boost::mutex> lock(csZerocoinMintPoolTopUp);
+    fZerocoinMintPoolTopUpRequested = true;
+    condZerocoinMintPoolTopUp.notify_one();
+}
+
+void ResumeZerocoinMintPoolTopUp() {
+    boost::unique_lock<boost::mutex> lock(csZerocoinMintPoolTopUp);
+    if (fZerocoinMintPoolTopUpDeferred) {
+        fZerocoinMintPoolTopUpDeferred = false;
+        fZerocoinMintPoolTopUpRequested = true;
+        condZerocoinMintPoolTopUp.notify_one();
+    }
+}
+
+void ThreadZerocoinMintPool() {
+    RenameThread("jemcash-zcmintpool");
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+
+    // Like the key pool the mint pool is refilled as it gets used, and when the wallet gets unlocked if it was
+    // locked then
+    for (;;) {
+        {
+            boost::unique_lock<boost::mutex> lock(csZerocoinMintPoolTopUp);
+            while (!fZerocoinMintPoolTopUpRequested)
+                condZerocoinMintPoolTopUp.wait(lock);
+            fZerocoinMintPoolTopUpRequested = false;
+        }
+
+        bool fDone = false;
+        try {
+            fDone = !pwalletMain || pwalletMain->TopUpZerocoinMintPool();
+        } catch (const std::exception& e) {
+            // A wallet database write failed, the mints written so far stay in the pool
+            PrintExceptionContinue(&e, "ThreadZerocoinMintPool()");
+        }
+        if (!fDone) {
+            boost::unique_lock<boost::mutex> lock(csZerocoinMintPoolTopUp);
+            fZerocoinMintPoolTopUpDeferred = true;
+        }
+    }
+}
+
 bool CompHeight(const CZerocoinEntry &a, const CZerocoinEntry &b) { return a.nHeight < b.nHeight; }
 
 bool CompID(const CZerocoinEntry &a, const CZerocoinEntry &b) { return a.id < b.id; }
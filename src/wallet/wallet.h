@@ -43,6 +43,8 @@ extern bool bSpendZeroConfChange;
 extern bool fSendFreeTransactions;
 
 static const unsigned int DEFAULT_KEYPOOL_SIZE = 100;
+//! -zcmintpool default, pre-generated zerocoin mints kept of each denomination
+static const unsigned int DEFAULT_ZEROCOIN_MINT_POOL_SIZE = 0;
 //! -paytxfee default
 static const CAmount DEFAULT_TRANSACTION_FEE = 0;
 //! -fallbackfee default
@@ -643,6 +645,10 @@ public:
 
     std::set<int64_t> setKeyPool;
     std::map<CKeyID, CKeyMetadata> mapKeyMetadata;
+    //! Witnesses of the unspent zerocoin mints by pubcoin value and modulus version
+    std::map<std::pair<CBigNum, bool>, CZerocoinWitnessEntry> mapZerocoinWitnesses;
+    //! Indices of the pre-generated zerocoin mints in the wallet database by denomination
+    std::map<int, std::set<int64_t> > mapZerocoinMintPool;
     //jnode
     int64_t nKeysLeftSinceAutoBackup;
 
@@ -864,6 +870,24 @@ public:
 
     bool SetZerocoinBook(const CZerocoinEntry& zerocoinEntry);
 
+    //! Witness of a zerocoin mint for a spend against the coins minted up to maxHeight in the chain of pindexTip
+    libzerocoin::AccumulatorWitness GetZerocoinWitness(const CBlockIndex *pindexTip, int maxHeight, int denomination,
+                                                       int id, const CBigNum &pubCoin, bool fModulusV2);
+    //! Advance the witnesses of the mints whose groups got coins in pindexConfirmed, the last block spends can use,
+    //! and start keeping the ones of the wallet's mints in it
+    void UpdateZerocoinWitnesses(const CBlockIndex *pindexTip, const CBlockIndex *pindexConfirmed, bool fModulusV2);
+    //! Drop the witness checkpoints holding coins of pindex, being disconnected, and the witnesses left without any
+    void RollBackZerocoinWitnesses(const CBlockIndex *pindex);
+    void LoadZerocoinWitness(const CZerocoinWitnessEntry &entry);
+
+    //! Generate zerocoin mints until the pool has nSize of each denomination, false if the wallet is locked
+    bool TopUpZerocoinMintPool(unsigned int nSize = 0);
+    //! A new version 2 mint of the denomination under modulus v2, out of the pool if it has one
+    libzerocoin::PrivateCoin NewZerocoinMint(libzerocoin::CoinDenomination denomination);
+    //! Drop the pre-generated mints, for when they can't be decrypted with the master key anymore
+    void EraseZerocoinMintPool();
+    void LoadZerocoinMintPoolEntry(int64_t nIndex, const CZerocoinMintPoolEntry &entry);
+
     bool CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey);
 
     bool CreateCollateralTransaction(CMutableTransaction& txCollateral, std::string& strReason);
@@ -1192,6 +1216,116 @@ public:
     }
 };
 
+/**
+ * Witness of a zerocoin mint of the wallet, kept up to date as the coins of its group get confirmed so that
+ * spends don't have to accumulate every coin minted after it again.
+ */
+class CZerocoinWitnessEntry
+{
+public:
+    //! Witness value holding all the coins of the group minted up to block hashBlock at nHeight, but the mint
+    struct Checkpoint
+    {
+        int nHeight;
+        uint256 hashBlock;
+        Bignum witness;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(nHeight);
+            READWRITE(hashBlock);
+            READWRITE(witness);
+        }
+    };
+
+    //! Checkpoints are kept back to this many confirmed blocks with mints of the group, to roll back reorganizations
+    static const unsigned int MAX_CHECKPOINTS = 10;
+
+    Bignum pubCoin;
+    int denomination;
+    int id;
+    bool fModulusV2;
+    //! Oldest first
+    std::vector<Checkpoint> checkpoints;
+
+    CZerocoinWitnessEntry()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        pubCoin = 0;
+        denomination = 0;
+        id = 0;
+        fModulusV2 = false;
+        checkpoints.clear();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(pubCoin);
+        READWRITE(denomination);
+        READWRITE(id);
+        READWRITE(fModulusV2);
+        READWRITE(checkpoints);
+    }
+};
+
+/**
+ * Zerocoin mint generated ahead of time, so that minting does not have to wait for the prime search. The coin
+ * secrets are encrypted with the master key of encrypted wallets.
+ */
+class CZerocoinMintPoolEntry
+{
+public:
+    int64_t nTime;
+    int denomination;
+    bool fCrypted;
+    //! Initialization vector of the encryption
+    uint256 nIV;
+    //! Serialized libzerocoin::PrivateCoin, encrypted if fCrypted
+    std::vector<unsigned char> vchCoin;
+
+    CZerocoinMintPoolEntry()
+    {
+        SetNull();
+    }
+
+    void SetNull()
+    {
+        nTime = 0;
+        denomination = 0;
+        fCrypted = false;
+        nIV.SetNull();
+        vchCoin.clear();
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        if (!(nType & SER_GETHASH))
+            READWRITE(nVersion);
+        READWRITE(nTime);
+        READWRITE(denomination);
+        READWRITE(fCrypted);
+        READWRITE(nIV);
+        READWRITE(vchCoin);
+    }
+};
+
+//! Keeps the zerocoin mint pool of pwalletMain topped up as mints are taken from it
+void ThreadZerocoinMintPool();
+//! Have the mint pool thread top up the pool, mints were taken from it
+void ScheduleZerocoinMintPoolTopUp();
+//! Have the mint pool thread retry a top up that found the wallet locked or failed, the wallet got unlocked
+void ResumeZerocoinMintPoolTopUp();
+
 bool CompHeight(const CZerocoinEntry & a, const CZerocoinEntry & b);
 bool CompID(const CZerocoinEntry & a, const CZerocoinEntry & b);
 #endif // BITCOIN_WALLET_WALLET_H
@@ -233,6 +233,32 @@ bool CWalletDB::EraseCoinSpendSerialEntry(const CZerocoinSpendEntry &zerocoinSpe
     return Erase(make_pair(string("zcserial"), zerocoinSpend.coinSerial));
 }
 
+bool CWalletDB::ReadZerocoinWitness(const CBigNum &pubCoin, bool fModulusV2, CZerocoinWitnessEntry &witness) {
+    return Read(std::make_tuple(string("zcwitness"), pubCoin, fModulusV2), witness);
+}
+
+bool CWalletDB::WriteZerocoinWitness(const CZerocoinWitnessEntry &witness) {
+    return Write(std::make_tuple(string("zcwitness"), witness.pubCoin, witness.fModulusV2), witness, true);
+}
+
+bool CWalletDB::EraseZerocoinWitness(const CZerocoinWitnessEntry &witness) {
+    return Erase(std::make_tuple(string("zcwitness"), witness.pubCoin, witness.fModulusV2));
+}
+
+bool CWalletDB::ReadZerocoinMintPoolEntry(int64_t nIndex, CZerocoinMintPoolEntry &entry) {
+    return Read(std::make_pair(string("zcmintpool"), nIndex), entry);
+}
+
+bool CWalletDB::WriteZerocoinMintPoolEntry(int64_t nIndex, const CZerocoinMintPoolEntry &entry) {
+    nWalletDBUpdated++;
+    return Write(std::make_pair(string("zcmintpool"), nIndex), entry);
+}
+
+bool CWalletDB::EraseZerocoinMintPoolEntry(int64_t nIndex) {
+    nWalletDBUpdated++;
+    return Erase(std::make_pair(string("zcmintpool"), nIndex));
+}
+
 bool
 CWalletDB::WriteZerocoinAccumulator(libzerocoin::Accumulator accumulator, libzerocoin::CoinDenomination denomination,
                                     int pubcoinid) {
@@ -250,6 +276,10 @@ CWalletDB::ReadZerocoinAccumulator(libzerocoin::Accumulator &accumulator, libzer
 //    return Erase(std::make_tuple(string("zcaccumulator"), (unsigned int) denomination, pubcoinid), accumulator);
 //}
 
+bool CWalletDB::ReadZerocoinEntry(const CBigNum &pubCoin, CZerocoinEntry &zerocoin) {
+    return Read(make_pair(string("zerocoin"), pubCoin), zerocoin);
+}
+
 bool CWalletDB::WriteZerocoinEntry(const CZerocoinEntry &zerocoin) {
     return Write(make_pair(string("zerocoin"), zerocoin.value), zerocoin, true);
 }
@@ -637,6 +667,16 @@ bool ReadKeyValue(CWallet *pwallet, CDataStream &ssKey, CDataStream &ssValue,
                 strErr = "Error reading wallet database: SetHDChain failed";
                 return false;
             }
+        } else if (strType == "zcwitness") {
+            CZerocoinWitnessEntry witness;
+            ssValue >> witness;
+            pwallet->LoadZerocoinWitness(witness);
+        } else if (strType == "zcmintpool") {
+            int64_t nIndex;
+            ssKey >> nIndex;
+            CZerocoinMintPoolEntry entry;
+            ssValue >> entry;
+            pwallet->LoadZerocoinMintPoolEntry(nIndex, entry);
         }
     } catch (...) {
         return false;
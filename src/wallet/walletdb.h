@@ -33,6 +33,8 @@ class uint160;
 class uint256;
 class CZerocoinEntry;
 class CZerocoinSpendEntry;
+class CZerocoinWitnessEntry;
+class CZerocoinMintPoolEntry;
 
 /** Error statuses for the wallet database */
 enum DBErrors
@@ -171,12 +173,19 @@ public:
     CAmount GetAccountCreditDebit(const std::string& strAccount);
     void ListAccountCreditDebit(const std::string& strAccount, std::list<CAccountingEntry>& acentries);
 
+    bool ReadZerocoinEntry(const CBigNum& pubCoin, CZerocoinEntry& zerocoin);
     bool WriteZerocoinEntry(const CZerocoinEntry& zerocoin);
     bool EraseZerocoinEntry(const CZerocoinEntry& zerocoin);
     void ListPubCoin(std::list<CZerocoinEntry>& listPubCoin);
     void ListCoinSpendSerial(std::list<CZerocoinSpendEntry>& listCoinSpendSerial);
     bool WriteCoinSpendSerialEntry(const CZerocoinSpendEntry& zerocoinSpend);
     bool EraseCoinSpendSerialEntry(const CZerocoinSpendEntry& zerocoinSpend);
+    bool ReadZerocoinWitness(const CBigNum& pubCoin, bool fModulusV2, CZerocoinWitnessEntry& witness);
+    bool WriteZerocoinWitness(const CZerocoinWitnessEntry& witness);
+    bool EraseZerocoinWitness(const CZerocoinWitnessEntry& witness);
+    bool ReadZerocoinMintPoolEntry(int64_t nIndex, CZerocoinMintPoolEntry& entry);
+    bool WriteZerocoinMintPoolEntry(int64_t nIndex, const CZerocoinMintPoolEntry& entry);
+    bool EraseZerocoinMintPoolEntry(int64_t nIndex);
     bool WriteZerocoinAccumulator(libzerocoin::Accumulator accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid);
     bool ReadZerocoinAccumulator(libzerocoin::Accumulator& accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid);
     // bool EraseZerocoinAccumulator(libzerocoin::Accumulator& accumulator, libzerocoin::CoinDenomination denomination, int pubcoinid);
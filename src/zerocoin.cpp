@@ -1,5 +1,7 @@
 #include "main.h"
 #include "zerocoin.h"
+#include "txdb.h"
+#include "libzerocoin/ParallelTasks.h"
 #include "timedata.h"
 #include "chainparams.h"
 #include "util.h"
@@ -15,6 +17,9 @@
 #include <chrono>
 
 #include <boost/foreach.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace std;
 
@@ -33,6 +38,20 @@ libzerocoin::Params *ZCParamsV2 = new libzerocoin::Params(bnTrustedModulusV2, bn
 
 static CZerocoinState zerocoinState;
 
+// Zerocoin supply of the active chain, only counted when the database has it from the genesis block on
+static CZerocoinSupply zerocoinSupply;
+static bool fZerocoinSupplyCounted = false;
+
+// Alternative modulus accumulator values are computed ahead for this many blocks before they can be needed
+static const int ZC_ALT_MODULUS_PRECOMPUTE_BLOCKS = 100;
+// Coins accumulated by the background thread between two checks of the chain
+static const size_t ZC_ALT_MODULUS_COINS_PER_PASS = 20000;
+
+static boost::mutex csAltModulusSchedule;
+static boost::condition_variable condAltModulusSchedule;
+// the first pass catches up with the groups loaded at startup
+static bool fAltModulusScheduled = true;
+
 static bool CheckZerocoinSpendSerial(CValidationState &state, const Consensus::Params &params, CZerocoinTxInfo *zerocoinTxInfo, libzerocoin::CoinDenomination denomination, const CBigNum &serial, int nHeight, bool fConnectTip) {
     if (nHeight > params.nCheckBugFixedAtBlock) {
         // check for zerocoin transaction in this block as well
@@ -63,7 +82,8 @@ bool CheckSpendJemcashTransaction(const CTransaction &tx,
                                 int nHeight,
                                 bool isCheckWallet,
                                 bool fStatefulZerocoinCheck,
-                                CZerocoinTxInfo *zerocoinTxInfo) {
+                                CZerocoinTxInfo *zerocoinTxInfo,
+                                vector<CZerocoinSpendCheck> *pvChecks) {
 
     int txHeight = chainActive.Height();
     bool hasZerocoinSpendInputs = false, hasNonZerocoinInputs = false;
@@ -104,7 +124,8 @@ bool CheckSpendJemcashTransaction(const CTransaction &tx,
         CDataStream serializedCoinSpend((const char *)&*(txin.scriptSig.begin() + 4),
                                         (const char *)&*txin.scriptSig.end(),
                                         SER_NETWORK, PROTOCOL_VERSION);
-        libzerocoin::CoinSpend newSpend(zcParams, serializedCoinSpend);
+        std::shared_ptr<libzerocoin::CoinSpend> spend = std::make_shared<libzerocoin::CoinSpend>(zcParams, serializedCoinSpend);
+        libzerocoin::CoinSpend &newSpend = *spend;
 
         int spendVersion = newSpend.getVersion();
         if (spendVersion != ZEROCOIN_TX_VERSION_1 &&
@@ -211,59 +232,59 @@ bool CheckSpendJemcashTransaction(const CTransaction &tx,
             return state.DoS(100, false, NO_MINT_ZEROCOIN, "CheckSpendJemcashTransaction: Error: no coins were minted with such parameters");
 
         bool passVerify = false;
-        CBlockIndex *index = coinGroup.lastBlock;
 
         pair<int,int> denominationAndId = make_pair(targetDenominations[vinIndex], pubcoinId);
-        
-        bool spendHasBlockHash = false;
-        
+
         // Zerocoin v1.5/v2 transaction can cointain block hash of the last mint tx seen at the moment of spend. It speeds
         // up verification
-        if (spendVersion > ZEROCOIN_TX_VERSION_1 && !newSpend.getAccumulatorBlockHash().IsNull()) {
-			spendHasBlockHash = true;
-			uint256 accumulatorBlockHash = newSpend.getAccumulatorBlockHash();
+        uint256 accumulatorBlockHash;
+        if (spendVersion > ZEROCOIN_TX_VERSION_1)
+            accumulatorBlockHash = newSpend.getAccumulatorBlockHash();
 
-			// find index for block with hash of accumulatorBlockHash or set index to the coinGroup.firstBlock if not found
-			while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
-				index = index->pprev;
-		}
+        vector<CBlockIndex *> accBlocks;
+        zerocoinState.GetAccumulatorBlocksForSpend(targetDenominations[vinIndex], pubcoinId,
+                                                   accumulatorBlockHash.IsNull() ? NULL : &accumulatorBlockHash, accBlocks);
 
         decltype(&CBlockIndex::accumulatorChanges) accChanges = fModulusV2 == fModulusV2InIndex ?
                     &CBlockIndex::accumulatorChanges : &CBlockIndex::alternativeAccumulatorChanges;
 
         // Enumerate all the accumulator changes seen in the blockchain starting with the latest block
         // In most cases the latest accumulator value will be used for verification
-        do {
-            if ((index->*accChanges).count(denominationAndId) > 0) {
-                libzerocoin::Accumulator accumulator(zcParams,
-                                                     (index->*accChanges)[denominationAndId].first,
-                                                     targetDenominations[vinIndex]);
-                LogPrintf("CheckSpendJemcashTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
-                passVerify = newSpend.Verify(accumulator, newMetadata);
-            }
+        vector<const pair<CBigNum,int> *> accValues;
+        BOOST_FOREACH(CBlockIndex *index, accBlocks) {
+            if ((index->*accChanges).count(denominationAndId) > 0)
+                accValues.push_back(&(index->*accChanges)[denominationAndId]);
+        }
 
-            // if spend has block hash we don't need to look further
-            if (index == coinGroup.firstBlock || spendHasBlockHash)
-                break;
-            else
-                index = index->pprev;
-        } while (!passVerify);
+        if (pvChecks && spendVersion > ZEROCOIN_TX_VERSION_1) {
+            // Leave the proof to the zerocoin spend checking threads, spend v1s may need the slow path below
+            vector<CBigNum> accumulatorValues;
+            accumulatorValues.reserve(accValues.size());
+            for (size_t i = 0; i < accValues.size(); i++)
+                accumulatorValues.push_back(accValues[i]->first);
+            pvChecks->push_back(CZerocoinSpendCheck(spend, zcParams, targetDenominations[vinIndex],
+                                                    accumulatorValues, txin.nSequence, txHashForMetadata));
+            continue;
+        }
+
+        for (size_t i = 0; i < accValues.size() && !passVerify; i++) {
+            libzerocoin::Accumulator accumulator(zcParams, accValues[i]->first, targetDenominations[vinIndex]);
+            LogPrintf("CheckSpendJemcashTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
+            passVerify = newSpend.Verify(accumulator, newMetadata);
+        }
 
         // Rare case: accumulator value contains some but NOT ALL coins from one block. In this case we will
         // have to enumerate over coins manually. No optimization is really needed here because it's a rarity
         // This can't happen if spend is of version 1.5 or 2.0
         if (!passVerify && spendVersion == ZEROCOIN_TX_VERSION_1) {
-            // Build vector of coins sorted by the time of mint
-            index = coinGroup.lastBlock;
-            vector<CBigNum> pubCoins = index->mintedPubCoins[denominationAndId];
-            if (index != coinGroup.firstBlock) {
-                do {
-                    index = index->pprev;
-                    if (index->mintedPubCoins.count(denominationAndId) > 0)
-                        pubCoins.insert(pubCoins.begin(),
-                                        index->mintedPubCoins[denominationAndId].cbegin(),
-                                        index->mintedPubCoins[denominationAndId].cend());
-                } while (index != coinGroup.firstBlock);
+            // Build vector of coins sorted by the time of mint. Spend v1s don't name a block, all the blocks of the
+            // group are there
+            vector<CBigNum> pubCoins;
+            BOOST_REVERSE_FOREACH(CBlockIndex *index, accBlocks) {
+                if (index->mintedPubCoins.count(denominationAndId) > 0)
+                    pubCoins.insert(pubCoins.end(),
+                                    index->mintedPubCoins[denominationAndId].cbegin(),
+                                    index->mintedPubCoins[denominationAndId].cend());
             }
 
             libzerocoin::Accumulator accumulator(zcParams, targetDenominations[vinIndex]);
@@ -488,7 +509,8 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
                               int nHeight,
                               bool isCheckWallet,
                               bool fStatefulZerocoinCheck,
-                              CZerocoinTxInfo *zerocoinTxInfo)
+                              CZerocoinTxInfo *zerocoinTxInfo,
+                              vector<CZerocoinSpendCheck> *pvChecks)
 {
 	if (tx.IsZerocoinSpend() || tx.IsZerocoinMint()) {
         if ((nHeight != INT_MAX && nHeight >= params.nDisableZerocoinStartBlock)    // transaction is a part of block: disable after specific block number
@@ -547,7 +569,7 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
         {
             if(!isVerifyDB) {
                 if (txout.nValue == totalValue * COIN) {
-                    if(!CheckSpendJemcashTransaction(tx, params, denominations, state, hashTx, isVerifyDB, nHeight, isCheckWallet, fStatefulZerocoinCheck, zerocoinTxInfo)){
+                    if(!CheckSpendJemcashTransaction(tx, params, denominations, state, hashTx, isVerifyDB, nHeight, isCheckWallet, fStatefulZerocoinCheck, zerocoinTxInfo, pvChecks)){
                         return false;
                     }
                 }
@@ -561,8 +583,166 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
     return true;
 }
 
-void DisconnectTipZC(CBlock & /*block*/, CBlockIndex *pindexDelete) {
+bool CZerocoinSpendCheck::operator()() {
+    libzerocoin::SpendMetaData metadata(accumulatorId, txHashForMetadata);
+    // A crafted proof can make the big number arithmetic throw, it fails like any other invalid proof. Nothing may
+    // leave the check, it runs on worker threads
+    try {
+        BOOST_FOREACH(const CBigNum &accumulatorValue, accumulatorValues) {
+            libzerocoin::Accumulator accumulator(zcParams, accumulatorValue, denomination);
+            if (spend->Verify(accumulator, metadata))
+                return true;
+        }
+    }
+    catch (const std::exception &e) {
+        LogPrintf("CZerocoinSpendCheck: verification threw: %s\n", e.what());
+    }
+    LogFailure();
+    return false;
+}
+
+void CZerocoinSpendCheck::AddToBatch(libzerocoin::CoinSpendBatchVerifier &batch) const {
+    vector<libzerocoin::Accumulator> accumulators;
+    accumulators.reserve(accumulatorValues.size());
+    BOOST_FOREACH(const CBigNum &accumulatorValue, accumulatorValues)
+        accumulators.push_back(libzerocoin::Accumulator(zcParams, accumulatorValue, denomination));
+    batch.Add(spend.get(), libzerocoin::SpendMetaData(accumulatorId, txHashForMetadata), accumulators);
+}
+
+void CZerocoinSpendCheck::LogFailure() const {
+    LogPrintf("CZerocoinSpendCheck: verification failed, serial=%s\n", spend->getCoinSerialNumber().ToString());
+}
+
+bool CheckZerocoinSpendsBatch(const std::vector<CZerocoinSpendCheck> &checks) {
+    libzerocoin::CoinSpendBatchVerifier batch;
+    BOOST_FOREACH(const CZerocoinSpendCheck &check, checks)
+        check.AddToBatch(batch);
+
+    vector<bool> results;
+    try {
+        results = batch.Verify();
+    }
+    catch (const std::exception &e) {
+        LogPrintf("CheckZerocoinSpendsBatch: verification threw: %s\n", e.what());
+        return false;
+    }
+
+    bool fAllValid = true;
+    for (size_t i = 0; i < checks.size(); i++) {
+        if (!results[i]) {
+            checks[i].LogFailure();
+            fAllValid = false;
+        }
+    }
+    return fAllValid;
+}
+
+void ZerocoinResetSupply(const uint256 &hashGenesisBlock) {
+    zerocoinSupply = CZerocoinSupply();
+    zerocoinSupply.hashBlock = hashGenesisBlock;
+    fZerocoinSupplyCounted = pblocktree->WriteZerocoinSupply(zerocoinSupply);
+}
+
+bool ZerocoinGetSupply(CZerocoinSupply &supply) {
+    if (!fZerocoinSupplyCounted)
+        return false;
+    supply = zerocoinSupply;
+    return true;
+}
+
+// Move the supply from the previous block to the next one, or back. Counting stops for good if it isn't at the block
+// the change applies to, the amounts would be wrong from there on. It is written to the database with the state snapshot
+static void UpdateZerocoinSupply(const CBlockIndex *pindexFrom, const CBlockIndex *pindexTo, const CZerocoinSupply &change, int nSign) {
+    if (!fZerocoinSupplyCounted)
+        return;
+
+    if (zerocoinSupply.hashBlock != pindexFrom->GetBlockHash()) {
+        LogPrintf("ZerocoinSupply: at block %s instead of %s, stopped counting\n", zerocoinSupply.hashBlock.ToString(),
+                  pindexFrom->GetBlockHash().ToString());
+        fZerocoinSupplyCounted = false;
+        return;
+    }
+
+    BOOST_FOREACH(const PAIRTYPE(int,CAmount) &minted, change.minted)
+        zerocoinSupply.minted[minted.first] += nSign * minted.second;
+    BOOST_FOREACH(const PAIRTYPE(int,CAmount) &spent, change.spent)
+        zerocoinSupply.spent[spent.first] += nSign * spent.second;
+    zerocoinSupply.respent += nSign * change.respent;
+    zerocoinSupply.hashBlock = pindexTo->GetBlockHash();
+}
+
+// Amounts of a block. A spend is a re-spend if the serial is used by a block before it: if the zerocoin state holds
+// the block as well, fBlockInState, the serial is recorded once more. Spends are only known by serial in the index,
+// their denominations come from the zerocoin info of the block or its transactions
+static bool GetBlockZerocoinSupplyChange(const CBlock &block, const CBlockIndex *pindex, bool fBlockInState,
+                                         CZerocoinSupply &change) {
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int),vector<CBigNum>) &pubCoins, pindex->mintedPubCoins) {
+        for (size_t i = 0; i < pubCoins.second.size(); i++)
+            change.AddMint(pubCoins.first.first);
+    }
+
+    if (pindex->spentSerials.empty())
+        return true;
+
+    map<CBigNum,int> spentSerials;
+    if (block.zerocoinTxInfo) {
+        spentSerials = block.zerocoinTxInfo->spentSerials;
+    }
+    else {
+        BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+            if (!tx.IsZerocoinSpend())
+                continue;
+            BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+                if (!txin.IsZerocoinSpend())
+                    continue;
+                try {
+                    CDataStream serializedCoinSpend((const char *)&*(txin.scriptSig.begin() + 4),
+                                                (const char *)&*txin.scriptSig.end(),
+                                                SER_NETWORK, PROTOCOL_VERSION);
+                    libzerocoin::CoinSpend spend(txin.nSequence >= JC_MODULUS_V2_BASE_ID ? ZCParamsV2 : ZCParams, serializedCoinSpend);
+                    spentSerials[spend.getCoinSerialNumber()] = (int)spend.getDenomination();
+                }
+                catch (const std::runtime_error &) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    BOOST_FOREACH(const CBigNum &serial, pindex->spentSerials) {
+        map<CBigNum,int>::const_iterator it = spentSerials.find(serial);
+        if (it == spentSerials.end())
+            return false;
+        change.AddSpend(it->second, zerocoinState.GetCoinSerialSpendCount(serial) > (fBlockInState ? 1U : 0U));
+    }
+    return true;
+}
+
+// Count the block in the supply before the zerocoin state gets it, or take it out before the state drops it
+static void UpdateZerocoinSupplyForBlock(const CBlock &block, const CBlockIndex *pindex, bool fConnect) {
+    if (!fZerocoinSupplyCounted)
+        return;
+
+    CZerocoinSupply change;
+    if (!GetBlockZerocoinSupplyChange(block, pindex, !fConnect, change)) {
+        LogPrintf("ZerocoinSupply: spends of block %s don't match the index, stopped counting\n",
+                  pindex->GetBlockHash().ToString());
+        fZerocoinSupplyCounted = false;
+        return;
+    }
+
+    if (fConnect)
+        UpdateZerocoinSupply(pindex->pprev, pindex, change, 1);
+    else
+        UpdateZerocoinSupply(pindex, pindex->pprev, change, -1);
+}
+
+void DisconnectTipZC(CBlock &block, CBlockIndex *pindexDelete) {
+    UpdateZerocoinSupplyForBlock(block, pindexDelete, false);
     zerocoinState.RemoveBlock(pindexDelete);
+
+    if (pwalletMain)
+        pwalletMain->RollBackZerocoinWitnesses(pindexDelete);
 }
 
 CBigNum ZerocoinGetSpendSerialNumber(const CTransaction &tx, const CTxIn &txin) {
@@ -587,6 +767,9 @@ CBigNum ZerocoinGetSpendSerialNumber(const CTransaction &tx, const CTxIn &txin)
  */
 bool ConnectBlockZC(CValidationState &state, const CChainParams &chainParams, CBlockIndex *pindexNew, const CBlock *pblock, bool fJustCheck) {
 
+    // Zerocoin amounts the block adds to the supply
+    CZerocoinSupply supplyChange;
+
     // Add zerocoin transaction information to index
     if (pblock && pblock->zerocoinTxInfo) {
         if (pblock->zerocoinTxInfo->fHasSpendV1) {
@@ -612,6 +795,7 @@ bool ConnectBlockZC(CValidationState &state, const CChainParams &chainParams, CB
                     return false;
                 
                 if (!fJustCheck) {
+                    supplyChange.AddSpend(serial.second, zerocoinState.IsUsedCoinSerial(serial.first));
                     pindexNew->spentSerials.insert(serial.first);
                     zerocoinState.AddSpend(serial.first);
                 }
@@ -627,6 +811,7 @@ bool ConnectBlockZC(CValidationState &state, const CChainParams &chainParams, CB
             CBigNum oldAccValue(0);
             int denomination = mint.first;
             int mintId = zerocoinState.AddMint(pindexNew, denomination, mint.second, oldAccValue);
+            supplyChange.AddMint(denomination);
 
             libzerocoin::Params *zcParams = IsZerocoinTxV2((libzerocoin::CoinDenomination)denomination, 
                                                 chainParams.GetConsensus(), mintId) ? ZCParamsV2 : ZCParams;
@@ -662,6 +847,24 @@ bool ConnectBlockZC(CValidationState &state, const CChainParams &chainParams, CB
     }
     else if (!fJustCheck) {
         zerocoinState.AddBlock(pindexNew, chainParams.GetConsensus());
+        // the index doesn't have the denominations of the spends
+        if (!pindexNew->spentSerials.empty() || !pindexNew->mintedPubCoins.empty()) {
+            LogPrintf("ZerocoinSupply: block %s connected without its transactions, stopped counting\n",
+                      pindexNew->GetBlockHash().ToString());
+            fZerocoinSupplyCounted = false;
+        }
+    }
+
+    if (!fJustCheck) {
+        UpdateZerocoinSupply(pindexNew->pprev, pindexNew, supplyChange, 1);
+        ZerocoinScheduleAlternativeModulusAccumulators();
+    }
+
+    // Mints of the block that just got enough confirmations to be spent with go into the wallet's witnesses
+    if (!fJustCheck && pwalletMain && pindexNew->nHeight >= JC_MINT_CONFIRMATIONS - 1) {
+        CBlockIndex *pindexConfirmed = pindexNew->GetAncestor(pindexNew->nHeight - (JC_MINT_CONFIRMATIONS - 1));
+        pwalletMain->UpdateZerocoinWitnesses(pindexNew, pindexConfirmed,
+                                             pindexNew->nHeight >= chainParams.GetConsensus().nModulusV2StartBlock);
     }
 
     return true;
@@ -679,14 +882,70 @@ int ZerocoinGetNHeight(const CBlockHeader &block) {
 }
 
 
-bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes) {
+bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes, const CZerocoinStateSnapshot *snapshot,
+                                 const CZerocoinSupply *supply) {
     auto params = Params().GetConsensus();
 
-    zerocoinState.Reset();
-    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
+    // Only the blocks after the snapshot are replayed, its accumulators were checked before it was taken
+    CBlockIndex *firstBlock = chain->Genesis();
+    if (snapshot != NULL && zerocoinState.LoadSnapshot(chain, *snapshot)) {
+        LogPrintf("ZerocoinState: loaded snapshot at height %d\n", snapshot->nHeight);
+        firstBlock = chain->Next((*chain)[snapshot->nHeight]);
+    }
+    else {
+        if (snapshot != NULL)
+            LogPrintf("ZerocoinState: snapshot at height %d doesn't match the chain, rebuilding the state\n", snapshot->nHeight);
+        zerocoinState.Reset();
+    }
+
+    // Size the coin and serial tables for the blocks to replay at once instead of growing them as they go
+    size_t nMints = 0, nSerials = 0;
+    for (CBlockIndex *blockIndex = firstBlock; blockIndex; blockIndex=chain->Next(blockIndex)) {
+        BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int),vector<CBigNum>) &pubCoins, blockIndex->mintedPubCoins)
+            nMints += pubCoins.second.size();
+        nSerials += blockIndex->spentSerials.size();
+    }
+    zerocoinState.mintedPubCoins.reserve(zerocoinState.mintedPubCoins.size() + nMints);
+    zerocoinState.usedCoinSerials.reserve(zerocoinState.usedCoinSerials.size() + nSerials);
+
+    // The supply is counted on from the block it was written at, normally the one of the snapshot, as long as the
+    // state isn't past it already
+    fZerocoinSupplyCounted = false;
+    const CBlockIndex *supplyBlock = NULL;
+    if (supply != NULL) {
+        BlockMap::const_iterator mi = mapBlockIndex.find(supply->hashBlock);
+        if (mi != mapBlockIndex.end() && chain->Contains(mi->second))
+            supplyBlock = mi->second;
+        int nStateHeight = firstBlock ? firstBlock->nHeight - 1 : chain->Height();
+        if (supplyBlock != NULL && supplyBlock->nHeight >= nStateHeight) {
+            zerocoinSupply = *supply;
+            fZerocoinSupplyCounted = true;
+        }
+        else {
+            LogPrintf("ZerocoinSupply: at block %s the state can't be replayed from, reindex to count it\n",
+                      supply->hashBlock.ToString());
+        }
+    }
+    else {
+        LogPrintf("ZerocoinSupply: not in the database, reindex to count it\n");
+    }
+
+    for (CBlockIndex *blockIndex = firstBlock; blockIndex; blockIndex=chain->Next(blockIndex)) {
+        if (fZerocoinSupplyCounted && blockIndex->nHeight > supplyBlock->nHeight) {
+            // only blocks with spends are read, the index has the mints
+            CBlock block;
+            if (!blockIndex->spentSerials.empty() && !ReadBlockFromDisk(block, blockIndex, params, false)) {
+                LogPrintf("ZerocoinSupply: can't read block %s, reindex to count it\n", blockIndex->GetBlockHash().ToString());
+                fZerocoinSupplyCounted = false;
+            }
+            else {
+                UpdateZerocoinSupplyForBlock(block, blockIndex, true);
+            }
+        }
         zerocoinState.AddBlock(blockIndex, params);
+    }
 
-    changes = zerocoinState.RecalculateAccumulators(chain);
+    changes = zerocoinState.RecalculateAccumulators(chain, firstBlock ? firstBlock->nHeight : chain->Height() + 1);
 
     // DEBUG
     LogPrintf("Latest IDs are %d, %d, %d, %d, %d\n",
@@ -698,6 +957,56 @@ bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes) {
     return true;
 }
 
+void ZerocoinScheduleAlternativeModulusAccumulators() {
+    boost::unique_lock<boost::mutex> lock(csAltModulusSchedule);
+    fAltModulusScheduled = true;
+    condAltModulusSchedule.notify_one();
+}
+
+void ThreadZerocoinAlternativeModulusAccumulators() {
+    RenameThread("jemcash-zcaltacc");
+    SetThreadPriority(THREAD_PRIORITY_LOWEST);
+
+    for (;;) {
+        {
+            boost::unique_lock<boost::mutex> lock(csAltModulusSchedule);
+            while (!fAltModulusScheduled)
+                condAltModulusSchedule.wait(lock);
+            fAltModulusScheduled = false;
+        }
+
+        vector<CZerocoinState::AlternativeModulusJob> jobs;
+        bool fComplete;
+        {
+            LOCK(cs_main);
+            fComplete = zerocoinState.GetAlternativeModulusJobs(chainActive.Height(), ZC_ALT_MODULUS_COINS_PER_PASS, jobs);
+        }
+        if (jobs.empty())
+            continue;
+
+        // the groups are computed without holding cs_main, one at a time on this thread so that the exponentiations
+        // run at its priority and shutdown waits for a single group at most
+        try {
+            BOOST_FOREACH(CZerocoinState::AlternativeModulusJob &job, jobs) {
+                boost::this_thread::interruption_point();
+                job.Run();
+            }
+        } catch (const std::exception &e) {
+            LogPrintf("ThreadZerocoinAlternativeModulusAccumulators: %s\n", e.what());
+            fComplete = true;
+        }
+
+        {
+            LOCK(cs_main);
+            BOOST_FOREACH(const CZerocoinState::AlternativeModulusJob &job, jobs)
+                zerocoinState.SetAlternativeModulusValues(job);
+        }
+
+        if (!fComplete)
+            ZerocoinScheduleAlternativeModulusAccumulators();
+    }
+}
+
 // CZerocoinTxInfo
 
 void CZerocoinTxInfo::Complete() {
@@ -715,19 +1024,15 @@ void CZerocoinTxInfo::Complete() {
     fInfoIsComplete = true;
 }
 
-// CZerocoinState::CBigNumHash
+// CZerocoinState
 
-std::size_t CZerocoinState::CBigNumHash::operator ()(const CBigNum &bn) const noexcept {
-    // we are operating on almost random big numbers and least significant bytes (save for few last bytes) give us a good hash
-    vector<unsigned char> bnData = bn.ToBytes();
-    if (bnData.size() < sizeof(size_t)*3)
-        // rare case, put ones like that into one hash bin
-        return 0;
-    else
-        return ((size_t*)bnData.data())[1];
-}
+typedef vector<CZerocoinState::CoinGroupBlock>::const_iterator CoinGroupBlockIterator;
 
-// CZerocoinState
+// First block of the coin group at height nHeight or above
+static CoinGroupBlockIterator CoinGroupBlockLowerBound(const vector<CZerocoinState::CoinGroupBlock> &blocks, int nHeight) {
+    return lower_bound(blocks.begin(), blocks.end(), nHeight,
+                       [](const CZerocoinState::CoinGroupBlock &b, int h) { return b.block->nHeight < h; });
+}
 
 CZerocoinState::CZerocoinState() {
 }
@@ -763,11 +1068,16 @@ int CZerocoinState::AddMint(CBlockIndex *index, int denomination, const CBigNum
         newCoinGroup.nCoins = 1;
     }
 
+    vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[make_pair(denomination, mintId)];
+    if (groupBlocks.empty() || groupBlocks.back().block != index)
+        groupBlocks.push_back(CoinGroupBlock(index, 0));
+    groupBlocks.back().nCoins = coinGroups[make_pair(denomination, mintId)].nCoins;
+
     CMintedCoinInfo coinInfo;
     coinInfo.denomination = denomination;
     coinInfo.id = mintId;
     coinInfo.nHeight = index->nHeight;
-    mintedPubCoins.insert(pair<CBigNum,CMintedCoinInfo>(pubCoin, coinInfo));
+    mintedPubCoins.insert(pubCoin, coinInfo);
 
     return mintId;
 }
@@ -785,6 +1095,7 @@ void CZerocoinState::AddBlock(CBlockIndex *index, const Consensus::Params &param
             coinGroup.firstBlock = index;
         coinGroup.lastBlock = index;
         coinGroup.nCoins += accUpdate.second.second;
+        coinGroupBlocks[accUpdate.first].push_back(CoinGroupBlock(index, coinGroup.nCoins));
     }
 
     BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int),vector<CBigNum>) &pubCoins, index->mintedPubCoins) {
@@ -794,7 +1105,7 @@ void CZerocoinState::AddBlock(CBlockIndex *index, const Consensus::Params &param
             coinInfo.denomination = pubCoins.first.first;
             coinInfo.id = pubCoins.first.second;
             coinInfo.nHeight = index->nHeight;
-            mintedPubCoins.insert(pair<CBigNum,CMintedCoinInfo>(coin, coinInfo));
+            mintedPubCoins.insert(coin, coinInfo);
         }
     }
 
@@ -817,28 +1128,27 @@ void CZerocoinState::RemoveBlock(CBlockIndex *index) {
         if ((coinGroup.nCoins -= nMintsToForget) == 0) {
             // all the coins of this group have been erased, remove the group altogether
             coinGroups.erase(accUpdate.first);
+            coinGroupBlocks.erase(accUpdate.first);
             // decrease pubcoin id for this denomination
             latestCoinIds[accUpdate.first.first]--;
         }
         else {
             // roll back lastBlock to previous position
-            do {
-                assert(coinGroup.lastBlock != coinGroup.firstBlock);
-                coinGroup.lastBlock = coinGroup.lastBlock->pprev;
-            } while (coinGroup.lastBlock->accumulatorChanges.count(accUpdate.first) == 0);
+            vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[accUpdate.first];
+            assert(groupBlocks.size() > 1 && groupBlocks.back().block == index);
+            groupBlocks.pop_back();
+            coinGroup.lastBlock = groupBlocks.back().block;
         }
     }
 
     // roll back mints
     BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int),vector<CBigNum>) &pubCoins, index->mintedPubCoins) {
         BOOST_FOREACH(const CBigNum &coin, pubCoins.second) {
-            auto coins = mintedPubCoins.equal_range(coin);
-            auto coinIt = find_if(coins.first, coins.second, [=](const decltype(mintedPubCoins)::value_type &v) {
-                return v.second.denomination == pubCoins.first.first &&
-                        v.second.id == pubCoins.first.second;
+            bool fErased = mintedPubCoins.erase_if(coin, [&pubCoins](const CMintedCoinInfo &coinInfo) {
+                return coinInfo.denomination == pubCoins.first.first &&
+                        coinInfo.id == pubCoins.first.second;
             });
-            assert(coinIt != coins.second);
-            mintedPubCoins.erase(coinIt);
+            assert(fErased);
         }
     }
 
@@ -857,10 +1167,45 @@ bool CZerocoinState::GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &r
     return true;
 }
 
+void CZerocoinState::GetAccumulatorBlocksForSpend(int denomination, int id, const uint256 *accumulatorBlockHash,
+                                                  vector<CBlockIndex *> &blocks) {
+    blocks.clear();
+
+    pair<int,int> key = make_pair(denomination, id);
+    if (coinGroups.count(key) == 0)
+        return;
+
+    CoinGroupInfo &coinGroup = coinGroups[key];
+    if (accumulatorBlockHash) {
+        // the named block if it is between the first and last blocks of the group, whether it changed the
+        // accumulator or not, the first block otherwise
+        CBlockIndex *index = coinGroup.firstBlock;
+        BlockMap::const_iterator mi = mapBlockIndex.find(*accumulatorBlockHash);
+        if (mi != mapBlockIndex.end()) {
+            CBlockIndex *namedBlock = mi->second;
+            if (namedBlock->nHeight > coinGroup.firstBlock->nHeight &&
+                    namedBlock->nHeight <= coinGroup.lastBlock->nHeight &&
+                    coinGroup.lastBlock->GetAncestor(namedBlock->nHeight) == namedBlock)
+                index = namedBlock;
+        }
+        blocks.push_back(index);
+    }
+    else {
+        const vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[key];
+        blocks.reserve(groupBlocks.size());
+        BOOST_REVERSE_FOREACH(const CoinGroupBlock &groupBlock, groupBlocks)
+            blocks.push_back(groupBlock.block);
+    }
+}
+
 bool CZerocoinState::IsUsedCoinSerial(const CBigNum &coinSerial) {
     return usedCoinSerials.count(coinSerial) != 0;
 }
 
+size_t CZerocoinState::GetCoinSerialSpendCount(const CBigNum &coinSerial) {
+    return usedCoinSerials.count(coinSerial);
+}
+
 bool CZerocoinState::HasCoin(const CBigNum &pubCoin) {
     return mintedPubCoins.count(pubCoin) != 0;
 }
@@ -891,28 +1236,17 @@ int CZerocoinState::GetAccumulatorValueForSpend(CChain *chain, int maxHeight, in
         accChangeField = &CBlockIndex::accumulatorChanges;
     }
 
-    int numberOfCoins = 0;
-    for (;;) {
-        map<pair<int,int>, pair<CBigNum,int>> &accumulatorChanges = lastBlock->*accChangeField;
-        if (accumulatorChanges.count(denomAndId) > 0) {
-            if (lastBlock->nHeight <= maxHeight) {
-                if (numberOfCoins == 0) {
-                    // latest block satisfying given conditions
-                    // remember accumulator value and block hash
-                    accumulator = accumulatorChanges[denomAndId].first;
-                    blockHash = lastBlock->GetBlockHash();
-                }
-                numberOfCoins += accumulatorChanges[denomAndId].second;
-            }
-        }
-
-        if (lastBlock == coinGroup.firstBlock)
-            break;
-        else
-            lastBlock = lastBlock->pprev;
-    }
+    // latest block satisfying given conditions
+    const vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[denomAndId];
+    CoinGroupBlockIterator it = CoinGroupBlockLowerBound(groupBlocks, maxHeight == INT_MAX ? INT_MAX : maxHeight + 1);
+    if (it == groupBlocks.begin())
+        return 0;
+    --it;
 
-    return numberOfCoins;
+    // remember accumulator value and block hash
+    accumulator = (it->block->*accChangeField)[denomAndId].first;
+    blockHash = it->block->GetBlockHash();
+    return it->nCoins;
 }
 
 libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain, int maxHeight, int denomination,
@@ -923,8 +1257,6 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
 
     assert(coinGroups.count(denomAndId) > 0);
 
-    CoinGroupInfo coinGroup = coinGroups[denomAndId];
-
     int coinId;
     int mintHeight = GetMintedCoinHeightAndId(pubCoin, denomination, coinId);
 
@@ -943,18 +1275,18 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
 
     // Find accumulator value preceding mint operation
     CBlockIndex *mintBlock = (*chain)[mintHeight];
-    CBlockIndex *block = mintBlock;
+    const vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[denomAndId];
+    CoinGroupBlockIterator mintIt = CoinGroupBlockLowerBound(groupBlocks, mintHeight);
+    assert(mintIt != groupBlocks.end() && mintIt->block == mintBlock);
     libzerocoin::Accumulator accumulator(zcParams, d);
-    if (block != coinGroup.firstBlock) {
-        do {
-            block = block->pprev;
-        } while ((block->*accChangeField).count(denomAndId) == 0);
+    if (mintIt != groupBlocks.begin()) {
+        CBlockIndex *block = (mintIt - 1)->block;
         accumulator = libzerocoin::Accumulator(zcParams, (block->*accChangeField)[denomAndId].first, d);
     }
 
     // Now add to the accumulator every coin minted since that moment except pubCoin
-    block = coinGroup.lastBlock;
-    for (;;) {
+    for (CoinGroupBlockIterator it = groupBlocks.end(); it != mintIt; ) {
+        CBlockIndex *block = (--it)->block;
         if (block->nHeight <= maxHeight && block->mintedPubCoins.count(denomAndId) > 0) {
             vector<CBigNum> &pubCoins = block->mintedPubCoins[denomAndId];
             for (const CBigNum &coin: pubCoins) {
@@ -962,63 +1294,197 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
                     accumulator += libzerocoin::PublicCoin(zcParams, coin, d);
             }
         }
-        if (block != mintBlock)
-            block = block->pprev;
-        else
-            break;
     }
 
     return libzerocoin::AccumulatorWitness(zcParams, accumulator, libzerocoin::PublicCoin(zcParams, pubCoin, d));
 }
 
+void CZerocoinState::AdvanceWitnessForSpend(int fromHeight, int toHeight, int denomination, int id,
+                                            const CBigNum &pubCoin, bool useModulusV2, CBigNum &witnessValue) {
+
+    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
+    pair<int, int> denomAndId = pair<int, int>(denomination, id);
+
+    if (coinGroupBlocks.count(denomAndId) == 0)
+        return;
+
+    int coinId;
+    int mintHeight = GetMintedCoinHeightAndId(pubCoin, denomination, coinId);
+
+    libzerocoin::Params *zcParams = useModulusV2 ? ZCParamsV2 : ZCParams;
+    libzerocoin::Accumulator accumulator(zcParams, witnessValue, d);
+
+    const vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[denomAndId];
+    for (CoinGroupBlockIterator it = CoinGroupBlockLowerBound(groupBlocks, fromHeight + 1);
+            it != groupBlocks.end() && it->block->nHeight <= toHeight; ++it) {
+        CBlockIndex *block = it->block;
+        if (block->mintedPubCoins.count(denomAndId) > 0) {
+            for (const CBigNum &coin: block->mintedPubCoins[denomAndId]) {
+                if (block->nHeight != mintHeight || coin != pubCoin)
+                    accumulator += libzerocoin::PublicCoin(zcParams, coin, d);
+            }
+        }
+    }
+
+    witnessValue = accumulator.getValue();
+}
+
 int CZerocoinState::GetMintedCoinHeightAndId(const CBigNum &pubCoin, int denomination, int &id) {
-    auto coins = mintedPubCoins.equal_range(pubCoin);
-    auto coinIt = find_if(coins.first, coins.second,
-                          [=](const decltype(mintedPubCoins)::value_type &v) { return v.second.denomination == denomination; });
+    const CMintedCoinInfo *coinInfo = mintedPubCoins.find_if(pubCoin,
+            [=](const CMintedCoinInfo &v) { return v.denomination == denomination; });
 
-    if (coinIt != coins.second) {
-        id = coinIt->second.id;
-        return coinIt->second.nHeight;
+    if (coinInfo != NULL) {
+        id = coinInfo->id;
+        return coinInfo->nHeight;
     }
     else
         return -1;
 }
 
+// Product of the coins, multiplied in pairs so the factors stay of similar sizes
+static CBigNum ProductOfCoins(vector<CBigNum> coins) {
+    if (coins.empty())
+        return CBigNum(1);
+    while (coins.size() > 1) {
+        size_t nPairs = coins.size() / 2;
+        for (size_t i = 0; i < nPairs; i++)
+            coins[i] = coins[2 * i] * coins[2 * i + 1];
+        if (coins.size() % 2 != 0)
+            coins[nPairs++] = coins.back();
+        coins.resize(nPairs);
+    }
+    return coins[0];
+}
+
+void CZerocoinState::AlternativeModulusJob::Run() {
+    vector<CBigNum> exponents(blocks.size());
+    libzerocoin::ParallelTasks tasks;
+    tasks.AddRange(0, blocks.size(), [this, &exponents](size_t i) {
+        exponents[i] = ProductOfCoins(blockCoins[i]);
+    });
+    tasks.Wait();
+
+    // accumulating the coins one at a time gives the same value
+    CBigNum value = startValue;
+    values.clear();
+    values.reserve(blocks.size());
+    BOOST_FOREACH(const CBigNum &exponent, exponents) {
+        value = value.pow_mod(exponent, altParams->accumulatorParams.accumulatorModulus);
+        values.push_back(value);
+    }
+}
+
+bool CZerocoinState::GetAlternativeModulusJob(const pair<int, int> &denomAndId, size_t nMaxCoins, AlternativeModulusJob &job) {
+    auto groupBlocksIt = coinGroupBlocks.find(denomAndId);
+    if (groupBlocksIt == coinGroupBlocks.end())
+        return false;
+    const vector<CoinGroupBlock> &groupBlocks = groupBlocksIt->second;
+
+    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomAndId.first;
+    job.denomAndId = denomAndId;
+    job.altParams = IsZerocoinTxV2(d, Params().GetConsensus(), denomAndId.second) ? ZCParams : ZCParamsV2;
+    job.startValue = job.altParams->accumulatorParams.accumulatorBase;
+    job.blocks.clear();
+    job.blockCoins.clear();
+    job.values.clear();
+
+    size_t nCoins = 0;
+    BOOST_FOREACH(const CoinGroupBlock &groupBlock, groupBlocks) {
+        CBlockIndex *block = groupBlock.block;
+        auto altChange = block->alternativeAccumulatorChanges.find(denomAndId);
+        if (job.blocks.empty() && altChange != block->alternativeAccumulatorChanges.end()) {
+            // already calculated, continue from the cached value
+            job.startValue = altChange->second.first;
+            continue;
+        }
+
+        assert(block->mintedPubCoins.count(denomAndId) > 0);
+        const vector<CBigNum> &mintedCoins = block->mintedPubCoins.find(denomAndId)->second;
+        // at least one block for the job to make progress
+        if (!job.blocks.empty() && nCoins + mintedCoins.size() > nMaxCoins)
+            break;
+        nCoins += mintedCoins.size();
+        job.blocks.push_back(block);
+        job.blockCoins.push_back(mintedCoins);
+    }
+
+    return !job.blocks.empty();
+}
+
+bool CZerocoinState::GetAlternativeModulusJobs(int nHeight, size_t nMaxCoins, vector<AlternativeModulusJob> &jobs) {
+    const Consensus::Params &params = Params().GetConsensus();
+    // Old groups can be spent with modulus v2 once it starts, get ready a bit before. New groups can be spent
+    // with modulus v1 until it stops
+    bool fV1GroupsNeeded = nHeight >= params.nModulusV2StartBlock - ZC_ALT_MODULUS_PRECOMPUTE_BLOCKS;
+    bool fV2GroupsNeeded = nHeight < params.nModulusV1StopBlock;
+
+    jobs.clear();
+    size_t nCoins = 0;
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CoinGroupInfo) &coinGroup, coinGroups) {
+        bool fNativeModulusV2 = IsZerocoinTxV2((libzerocoin::CoinDenomination)coinGroup.first.first, params, coinGroup.first.second);
+        if (!(fNativeModulusV2 ? fV2GroupsNeeded : fV1GroupsNeeded))
+            continue;
+
+        if (nCoins >= nMaxCoins)
+            return false;
+        AlternativeModulusJob job;
+        if (!GetAlternativeModulusJob(coinGroup.first, nMaxCoins - nCoins, job))
+            continue;
+        BOOST_FOREACH(const vector<CBigNum> &coins, job.blockCoins)
+            nCoins += coins.size();
+        bool fComplete = job.blocks.back() == coinGroup.second.lastBlock;
+        jobs.push_back(job);
+        if (!fComplete)
+            return false;
+    }
+    return true;
+}
+
+void CZerocoinState::SetAlternativeModulusValues(const AlternativeModulusJob &job) {
+    auto groupBlocksIt = coinGroupBlocks.find(job.denomAndId);
+    if (groupBlocksIt == coinGroupBlocks.end() || job.blocks.empty())
+        return;
+    const vector<CoinGroupBlock> &groupBlocks = groupBlocksIt->second;
+
+    // the blocks before the job still have to end with its start value
+    CoinGroupBlockIterator it = CoinGroupBlockLowerBound(groupBlocks, job.blocks[0]->nHeight);
+    if (it == groupBlocks.begin()) {
+        if (job.startValue != job.altParams->accumulatorParams.accumulatorBase)
+            return;
+    }
+    else {
+        auto prevChange = (it - 1)->block->alternativeAccumulatorChanges.find(job.denomAndId);
+        if (prevChange == (it - 1)->block->alternativeAccumulatorChanges.end() || prevChange->second.first != job.startValue)
+            return;
+    }
+
+    // and its blocks to be the next ones with the same coins
+    for (size_t i = 0; i < job.values.size() && i < job.blocks.size(); i++, ++it) {
+        CBlockIndex *block = job.blocks[i];
+        if (it == groupBlocks.end() || it->block != block || block->mintedPubCoins.count(job.denomAndId) == 0)
+            return;
+        const vector<CBigNum> &mintedCoins = block->mintedPubCoins.find(job.denomAndId)->second;
+        if (mintedCoins.size() != job.blockCoins[i].size())
+            return;
+        if (block->alternativeAccumulatorChanges.count(job.denomAndId) == 0)
+            block->alternativeAccumulatorChanges[job.denomAndId] = make_pair(job.values[i], (int)mintedCoins.size());
+    }
+}
+
 void CZerocoinState::CalculateAlternativeModulusAccumulatorValues(CChain *chain, int denomination, int id) {
-    libzerocoin::CoinDenomination d = (libzerocoin::CoinDenomination)denomination;
     pair<int, int> denomAndId = pair<int, int>(denomination, id);
-    libzerocoin::Params *altParams = IsZerocoinTxV2(d, Params().GetConsensus(), id) ? ZCParams : ZCParamsV2;
-    libzerocoin::Accumulator accumulator(altParams, d);
 
     if (coinGroups.count(denomAndId) == 0) {
         // Can happen when verification is done prior to syncing with network
         return;
     }
 
-    CoinGroupInfo coinGroup = coinGroups[denomAndId];
-
-    CBlockIndex *block = coinGroup.firstBlock;
-    for (;;) {
-        if (block->accumulatorChanges.count(denomAndId) > 0) {
-            if (block->alternativeAccumulatorChanges.count(denomAndId) > 0)
-                // already calculated, update accumulator with cached value
-                accumulator = libzerocoin::Accumulator(altParams, block->alternativeAccumulatorChanges[denomAndId].first, d);
-            else {
-                // re-create accumulator changes with alternative params
-                assert(block->mintedPubCoins.count(denomAndId) > 0);
-                const vector<CBigNum> &mintedCoins = block->mintedPubCoins[denomAndId];
-                BOOST_FOREACH(const CBigNum &c, mintedCoins) {
-                    accumulator += libzerocoin::PublicCoin(altParams, c, d);
-                }
-                block->alternativeAccumulatorChanges[denomAndId] = make_pair(accumulator.getValue(), (int)mintedCoins.size());
-            }
-        }
-
-        if (block != coinGroup.lastBlock)
-            block = (*chain)[block->nHeight+1];
-        else
-            break;
-    }
+    // Usually computed by the background thread already
+    AlternativeModulusJob job;
+    if (!GetAlternativeModulusJob(denomAndId, SIZE_MAX, job))
+        return;
+    job.Run();
+    SetAlternativeModulusValues(job);
 }
 
 bool CZerocoinState::TestValidity(CChain *chain) {
@@ -1030,8 +1496,8 @@ bool CZerocoinState::TestValidity(CChain *chain) {
 
         libzerocoin::Accumulator acc(&zcParams->accumulatorParams, (libzerocoin::CoinDenomination)coinGroup.first.first);
 
-        CBlockIndex *block = coinGroup.second.firstBlock;
-        for (;;) {
+        BOOST_FOREACH(const CoinGroupBlock &groupBlock, coinGroupBlocks[coinGroup.first]) {
+            CBlockIndex *block = groupBlock.block;
             if (block->accumulatorChanges.count(coinGroup.first) > 0) {
                 if (block->mintedPubCoins.count(coinGroup.first) == 0) {
                     fprintf(stderr, "  no minted coins\n");
@@ -1052,11 +1518,6 @@ bool CZerocoinState::TestValidity(CChain *chain) {
                     return false;
                 }
             }
-
-            if (block != coinGroup.second.lastBlock)
-                block = (*chain)[block->nHeight+1];
-            else
-                break;
         }
 
         fprintf(stderr, "  verified ok\n");
@@ -1065,19 +1526,22 @@ bool CZerocoinState::TestValidity(CChain *chain) {
     return true;
 }
 
-set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain) {
+set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain, int nFromHeight) {
     set<CBlockIndex *> changes;
 
     BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CoinGroupInfo) &coinGroup, coinGroups) {
         // Skip non-modulusv2 groups
         if (!IsZerocoinTxV2((libzerocoin::CoinDenomination)coinGroup.first.first, Params().GetConsensus(), coinGroup.first.second))
             continue;
+        // and the ones checked already
+        if (coinGroup.second.firstBlock->nHeight < nFromHeight)
+            continue;
 
         libzerocoin::Accumulator acc(&ZCParamsV2->accumulatorParams, (libzerocoin::CoinDenomination)coinGroup.first.first);
 
         // Try to calculate accumulator for the first batch of mints. If it doesn't match we need to recalculate the rest of it
-        CBlockIndex *block = coinGroup.second.firstBlock;
-        for (;;) {
+        BOOST_FOREACH(const CoinGroupBlock &groupBlock, coinGroupBlocks[coinGroup.first]) {
+            CBlockIndex *block = groupBlock.block;
             if (block->accumulatorChanges.count(coinGroup.first) > 0) {
                 BOOST_FOREACH(const CBigNum &pubCoin, block->mintedPubCoins[coinGroup.first]) {
                     acc += libzerocoin::PublicCoin(ZCParamsV2, pubCoin, (libzerocoin::CoinDenomination)coinGroup.first.first);
@@ -1096,12 +1560,12 @@ set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain) {
                 block->accumulatorChanges[coinGroup.first] = make_pair(acc.getValue(), (int)block->mintedPubCoins[coinGroup.first].size());
                 changes.insert(block);
             }
-
-            if (block != coinGroup.second.lastBlock)
-                block = (*chain)[block->nHeight+1];
-            else
-                break;
         }
+
+        // Numbers of coins are recalculated too
+        int nCoins = 0;
+        BOOST_FOREACH(CoinGroupBlock &groupBlock, coinGroupBlocks[coinGroup.first])
+            groupBlock.nCoins = (nCoins += groupBlock.block->accumulatorChanges[coinGroup.first].second);
     }
 
     return changes;
@@ -1109,20 +1573,19 @@ set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain) {
 
 bool CZerocoinState::AddSpendToMempool(const vector<CBigNum> &coinSerials, uint256 txHash) {
     BOOST_FOREACH(CBigNum coinSerial, coinSerials){
-        if (IsUsedCoinSerial(coinSerial) || mempoolCoinSerials.count(coinSerial))
+        if (!AddSpendToMempool(coinSerial, txHash))
             return false;
-
-        mempoolCoinSerials[coinSerial] = txHash;        
     }
 
     return true;
 }
 
 bool CZerocoinState::AddSpendToMempool(const CBigNum &coinSerial, uint256 txHash) {
-    if (IsUsedCoinSerial(coinSerial) || mempoolCoinSerials.count(coinSerial))
+    uint256 serialDigest = GetBigNumDigest(coinSerial);
+    if (usedCoinSerials.count(serialDigest) || mempoolCoinSerials.count(serialDigest))
         return false;
 
-    mempoolCoinSerials[coinSerial] = txHash;
+    mempoolCoinSerials.insert(serialDigest, txHash);
     return true;
 }
 
@@ -1131,18 +1594,131 @@ void CZerocoinState::RemoveSpendFromMempool(const CBigNum &coinSerial) {
 }
 
 uint256 CZerocoinState::GetMempoolConflictingTxHash(const CBigNum &coinSerial) {
-    if (mempoolCoinSerials.count(coinSerial) == 0)
-        return uint256();
-
-    return mempoolCoinSerials[coinSerial];
+    const uint256 *txHash = mempoolCoinSerials.find(coinSerial);
+    return txHash != NULL ? *txHash : uint256();
 }
 
 bool CZerocoinState::CanAddSpendToMempool(const CBigNum &coinSerial) {
-    return !IsUsedCoinSerial(coinSerial) && mempoolCoinSerials.count(coinSerial) == 0;
+    uint256 serialDigest = GetBigNumDigest(coinSerial);
+    return usedCoinSerials.count(serialDigest) == 0 && mempoolCoinSerials.count(serialDigest) == 0;
+}
+
+void CZerocoinState::GetSnapshot(const CBlockIndex *tip, CZerocoinStateSnapshot &snapshot) const {
+    snapshot = CZerocoinStateSnapshot();
+    snapshot.hashBlock = tip->GetBlockHash();
+    snapshot.nHeight = tip->nHeight;
+
+    // first and last blocks of a group are the first and last of its blocks changing the accumulator
+    snapshot.coinGroups.reserve(coinGroups.size());
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CoinGroupInfo) &coinGroup, coinGroups) {
+        CZerocoinStateSnapshot::CoinGroup group;
+        group.denomination = coinGroup.first.first;
+        group.id = coinGroup.first.second;
+        group.nCoins = coinGroup.second.nCoins;
+        auto groupBlocks = coinGroupBlocks.find(coinGroup.first);
+        if (groupBlocks != coinGroupBlocks.end()) {
+            group.blocks.reserve(groupBlocks->second.size());
+            BOOST_FOREACH(const CoinGroupBlock &groupBlock, groupBlocks->second)
+                group.blocks.push_back(make_pair(groupBlock.block->GetBlockHash(), groupBlock.nCoins));
+        }
+        snapshot.coinGroups.push_back(group);
+    }
+
+    snapshot.latestCoinIds = latestCoinIds;
+
+    snapshot.mintedPubCoins.reserve(mintedPubCoins.size());
+    mintedPubCoins.ForEach([&snapshot](const uint256 &digest, const CMintedCoinInfo &coinInfo) {
+        CZerocoinStateSnapshot::MintedCoin coin;
+        coin.pubCoinDigest = digest;
+        coin.denomination = coinInfo.denomination;
+        coin.id = coinInfo.id;
+        coin.nHeight = coinInfo.nHeight;
+        snapshot.mintedPubCoins.push_back(coin);
+    });
+
+    snapshot.usedCoinSerialDigests.reserve(usedCoinSerials.size());
+    usedCoinSerials.ForEach([&snapshot](const uint256 &digest, char) {
+        snapshot.usedCoinSerialDigests.push_back(digest);
+    });
+}
+
+bool CZerocoinState::LoadSnapshot(CChain *chain, const CZerocoinStateSnapshot &snapshot) {
+    Reset();
+
+    if (snapshot.nSnapshotVersion != CZerocoinStateSnapshot::CURRENT_VERSION ||
+            snapshot.nHeight < 0 || snapshot.nHeight > chain->Height() ||
+            (*chain)[snapshot.nHeight]->GetBlockHash() != snapshot.hashBlock)
+        return false;
+
+    // Every block of a group has to be on the chain up to the snapshot and change the accumulator of the group by
+    // the number of coins the snapshot has for it
+    BOOST_FOREACH(const CZerocoinStateSnapshot::CoinGroup &group, snapshot.coinGroups) {
+        pair<int,int> denomAndId(group.denomination, group.id);
+        if (group.blocks.empty() || coinGroups.count(denomAndId) > 0) {
+            Reset();
+            return false;
+        }
+
+        vector<CoinGroupBlock> &groupBlocks = coinGroupBlocks[denomAndId];
+        groupBlocks.reserve(group.blocks.size());
+        int nCoins = 0, nPrevHeight = -1;
+        BOOST_FOREACH(const PAIRTYPE(uint256, int) &block, group.blocks) {
+            BlockMap::const_iterator mi = mapBlockIndex.find(block.first);
+            CBlockIndex *index = mi != mapBlockIndex.end() ? mi->second : NULL;
+            if (index == NULL || index->nHeight <= nPrevHeight || index->nHeight > snapshot.nHeight || !chain->Contains(index)) {
+                Reset();
+                return false;
+            }
+            auto accUpdate = index->accumulatorChanges.find(denomAndId);
+            if (accUpdate == index->accumulatorChanges.end() || block.second != (nCoins += accUpdate->second.second)) {
+                Reset();
+                return false;
+            }
+            groupBlocks.push_back(CoinGroupBlock(index, nCoins));
+            nPrevHeight = index->nHeight;
+        }
+        if (nCoins != group.nCoins) {
+            Reset();
+            return false;
+        }
+
+        CoinGroupInfo &coinGroup = coinGroups[denomAndId];
+        coinGroup.firstBlock = groupBlocks.front().block;
+        coinGroup.lastBlock = groupBlocks.back().block;
+        coinGroup.nCoins = nCoins;
+    }
+
+    latestCoinIds = snapshot.latestCoinIds;
+
+    // a null digest would stand for a free slot of the tables
+    mintedPubCoins.reserve(snapshot.mintedPubCoins.size());
+    BOOST_FOREACH(const CZerocoinStateSnapshot::MintedCoin &coin, snapshot.mintedPubCoins) {
+        if (coin.pubCoinDigest.IsNull()) {
+            Reset();
+            return false;
+        }
+        CMintedCoinInfo coinInfo;
+        coinInfo.denomination = coin.denomination;
+        coinInfo.id = coin.id;
+        coinInfo.nHeight = coin.nHeight;
+        mintedPubCoins.insert(coin.pubCoinDigest, coinInfo);
+    }
+
+    usedCoinSerials.reserve(snapshot.usedCoinSerialDigests.size());
+    BOOST_FOREACH(const uint256 &digest, snapshot.usedCoinSerialDigests) {
+        if (digest.IsNull()) {
+            Reset();
+            return false;
+        }
+        usedCoinSerials.insert(digest);
+    }
+
+    return true;
 }
 
 void CZerocoinState::Reset() {
     coinGroups.clear();
+    coinGroupBlocks.clear();
     usedCoinSerials.clear();
     mintedPubCoins.clear();
     latestCoinIds.clear();
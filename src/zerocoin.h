@@ -7,6 +7,7 @@
 #include "consensus/validation.h"
 #include "libzerocoin/Zerocoin.h"
 #include "zerocoin_params.h"
+#include "zerocoin_digestmap.h"
 #include <unordered_set>
 #include <unordered_map>
 #include <functional>
@@ -45,6 +46,52 @@ public:
     void Complete();
 };
 
+/**
+ * Closure representing the verification of one zerocoin spend proof against the accumulator values it may
+ * have been made with, in order. Serial number checks are left to CheckSpendJemcashTransaction
+ */
+class CZerocoinSpendCheck
+{
+private:
+    std::shared_ptr<libzerocoin::CoinSpend> spend;
+    libzerocoin::Params *zcParams;
+    libzerocoin::CoinDenomination denomination;
+    vector<CBigNum> accumulatorValues;
+    uint32_t accumulatorId;
+    uint256 txHashForMetadata;
+
+public:
+    CZerocoinSpendCheck(): zcParams(NULL), denomination(libzerocoin::ZQ_LOVELACE), accumulatorId(0) {}
+    CZerocoinSpendCheck(std::shared_ptr<libzerocoin::CoinSpend> spendIn, libzerocoin::Params *zcParamsIn,
+                        libzerocoin::CoinDenomination denominationIn, vector<CBigNum> &accumulatorValuesIn,
+                        uint32_t accumulatorIdIn, const uint256 &txHashForMetadataIn) :
+        spend(spendIn), zcParams(zcParamsIn), denomination(denominationIn), accumulatorId(accumulatorIdIn),
+        txHashForMetadata(txHashForMetadataIn) {
+        accumulatorValues.swap(accumulatorValuesIn);
+    }
+
+    bool operator()();
+
+    // add the proof to a batch verifying it with others, see CheckZerocoinSpendsBatch
+    void AddToBatch(libzerocoin::CoinSpendBatchVerifier &batch) const;
+    void LogFailure() const;
+
+    void swap(CZerocoinSpendCheck &check) {
+        spend.swap(check.spend);
+        std::swap(zcParams, check.zcParams);
+        std::swap(denomination, check.denomination);
+        accumulatorValues.swap(check.accumulatorValues);
+        std::swap(accumulatorId, check.accumulatorId);
+        std::swap(txHashForMetadata, check.txHashForMetadata);
+    }
+};
+
+/**
+ * Verify the spend proofs of several checks together, their serial number signatures in one parallel pass.
+ * Returns false if any of them fails, logging every one that does
+ */
+bool CheckZerocoinSpendsBatch(const std::vector<CZerocoinSpendCheck> &checks);
+
 bool CheckZerocoinFoundersInputs(const CTransaction &tx, CValidationState &state, const Consensus::Params &params, int nHeight, bool fMTP);
 bool CheckZerocoinTransaction(const CTransaction &tx,
 	CValidationState &state,
@@ -54,22 +101,143 @@ bool CheckZerocoinTransaction(const CTransaction &tx,
 	int nHeight,
     bool isCheckWallet,
     bool fZerocoinStateCheck,
-    CZerocoinTxInfo *zerocoinTxInfo);
+    CZerocoinTxInfo *zerocoinTxInfo,
+    std::vector<CZerocoinSpendCheck> *pvChecks = NULL);
 
 void DisconnectTipZC(CBlock &block, CBlockIndex *pindexDelete);
 bool ConnectBlockZC(CValidationState &state, const CChainParams &chainparams, CBlockIndex *pindexNew, const CBlock *pblock, bool fJustCheck=false);
 
 int ZerocoinGetNHeight(const CBlockHeader &block);
 
-bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes);
+class CZerocoinStateSnapshot;
+class CZerocoinSupply;
+
+// Build the state of the chain, continuing from the snapshot if there is one matching the chain. The zerocoin supply
+// read from the database is brought up to the tip on the way
+bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes, const CZerocoinStateSnapshot *snapshot = NULL,
+                                 const CZerocoinSupply *supply = NULL);
 
 CBigNum ZerocoinGetSpendSerialNumber(const CTransaction &tx, const CTxIn &txin);
 
+// Wake up the thread computing alternative modulus accumulator values, done for every block connected
+void ZerocoinScheduleAlternativeModulusAccumulators();
+// Compute in the background the alternative modulus accumulator values of the coin groups that may be spent with
+// the alternative modulus, so spend checks don't have to go through the whole group
+void ThreadZerocoinAlternativeModulusAccumulators();
+
+/*
+ * Zerocoin amounts of the chain up to some block, per denomination. Kept up to date as blocks are connected and
+ * disconnected, and written to the block tree database with the state snapshot
+ */
+class CZerocoinSupply {
+public:
+    // block the amounts are up to
+    uint256 hashBlock;
+    // denomination -> amount of the mints and of the spends
+    map<int, CAmount> minted;
+    map<int, CAmount> spent;
+    // amount of the spends of serials used before, the coins they added to the supply
+    CAmount respent;
+
+    CZerocoinSupply() : respent(0) {}
+
+    void AddMint(int denomination, int nSign = 1) { minted[denomination] += nSign * denomination * COIN; }
+    void AddSpend(int denomination, bool fRespent, int nSign = 1) {
+        spent[denomination] += nSign * denomination * COIN;
+        if (fRespent)
+            respent += nSign * denomination * COIN;
+    }
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlock);
+        READWRITE(minted);
+        READWRITE(spent);
+        READWRITE(respent);
+    }
+};
+
+// Start counting the zerocoin supply of a new chain, done when the block tree database is created or reindexed
+void ZerocoinResetSupply(const uint256 &hashGenesisBlock);
+// Zerocoin supply of the active chain, false if it isn't counted and the chain has to be reindexed for it
+bool ZerocoinGetSupply(CZerocoinSupply &supply);
+
+/*
+ * Copy of the zerocoin state as of some block of the chain. It is written to the block tree database when the state
+ * is flushed, so at startup only the blocks connected after it are replayed. Blocks are referred to by hash
+ */
+class CZerocoinStateSnapshot {
+public:
+    // Snapshots of other versions are ignored and the state is rebuilt from the genesis block
+    static const int CURRENT_VERSION = 2;
+
+    struct CoinGroup {
+        int denomination;
+        int id;
+        int nCoins;
+        // blocks changing the accumulator of the group with the number of coins minted up to each of them
+        vector<pair<uint256, int>> blocks;
+
+        ADD_SERIALIZE_METHODS;
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(denomination);
+            READWRITE(id);
+            READWRITE(nCoins);
+            READWRITE(blocks);
+        }
+    };
+
+    struct MintedCoin {
+        // the state only keeps digests of the coins
+        uint256 pubCoinDigest;
+        int denomination;
+        int id;
+        int nHeight;
+
+        ADD_SERIALIZE_METHODS;
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(pubCoinDigest);
+            READWRITE(denomination);
+            READWRITE(id);
+            READWRITE(nHeight);
+        }
+    };
+
+    int nSnapshotVersion;
+    // block the state is of
+    uint256 hashBlock;
+    int nHeight;
+
+    vector<CoinGroup> coinGroups;
+    map<int, int> latestCoinIds;
+
+    // Not serialized with the rest, the database stores them in parts of limited size
+    vector<MintedCoin> mintedPubCoins;
+    vector<uint256> usedCoinSerialDigests;
+
+    CZerocoinStateSnapshot() : nSnapshotVersion(CURRENT_VERSION), nHeight(-1) {}
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(nSnapshotVersion);
+        if (nSnapshotVersion != CURRENT_VERSION)
+            return;
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(coinGroups);
+        READWRITE(latestCoinIds);
+    }
+};
+
 /*
  * State of minted/spent coins as extracted from the index
  */
 class CZerocoinState {
-friend bool ZerocoinBuildStateFromIndex(CChain *, set<CBlockIndex *> &);
+friend bool ZerocoinBuildStateFromIndex(CChain *, set<CBlockIndex *> &, const CZerocoinStateSnapshot *, const CZerocoinSupply *);
 public:
     // First and last block where mint (and hence accumulator update) with given denomination and id was seen
     struct CoinGroupInfo {
@@ -82,12 +250,33 @@ public:
         int nCoins;
     };
 
-private:
-    // Custom hash for big numbers
-    struct CBigNumHash {
-        std::size_t operator()(const CBigNum &bn) const noexcept;
+    // Block changing the accumulator of a coin group
+    struct CoinGroupBlock {
+        CoinGroupBlock(CBlockIndex *blockIn, int nCoinsIn) : block(blockIn), nCoins(nCoinsIn) {}
+
+        CBlockIndex *block;
+        // number of coins minted in the group up to and including this block
+        int nCoins;
+    };
+
+    // Accumulator values of coin group blocks computed with the alternative modulus, from the last value known
+    struct AlternativeModulusJob {
+        pair<int, int> denomAndId;
+        libzerocoin::Params *altParams;
+        // value of the block before the first one, or the accumulator base
+        CBigNum startValue;
+        // blocks missing the value with the coins they mint in the group
+        vector<CBlockIndex *> blocks;
+        vector<vector<CBigNum>> blockCoins;
+        // values computed so far, the first ones of blocks
+        vector<CBigNum> values;
+
+        // Compute the values. Coins commute in an accumulator, so the coins of each block are multiplied together
+        // (in parallel for all the blocks) and the value of the block takes a single exponentiation
+        void Run();
     };
 
+private:
     struct CMintedCoinInfo {
         int         denomination;
         int         id;
@@ -96,20 +285,27 @@ private:
 
     // Collection of coin groups. Map from <denomination,id> to CoinGroupInfo structure
     map<pair<int, int>, CoinGroupInfo> coinGroups;
+    // Blocks changing the accumulator of each coin group in order of height, from firstBlock to lastBlock. Most
+    // blocks in between have no mints of the group, so the lookups below don't walk the chain
+    map<pair<int, int>, vector<CoinGroupBlock>> coinGroupBlocks;
     // Set of all minted pubCoin values
-    unordered_multimap<CBigNum,CMintedCoinInfo,CBigNumHash> mintedPubCoins;
+    CBigNumDigestMap<CMintedCoinInfo> mintedPubCoins;
     // Latest IDs of coins by denomination
     map<int, int> latestCoinIds;
 
+    // Job for the blocks of the group from the first one missing its alternative modulus value, as many of them as
+    // nMaxCoins coins allow. False if there is nothing to compute
+    bool GetAlternativeModulusJob(const pair<int, int> &denomAndId, size_t nMaxCoins, AlternativeModulusJob &job);
+
 
 public:
     CZerocoinState();
 
     // Set of all used coin serials. Allows multiple entries for the same coin serial for historical reasons
-    unordered_multiset<CBigNum,CBigNumHash> usedCoinSerials;
+    CBigNumDigestSet usedCoinSerials;
 
     // serials of spends currently in the mempool mapped to tx hashes
-    unordered_map<CBigNum,uint256,CBigNumHash> mempoolCoinSerials;
+    CBigNumDigestMap<uint256> mempoolCoinSerials;
 
     // Add mint, automatically assigning id to it. Returns id and previous accumulator value (if any)
     int AddMint(CBlockIndex *index, int denomination, const CBigNum &pubCoin, CBigNum &previousAccValue);
@@ -124,8 +320,14 @@ public:
     // Query coin group with given denomination and id
     bool GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &result);
 
+    // Blocks whose accumulator value of the coin group a spend may have been made against, latest first. A spend
+    // naming its accumulator block only gets that block or, if it is not part of the group, the first block
+    void GetAccumulatorBlocksForSpend(int denomination, int id, const uint256 *accumulatorBlockHash, vector<CBlockIndex *> &blocks);
+
     // Query if the coin serial was previously used
     bool IsUsedCoinSerial(const CBigNum &coinSerial);
+    // Number of blocks the coin serial is recorded as spent by
+    size_t GetCoinSerialSpendCount(const CBigNum &coinSerial);
     // Query if there is a coin with given pubCoin value
     bool HasCoin(const CBigNum &pubCoin);
 
@@ -137,12 +339,21 @@ public:
     // Get witness
     libzerocoin::AccumulatorWitness GetWitnessForSpend(CChain *chain, int maxHeight, int denomination, int id, const CBigNum &pubCoin, bool useModulusV2);
 
+    // Bring the value of a witness holding the coins minted up to fromHeight to the coins minted up to toHeight
+    void AdvanceWitnessForSpend(int fromHeight, int toHeight, int denomination, int id, const CBigNum &pubCoin, bool useModulusV2, CBigNum &witnessValue);
+
     // Return height of mint transaction and id of minted coin
     int GetMintedCoinHeightAndId(const CBigNum &pubCoin, int denomination, int &id);
 
     // If needed calculate accumulators for alternative accumulator modulus
     void CalculateAlternativeModulusAccumulatorValues(CChain *chain, int denomination, int id);
 
+    // Jobs for the groups that may be spent with the alternative modulus once the chain is at nHeight, with up to
+    // nMaxCoins coins in all. Returns false if some groups or blocks were left out to stay within the limit
+    bool GetAlternativeModulusJobs(int nHeight, size_t nMaxCoins, vector<AlternativeModulusJob> &jobs);
+    // Store the values computed by the job unless its group changed in the meantime
+    void SetAlternativeModulusValues(const AlternativeModulusJob &job);
+
     // Reset to initial values
     void Reset();
 
@@ -150,8 +361,14 @@ public:
     bool TestValidity(CChain *chain);
 
     // Recalculate accumulators. Needed if upgrade from pre-modulusv2 version is detected
-    // Returns set of indices that changed
-    set<CBlockIndex *> RecalculateAccumulators(CChain *chain);
+    // Groups starting below nFromHeight are taken as checked already. Returns set of indices that changed
+    set<CBlockIndex *> RecalculateAccumulators(CChain *chain, int nFromHeight = 0);
+
+    // Copy the state, which has to be the one of the tip block, into the snapshot
+    void GetSnapshot(const CBlockIndex *tip, CZerocoinStateSnapshot &snapshot) const;
+    // Replace the state with the one of the snapshot. Fails leaving the state empty if the snapshot doesn't match the
+    // blocks of the chain
+    bool LoadSnapshot(CChain *chain, const CZerocoinStateSnapshot &snapshot);
 
     // Check if there is a conflicting tx in the blockchain or mempool
     bool CanAddSpendToMempool(const CBigNum &coinSerial);
@@ -0,0 +1,28 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "zerocoin_digestmap.h"
+
+#include "crypto/sha256.h"
+#include "libzerocoin/Zerocoin.h"
+
+uint256 GetBigNumDigest(const CBigNum& bn)
+{
+    // Sign and big endian magnitude, on the stack for the sizes of serials and public coins
+    const BIGNUM* p = &bn;
+    size_t nSize = BN_num_bytes(p) + 1;
+    unsigned char stackBuf[256];
+    std::vector<unsigned char> heapBuf;
+    unsigned char* buf = stackBuf;
+    if (nSize > sizeof(stackBuf)) {
+        heapBuf.resize(nSize);
+        buf = heapBuf.data();
+    }
+    buf[0] = BN_is_negative(p) ? 1 : 0;
+    BN_bn2bin(p, buf + 1);
+
+    uint256 digest;
+    CSHA256().Write(buf, nSize).Finalize(digest.begin());
+    return digest;
+}
@@ -0,0 +1,205 @@
+// Copyright (c) 2018-2019 The Jemcash Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef JEMCASH_ZEROCOIN_DIGESTMAP_H
+#define JEMCASH_ZEROCOIN_DIGESTMAP_H
+
+#include "uint256.h"
+
+#include <vector>
+
+class CBigNum;
+
+/** SHA256 of the serialized number, the key CBigNumDigestMap stores it by */
+uint256 GetBigNumDigest(const CBigNum& bn);
+
+/**
+ * Multimap from big numbers to values, for the coin serials and public coins
+ * of the zerocoin state.
+ *
+ * Numbers are stored by digest in a flat table with linear probing, so a
+ * lookup serializes and hashes the number once, then compares 32 byte keys in
+ * place. An entry takes 32 + sizeof(T) bytes of the table, at most 3/4 full,
+ * about 70 bytes a public coin all told, where a node of an unordered
+ * container of CBigNum holds an OpenSSL BIGNUM in several allocations: about
+ * 230 bytes for a public coin of 1024 bits, 120 bytes for a serial. Lookups
+ * of serials no longer go through a single bucket either, see
+ * bench/zerocoin_state.cpp.
+ *
+ * A null digest marks a free slot, the digest of a number is never null.
+ */
+template<typename T>
+class CBigNumDigestMap
+{
+public:
+    struct Entry
+    {
+        uint256 digest;
+        T value;
+
+        Entry() : value() {}
+        Entry(const uint256& digestIn, const T& valueIn) : digest(digestIn), value(valueIn) {}
+    };
+
+private:
+    //! Number of slots is zero or a power of two
+    std::vector<Entry> table;
+    size_t nEntries;
+
+    size_t Home(const uint256& digest) const { return digest.GetCheapHash() & (table.size() - 1); }
+    size_t Next(size_t slot) const { return (slot + 1) & (table.size() - 1); }
+
+    void Place(const Entry& entry)
+    {
+        size_t slot = Home(entry.digest);
+        while (!table[slot].digest.IsNull())
+            slot = Next(slot);
+        table[slot] = entry;
+    }
+
+    void Rehash(size_t nSlots)
+    {
+        std::vector<Entry> oldTable(nSlots);
+        table.swap(oldTable);
+        for (const Entry& entry : oldTable) {
+            if (!entry.digest.IsNull())
+                Place(entry);
+        }
+    }
+
+    /** Empty the slot, moving back the entries after it that could not be
+     *  found past the hole otherwise */
+    void EraseSlot(size_t slot)
+    {
+        size_t hole = slot;
+        for (size_t next = Next(slot); !table[next].digest.IsNull(); next = Next(next)) {
+            size_t home = Home(table[next].digest);
+            // entries whose home is cyclically in (hole, next] stay
+            bool fStays = hole < next ? (home > hole && home <= next) : (home > hole || home <= next);
+            if (!fStays) {
+                table[hole] = table[next];
+                hole = next;
+            }
+        }
+        table[hole] = Entry();
+        nEntries--;
+    }
+
+public:
+    CBigNumDigestMap() : nEntries(0) {}
+
+    size_t size() const { return nEntries; }
+    bool empty() const { return nEntries == 0; }
+
+    /** Remove all the entries and free the table */
+    void clear()
+    {
+        std::vector<Entry>().swap(table);
+        nEntries = 0;
+    }
+
+    /** Make room for n entries in all, so adding them doesn't rehash */
+    void reserve(size_t n)
+    {
+        size_t nSlots = 16;
+        while (nSlots / 4 * 3 < n)
+            nSlots *= 2;
+        if (nSlots > table.size())
+            Rehash(nSlots);
+    }
+
+    void insert(const uint256& digest, const T& value)
+    {
+        reserve(nEntries + 1);
+        Place(Entry(digest, value));
+        nEntries++;
+    }
+
+    void insert(const CBigNum& bn, const T& value) { insert(GetBigNumDigest(bn), value); }
+
+    size_t count(const uint256& digest) const
+    {
+        size_t n = 0;
+        if (!table.empty()) {
+            for (size_t slot = Home(digest); !table[slot].digest.IsNull(); slot = Next(slot))
+                n += table[slot].digest == digest;
+        }
+        return n;
+    }
+
+    size_t count(const CBigNum& bn) const { return count(GetBigNumDigest(bn)); }
+
+    /** First value of the number satisfying pred, NULL if none does */
+    template<typename Pred>
+    const T* find_if(const CBigNum& bn, Pred pred) const
+    {
+        if (table.empty())
+            return NULL;
+        uint256 digest = GetBigNumDigest(bn);
+        for (size_t slot = Home(digest); !table[slot].digest.IsNull(); slot = Next(slot)) {
+            if (table[slot].digest == digest && pred(table[slot].value))
+                return &table[slot].value;
+        }
+        return NULL;
+    }
+
+    const T* find(const CBigNum& bn) const { return find_if(bn, [](const T&) { return true; }); }
+
+    /** Remove the first entry of the number whose value satisfies pred */
+    template<typename Pred>
+    bool erase_if(const CBigNum& bn, Pred pred)
+    {
+        if (table.empty())
+            return false;
+        uint256 digest = GetBigNumDigest(bn);
+        for (size_t slot = Home(digest); !table[slot].digest.IsNull(); slot = Next(slot)) {
+            if (table[slot].digest == digest && pred(table[slot].value)) {
+                EraseSlot(slot);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** Remove all the entries of the number, returns how many there were */
+    size_t erase(const CBigNum& bn)
+    {
+        size_t n = 0;
+        if (table.empty())
+            return n;
+        uint256 digest = GetBigNumDigest(bn);
+        for (size_t slot = Home(digest); !table[slot].digest.IsNull(); ) {
+            // the slot gets the next entry of the sequence, if any
+            if (table[slot].digest == digest) {
+                EraseSlot(slot);
+                n++;
+            } else {
+                slot = Next(slot);
+            }
+        }
+        return n;
+    }
+
+    /** Call f(digest, value) for every entry, in no particular order */
+    template<typename F>
+    void ForEach(F f) const
+    {
+        for (const Entry& entry : table) {
+            if (!entry.digest.IsNull())
+                f(entry.digest, entry.value);
+        }
+    }
+
+    size_t DynamicMemoryUsage() const { return table.capacity() * sizeof(Entry); }
+};
+
+/** Multiset of big numbers, see CBigNumDigestMap */
+class CBigNumDigestSet : public CBigNumDigestMap<char>
+{
+public:
+    void insert(const uint256& digest) { CBigNumDigestMap<char>::insert(digest, 0); }
+    void insert(const CBigNum& bn) { CBigNumDigestMap<char>::insert(bn, 0); }
+};
+
+#endif // JEMCASH_ZEROCOIN_DIGESTMAP_H